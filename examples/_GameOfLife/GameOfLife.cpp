@@ -76,12 +76,23 @@ int main() {
     int* map        = (int*) PushArena(&window->persistentArena, MapLength * sizeof(int));
     int* backbuffer = (int*) PushArena(&window->persistentArena, MapLength * sizeof(int));
 
+    // Cells are drawn in one instanced draw call
+    Matrix* transforms = (Matrix*) PushArena(&window->persistentArena, MapLength * sizeof(Matrix));
+    Vector4* colors    = (Vector4*) PushArena(&window->persistentArena, MapLength * sizeof(Vector4));
+
+    for(int i = 0; i < MapLength; i++) {
+        float x = i % SizeX;
+        float y = i / SizeX;
+
+        transforms[i] = MatrixTranslate(x, y, 0);
+    }
+
     srand(seed);
     for(int i = 0; i < MapLength; i++) {
         map[i] = rand() % 100  < 20;
     }
 
-    UseShader(window, ColorShader);
+    UseShader(window, MultiDrawColorShader);
 
     float timer = 0;
 
@@ -102,16 +113,12 @@ int main() {
 
         timer += window->timeDelta;
 
-        Matrix vp = GetVPMatrix(&camera);
         for(int i = 0; i < MapLength; i++) {
-            float x = i % SizeX;
-            float y = i / SizeX;
-
-            SetShaderUniform(window, "tint", map[i] == 0 ? Vector4{0, 0, 0, 1} : Vector4{1, 1, 1, 1});
-
-            DrawMesh(window, quad, vp * MatrixTranslate(x, y, 0));
+            colors[i] = map[i] == 0 ? Vector4{0, 0, 0, 1} : Vector4{1, 1, 1, 1};
         }
 
+        DrawMeshInstanced(window, quad, camera, MakeSlice(transforms, 0, MapLength), MakeSlice(colors, 0, MapLength));
+
         FrameEnd(window);
     }
 
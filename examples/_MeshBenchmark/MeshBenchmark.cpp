@@ -0,0 +1,524 @@
+#ifdef UNITY_BUILD
+#include "../../src/unity.cpp"
+#endif
+
+#include "../common/CameraMovement.cpp"
+
+// Vertex bound scene used to compare different mesh configurations.
+// Press TAB to switch between tested meshes, M to toggle multi draw submission,
+// O to toggle the occluder wall in the middle of the grid (multi draw only).
+
+const int GridSize = 48;
+
+// Consecutive draws cycle through meshesCount meshes
+struct BenchmarkMesh {
+    const char* name;
+    Mesh meshes[4];
+    int meshesCount;
+};
+
+void CreateMixedMeshes(BenchmarkMesh* benchmark, MemoryArena* arena) {
+    benchmark->meshes[0] = CreateCubeMesh(arena);
+    benchmark->meshes[1] = CreateUVSphereMesh(arena);
+    benchmark->meshes[2] = CreateTorusMesh(arena);
+    benchmark->meshes[3] = CreateCylinderMesh(arena);
+    benchmark->meshesCount = 4;
+}
+
+void PrintMeshStats(const char* name, Mesh* mesh, MemoryArena* arena) {
+    int vertexSize = GetVertexFormat(mesh, VertexLayout::Interleaved).stride;
+
+    VertexCacheStats cache = AnalyzeVertexCache(mesh->triangles, (int) mesh->vertices.length, 16, arena);
+    VertexFetchStats fetch = AnalyzeVertexFetch(mesh->triangles, (int) mesh->vertices.length, vertexSize, arena);
+
+    printf("%-24s ACMR: %.3f ATVR: %.3f overfetch: %.3f\n", name, cache.acmr, cache.atvr, fetch.overfetch);
+}
+
+void BenchmarkOptimization(const char* name, Mesh mesh, MemoryArena* arena) {
+    char buffer[64];
+
+    snprintf(buffer, sizeof(buffer), "%s", name);
+    PrintMeshStats(buffer, &mesh, arena);
+
+    double start = glfwGetTime();
+    OptimizeMesh(&mesh, arena);
+    double time = glfwGetTime() - start;
+
+    snprintf(buffer, sizeof(buffer), "%s optimized", name);
+    PrintMeshStats(buffer, &mesh, arena);
+
+    printf("%-24s %.3f ms\n\n", "Optimization time:", time * 1000);
+}
+
+// Large height field, so the normals calculation time is measurable
+Mesh CreateBenchmarkGrid(int size, MemoryArena* arena) {
+    Mesh mesh = {};
+    mesh.vertices  = PushSliceToArena<Vector3>(arena, size * size);
+    mesh.normals   = PushSliceToArena<Vector3>(arena, size * size);
+    mesh.triangles = PushSliceToArena<int32_t>(arena, (size - 1) * (size - 1) * 6);
+
+    for(int y = 0; y < size; y++)
+    for(int x = 0; x < size; x++) {
+        mesh.vertices[x + y * size] = {(float) x, sinf(x * 0.1f) * cosf(y * 0.2f), (float) y};
+    }
+
+    int index = 0;
+    for(int y = 0; y < size - 1; y++)
+    for(int x = 0; x < size - 1; x++) {
+        int i = x + y * size;
+
+        mesh.triangles[index++] = i;
+        mesh.triangles[index++] = i + size + 1;
+        mesh.triangles[index++] = i + 1;
+
+        mesh.triangles[index++] = i;
+        mesh.triangles[index++] = i + size;
+        mesh.triangles[index++] = i + size + 1;
+    }
+
+    return mesh;
+}
+
+void BenchmarkNormals(MemoryArena* arena) {
+    const char* names[] = {"Uniform", "Area", "Angle"};
+
+    Mesh mesh = CreateBenchmarkGrid(1024, arena);
+    Slice<Vector3> serialNormals = PushSliceToArena<Vector3>(arena, mesh.normals.length);
+
+    printf("%d vertices, %d threads\n", (int) mesh.vertices.length, GetProcessorCount());
+
+    for(int i = 0; i < 3; i++) {
+        NormalWeighting weighting = (NormalWeighting) i;
+
+        double start = glfwGetTime();
+        CalculateNormals(&mesh, weighting);
+        double serialTime = glfwGetTime() - start;
+
+        memcpy(serialNormals.data, mesh.normals.data, mesh.normals.length * sizeof(Vector3));
+
+        start = glfwGetTime();
+        CalculateNormalsParallel(&mesh, arena, weighting);
+        double parallelTime = glfwGetTime() - start;
+
+        bool identical = memcmp(serialNormals.data, mesh.normals.data, mesh.normals.length * sizeof(Vector3)) == 0;
+        printf("%-8s serial: %.3f ms parallel: %.3f ms %s\n", names[i], serialTime * 1000, parallelTime * 1000,
+               identical ? "(identical)" : "(MISMATCH)");
+    }
+
+    printf("\n");
+}
+
+void BenchmarkCulling(Camera* camera, MemoryArena* arena) {
+    Frustum frustum = GetCameraFrustum(camera);
+    int counts[] = {100000, 1000000};
+
+    for(int c = 0; c < 2; c++) {
+        int count = counts[c];
+        uint64_t arenaPos = GetArenaPos(arena);
+
+        Slice<Vector4> spheres = PushSliceToArena<Vector4>(arena, count);
+        int32_t* visible = (int32_t*) PushArena(arena, count * sizeof(int32_t));
+
+        srand(count);
+        for(int i = 0; i < count; i++) {
+            spheres[i] = {(rand() % 2000 - 1000) * 0.1f, (rand() % 2000 - 1000) * 0.1f,
+                          (rand() % 2000 - 1000) * 0.1f, (rand() % 100) * 0.05f};
+        }
+
+        double start = glfwGetTime();
+        int scalarVisible = 0;
+        for(int i = 0; i < count; i++) {
+            scalarVisible += IsSphereInFrustum(&frustum, {spheres[i].x, spheres[i].y, spheres[i].z}, spheres[i].w);
+        }
+        double scalarTime = glfwGetTime() - start;
+
+        start = glfwGetTime();
+        int simdVisible = CullSpheres(&frustum, spheres, visible);
+        double simdTime = glfwGetTime() - start;
+
+        printf("%7d spheres scalar: %.3f ms SSE: %.3f ms visible: %d %s\n", count, scalarTime * 1000, simdTime * 1000,
+               simdVisible, scalarVisible == simdVisible ? "(identical)" : "(MISMATCH)");
+
+        // BVH over sphere bounds, culled with boxes so visible counts can differ slightly
+        Slice<BoundingBox> bounds = PushSliceToArena<BoundingBox>(arena, count);
+        for(int i = 0; i < count; i++) {
+            Vector3 center = {spheres[i].x, spheres[i].y, spheres[i].z};
+            Vector3 extent = {spheres[i].w, spheres[i].w, spheres[i].w};
+            bounds[i] = {center - extent, center + extent};
+        }
+
+        start = glfwGetTime();
+        Bvh bvh = BuildBvh(bounds, arena, arena);
+        double buildTime = glfwGetTime() - start;
+
+        start = glfwGetTime();
+        int bvhVisible = QueryBvhFrustum(&bvh, &frustum, visible);
+        double queryTime = glfwGetTime() - start;
+
+        printf("%7d boxes   BVH build: %.3f ms query: %.3f ms visible: %d\n", count, buildTime * 1000, queryTime * 1000, bvhVisible);
+
+        PopArenaTo(arena, arenaPos);
+    }
+
+    printf("\n");
+}
+
+void BenchmarkPicking(MemoryArena* arena) {
+    uint64_t arenaPos = GetArenaPos(arena);
+
+    // ~1M triangles
+    Mesh mesh = CreateBenchmarkGrid(708, arena);
+    Matrix transform = MatrixTranslate(-354, 0, -354);
+
+    Ray ray = {{0, 10, 0}, {0, -1, 0}};
+    MeshHit hit = {};
+
+    double start = glfwGetTime();
+    PickMesh(&mesh, transform, ray, arena, arena, &hit);
+    double buildTime = glfwGetTime() - start;
+
+    const int raysCount = 1000;
+    int hits = 0;
+
+    srand(raysCount);
+    start = glfwGetTime();
+    for(int i = 0; i < raysCount; i++) {
+        ray.origin = {(rand() % 600 - 300) * 1.0f, 10, (rand() % 600 - 300) * 1.0f};
+        ray.direction = Vector3Normalize({(rand() % 100 - 50) * 0.01f, -1, (rand() % 100 - 50) * 0.01f});
+
+        hits += PickMesh(&mesh, transform, ray, arena, arena, &hit);
+    }
+    double pickTime = (glfwGetTime() - start) / raysCount;
+
+    printf("%d triangles, BVH build: %.3f ms pick: %.4f ms hits: %d/%d\n\n", (int) (mesh.triangles.length / 3),
+           buildTime * 1000, pickTime * 1000, hits, raysCount);
+
+    PopArenaTo(arena, arenaPos);
+}
+
+void BenchmarkMeshlets(Camera* camera, MemoryArena* arena) {
+    uint64_t arenaPos = GetArenaPos(arena);
+
+    // ~1M triangles
+    Mesh mesh = CreateBenchmarkGrid(708, arena);
+    Matrix transform = MatrixTranslate(-354, 0, -354);
+
+    double start = glfwGetTime();
+    MeshletData* meshlets = BuildMeshlets(&mesh, arena, arena);
+    double buildTime = glfwGetTime() - start;
+
+    start = glfwGetTime();
+    int commandsCount = CullMeshlets(meshlets, &mesh, transform, camera);
+    double cullTime = glfwGetTime() - start;
+
+    printf("%d triangles, %d meshlets, build: %.3f ms cull: %.3f ms visible: %d commands: %d\n\n",
+           (int) (mesh.triangles.length / 3), meshlets->meshletsCount, buildTime * 1000, cullTime * 1000,
+           meshlets->visibleCount, commandsCount);
+
+    PopArenaTo(arena, arenaPos);
+}
+
+void CountChunkTriangles(MeshChunk* chunk, void* userData) {
+    int64_t* trianglesCount = (int64_t*) userData;
+    *trianglesCount += chunk->mesh.triangles.length / 3;
+}
+
+void BenchmarkGenerators(MemoryArena* arena) {
+    double start = glfwGetTime();
+    Mesh sphere = CreateIcosphereMesh(arena, 6);
+    printf("%-24s %d triangles %.3f ms\n", "Icosphere (6):", (int) sphere.triangles.length / 3, (glfwGetTime() - start) * 1000);
+    DeleteMesh(&sphere);
+
+    int64_t trianglesCount = 0;
+    start = glfwGetTime();
+    GeneratePlaneChunks(4096, 1000.0f, 255, arena, CountChunkTriangles, &trianglesCount);
+    printf("%-24s %lld triangles %.3f ms\n\n", "Plane 4096x4096 chunks:", (long long) trianglesCount, (glfwGetTime() - start) * 1000);
+}
+
+// Writes a textured grid as OBJ text, used when no file is passed on the command line
+Str8 WriteBenchmarkObj(int size, MemoryArena* arena) {
+    uint64_t capacity = (uint64_t) size * size * 160;
+    char* text = (char*) PushArena(arena, capacity);
+    uint64_t length = 0;
+
+    for(int y = 0; y < size; y++)
+    for(int x = 0; x < size; x++) {
+        length += snprintf(text + length, capacity - length, "v %f %f %f\nvt %f %f\n",
+                           (float) x, sinf(x * 0.1f) * cosf(y * 0.2f), (float) y, (float) x / size, (float) y / size);
+    }
+
+    length += snprintf(text + length, capacity - length, "vn 0 1 0\n");
+
+    for(int y = 0; y < size - 1; y++)
+    for(int x = 0; x < size - 1; x++) {
+        int i = x + y * size + 1;
+        length += snprintf(text + length, capacity - length, "f %d/%d/1 %d/%d/1 %d/%d/1 %d/%d/1\n",
+                           i, i, i + size, i + size, i + size + 1, i + size + 1, i + 1, i + 1);
+    }
+
+    return Str8{text, length};
+}
+
+void BenchmarkImport(char* path, MemoryArena* arena, MemoryArena* tempArena) {
+    // Without the input file, generated grid is saved and used instead
+    if(path == NULL) {
+        path = (char*) "MeshBenchmark.obj";
+        Str8 obj = WriteBenchmarkObj(512, tempArena);
+
+        FILE* file;
+        if(fopen_s(&file, path, "wb") != 0) {
+            return;
+        }
+
+        fwrite(obj.str, 1, obj.length, file);
+        fclose(file);
+    }
+
+    MappedFile file = Win32_MapFile(path);
+    uint64_t size = file.size;
+    Win32_UnmapFile(&file);
+
+    uint64_t arenaPos = GetArenaPos(arena);
+
+    double start = glfwGetTime();
+    Mesh mesh = ImportMeshAtPath(path, arena, tempArena);
+    double time = glfwGetTime() - start;
+
+    printf("%-24s %.2f MB, %d vertices, %d triangles\n", path,
+           size / (1024.0 * 1024.0), (int) mesh.vertices.length, (int) mesh.triangles.length / 3);
+    printf("%-24s %.3f ms (%.1f MB/s)\n", "Import time:", time * 1000, size / (1024.0 * 1024.0) / time);
+
+    PopArenaTo(arena, arenaPos);
+
+    // First load builds the cache, second one only maps it
+    char cachePath[512];
+    snprintf(cachePath, sizeof(cachePath), "%s.meshcache", path);
+    remove(cachePath);
+
+    start = glfwGetTime();
+    mesh = LoadMeshCached(path, cachePath, VertexLayout::Quantized, 4, arena, tempArena);
+    printf("%-24s %.3f ms\n", "Cache build:", (glfwGetTime() - start) * 1000);
+    DeleteMesh(&mesh);
+
+    start = glfwGetTime();
+    mesh = LoadMeshCached(path, cachePath, VertexLayout::Quantized, 4, arena, tempArena);
+    printf("%-24s %.3f ms\n\n", "Cache load:", (glfwGetTime() - start) * 1000);
+    DeleteMesh(&mesh);
+}
+
+// Grid is iterated x, y, z like the draws index
+Matrix GetGridTransform(int index) {
+    int x = index / (GridSize * GridSize);
+    int y = index / GridSize % GridSize;
+    int z = index % GridSize;
+
+    return MatrixTranslate(x * 2.0f, y * 2.0f, z * 2.0f);
+}
+
+int main(int argc, char** argv) {
+    SRWindow* window = InitializeWindow(Str8Lit("Mesh Benchmark"));
+
+    Camera camera = CreatePerspective(60, 0.01f, 1000.f, (float) window->width / window->height);
+    camera.position = {-GridSize, GridSize / 2.0f, -GridSize};
+    camera.rotation = {-0.4f, 0.78f, 0};
+
+    printf("=== Mesh optimization ===\n");
+    BenchmarkOptimization("Cube",   CreateCubeMesh(&window->persistentArena),     &window->tempArena);
+    BenchmarkOptimization("Plane",  CreatePlaneMesh(&window->persistentArena),    &window->tempArena);
+    BenchmarkOptimization("Sphere", CreateUVSphereMesh(&window->persistentArena), &window->tempArena);
+
+    // Mesh file can be passed as the first argument
+    printf("=== Import ===\n");
+    BenchmarkImport(argc > 1 ? argv[1] : NULL, &window->persistentArena, &window->tempArena);
+
+    printf("=== Generators ===\n");
+    BenchmarkGenerators(&window->tempArena);
+
+    printf("=== Normals ===\n");
+    BenchmarkNormals(&window->tempArena);
+
+    printf("=== Culling ===\n");
+    BenchmarkCulling(&camera, &window->tempArena);
+
+    printf("=== Picking ===\n");
+    BenchmarkPicking(&window->tempArena);
+
+    printf("=== Meshlets ===\n");
+    BenchmarkMeshlets(&camera, &window->tempArena);
+
+    BenchmarkMesh meshes[8] = {};
+
+    meshes[0].name = "Split";
+    meshes[0].meshes[0] = CreateUVSphereMesh(&window->persistentArena);
+
+    meshes[1].name = "Interleaved";
+    meshes[1].meshes[0] = CreateUVSphereMesh(&window->persistentArena);
+    ApplyMesh(&meshes[1].meshes[0], VertexLayout::Interleaved);
+
+    meshes[2].name = "Quantized";
+    meshes[2].meshes[0] = CreateUVSphereMesh(&window->persistentArena);
+    ApplyMesh(&meshes[2].meshes[0], VertexLayout::Quantized);
+
+    meshes[3].name = "Quantized, optimized";
+    meshes[3].meshes[0] = CreateUVSphereMesh(&window->persistentArena);
+    OptimizeMesh(&meshes[3].meshes[0], &window->tempArena);
+    ApplyMesh(&meshes[3].meshes[0], VertexLayout::Quantized);
+
+    meshes[4].name = "Quantized, optimized, LODs";
+    meshes[4].meshes[0] = CreateUVSphereMesh(&window->persistentArena);
+    OptimizeMesh(&meshes[4].meshes[0], &window->tempArena);
+    GenerateLods(&meshes[4].meshes[0], 4, &window->persistentArena);
+    ApplyMesh(&meshes[4].meshes[0], VertexLayout::Quantized);
+
+    for(int i = 0; i < 5; i++) {
+        meshes[i].meshesCount = 1;
+    }
+
+    // Every draw switches the VAO, unless all meshes live in the same geometry heap
+    meshes[5].name = "Mixed meshes";
+    CreateMixedMeshes(&meshes[5], &window->persistentArena);
+    for(int i = 0; i < meshes[5].meshesCount; i++) {
+        ApplyMesh(&meshes[5].meshes[i], VertexLayout::Quantized);
+    }
+
+    meshes[6].name = "Mixed meshes, geometry heap";
+    CreateMixedMeshes(&meshes[6], &window->persistentArena);
+
+    GeometryHeap heap = CreateGeometryHeap(VertexLayout::Quantized, 1 << 16, 1 << 20, &window->persistentArena);
+    for(int i = 0; i < meshes[6].meshesCount; i++) {
+        bool added = AddMeshToHeap(&heap, &meshes[6].meshes[i]);
+        assert(added);
+    }
+
+    // Packed on worker threads, copied to the GPU at most 1MB per frame
+    UploadQueue* uploadQueue = CreateUploadQueue(4 << 20, 1 << 20, &window->persistentArena);
+
+    meshes[7].name = "Mixed meshes, async upload";
+    CreateMixedMeshes(&meshes[7], &window->persistentArena);
+    for(int i = 0; i < meshes[7].meshesCount; i++) {
+        bool queued = QueueMeshUpload(uploadQueue, &meshes[7].meshes[i], VertexLayout::Quantized);
+        assert(queued);
+    }
+
+    int meshesCount = sizeof(meshes) / sizeof(meshes[0]);
+    int current = 0;
+
+    int drawsCount = GridSize * GridSize * GridSize;
+    DrawList drawList = CreateDrawList(drawsCount, &window->persistentArena);
+    bool multiDraw = false;
+
+    Mesh wall = CreateCubeMesh(&window->persistentArena);
+    Matrix wallTransform = MatrixTranslate(GridSize, GridSize, GridSize) * MatrixScale(1, GridSize * 2.0f, GridSize * 2.0f);
+    ApplyMesh(&wall);
+
+    OcclusionBuffer occlusionBuffer = CreateOcclusionBuffer(256, 128, 1024, &window->persistentArena);
+    bool occlusion = false;
+
+    FaceCulling(window, true);
+    DepthTest(window, true);
+
+    while(ShouldClose(window) == false) {
+        FrameStart(window);
+        ClearColorAndDepthBuffer({0.2f, 0.2f, 0.25f, 1});
+
+        camera.aspect = (float) window->width / window->height;
+        MoveCamera(&camera, window);
+
+        ProcessUploads(uploadQueue);
+
+        if(GetKeyState(window, KEY_TAB) == KeyState::JustPressed) {
+            current = (current + 1) % meshesCount;
+
+            // Skip meshes still uploading
+            if(GetPendingUploadsCount(uploadQueue) > 0 && current == 7) {
+                current = 0;
+            }
+        }
+
+        if(GetKeyState(window, KEY_M) == KeyState::JustPressed) {
+            multiDraw = !multiDraw;
+        }
+
+        if(GetKeyState(window, KEY_O) == KeyState::JustPressed) {
+            occlusion = !occlusion;
+        }
+
+        UseShader(window, multiDraw ? MultiDrawVertexColorShader : VertexColorShader);
+
+        BenchmarkMesh* benchmark = meshes + current;
+        Mesh mesh = benchmark->meshes[0];
+
+        // DrawMesh culls by itself, draw list is culled here
+        Frustum frustum = GetCameraFrustum(&camera);
+
+        if(multiDraw) {
+            Slice<BoundingBox> worldBounds = PushSliceToArena<BoundingBox>(&window->tempArena, drawsCount);
+            int32_t* visible = (int32_t*) PushArena(&window->tempArena, drawsCount * sizeof(int32_t));
+            int visibleCount = 0;
+
+            for(int i = 0; i < drawsCount; i++) {
+                Mesh* drawn = benchmark->meshes + i % benchmark->meshesCount;
+                Matrix transform = GetGridTransform(i);
+
+                BoundingSphere sphere = TransformBoundingSphere(drawn->boundingSphere, transform);
+                if(IsSphereInFrustum(&frustum, sphere.center, sphere.radius) == false) {
+                    continue;
+                }
+
+                Vector3 extent = {sphere.radius, sphere.radius, sphere.radius};
+                worldBounds[i] = {sphere.center - extent, sphere.center + extent};
+                visible[visibleCount++] = i;
+            }
+
+            if(occlusion) {
+                BeginOcclusion(&occlusionBuffer, GetVPMatrix(&camera));
+                AddOccluder(&occlusionBuffer, &wall, wallTransform);
+                RasterizeOccluders(window, &occlusionBuffer);
+
+                visibleCount = CullOccluded(window, &occlusionBuffer, worldBounds, visible, visibleCount);
+            }
+
+            for(int i = 0; i < visibleCount; i++) {
+                Mesh* drawn = benchmark->meshes + visible[i] % benchmark->meshesCount;
+                Matrix transform = GetGridTransform(visible[i]);
+
+                PushDraw(&drawList, drawn, transform, SelectMeshLod(window, drawn, &camera, transform));
+            }
+
+            SubmitDrawList(window, &drawList, camera);
+        }
+        else {
+            for(int i = 0; i < drawsCount; i++) {
+                Mesh* drawn = benchmark->meshes + i % benchmark->meshesCount;
+                DrawMesh(window, *drawn, camera, GetGridTransform(i));
+            }
+        }
+
+        if(multiDraw && occlusion) {
+            UseShader(window, VertexColorShader);
+            DrawMesh(window, wall, camera, wallTransform);
+        }
+
+        ShowFrameTime(window, {10, 10});
+
+        ImGui::SetNextWindowPos(ImVec2(10, 120));
+        ImGui::Begin("Benchmark", NULL, ImGuiWindowFlags_AlwaysAutoResize | ImGuiWindowFlags_NoSavedSettings);
+        ImGui::Text("Mesh: %s (TAB to switch)", meshes[current].name);
+
+        // Split layout uses the same attribute types as Interleaved
+        VertexLayout layout = mesh.layout == VertexLayout::Split ? VertexLayout::Interleaved : mesh.layout;
+        ImGui::Text("Vertex size: %d bytes", GetVertexFormat(&mesh, layout).stride);
+        ImGui::Text("Index size: %d bytes", GetGLTypeSize(mesh.indexType));
+        ImGui::Text("LODs: %d", mesh.lodCount);
+        ImGui::Text("Draws: %d", GridSize * GridSize * GridSize);
+        ImGui::Text("Heap: %s", mesh.heap ? "yes" : "no");
+        ImGui::Text("Pending uploads: %d", GetPendingUploadsCount(uploadQueue));
+        ImGui::Text("Multi draw: %s (M to toggle)", multiDraw ? "yes" : "no");
+        ImGui::Text("Occlusion: %s (O to toggle)", multiDraw && occlusion ? "yes" : "no");
+        ImGui::End();
+
+        FrameEnd(window);
+    }
+
+    return 0;
+}
@@ -1,4 +1,4 @@
-#version 330 core
+#version 430 core
 
 out vec4 FragColor;
 
@@ -6,13 +6,15 @@ in vec3 worldPos;
 in vec3 normal;
 in vec2 uv;
 
-uniform vec3 cameraPos;
+#include "SimpleRenderer/FrameData.glsl"
 
 // material definition
-uniform vec3 albedo;
-uniform vec3 diffuse;
-uniform vec3 specular;
-uniform float shiness;
+layout (std140) uniform MaterialData {
+    vec3 albedo;
+    vec3 diffuse;
+    vec3 specular;
+    float shiness;
+};
 
 // lights
 uniform vec4 ambientColor;
@@ -32,7 +34,7 @@ vec3 DirectionalLight(vec3 direction, vec3 lightColor) {
     float ndotl = max(0, dot(dir, norm));
     vec3 diffuse = ndotl * diffuse.rgb * lightColor.rgb;
 
-    vec3 viewDir = normalize(worldPos - cameraPos);
+    vec3 viewDir = normalize(worldPos - frame.cameraPosition.xyz);
     vec3 reflectDir = reflect(dir, norm);
     float vdotr = max(dot(viewDir, reflectDir), 0);
     vec3 spec = specular.rgb * pow(vdotr, shiness) * lightColor;
@@ -49,7 +51,7 @@ vec3 PointLight(vec3 position, vec3 lightColor) {
     float ndotl = max(0, dot(dir, norm));
     vec3 diffuse = ndotl * diffuse.rgb * lightColor.rgb;
 
-    vec3 viewDir = normalize(worldPos - cameraPos);
+    vec3 viewDir = normalize(worldPos - frame.cameraPosition.xyz);
     vec3 reflectDir = reflect(dir, norm);
     float vdotr = max(dot(viewDir, reflectDir), 0);
     vec3 spec = specular.rgb * pow(vdotr, shiness) * lightColor;
@@ -42,7 +42,7 @@ int main() {
     AddUniform(&mat, Str8Lit("specular"), UniformType::Vec3,  {1, 0.4f, 1});
     AddUniform(&mat, Str8Lit("shiness"),  UniformType::Float, {32.f});
 
-    Material mat2 = mat;
+    Material mat2 = CopyMaterial(&mat);
     SetUniformValue(&mat2, Str8Lit("albedo"), {0.1f, 0.1f, 0.1f});
 
     FaceCulling(window, true);
@@ -57,18 +57,13 @@ int main() {
         MoveCamera(&camera, window);
         pointLightPos = Vector3RotateByAxisAngle({-2, 1, 4}, {0, 1, 0}, window->timeSinceStart);
 
-        SetShaderUniform(window, "cameraPos", camera.position);
         SetShaderUniform(window, "pointLightPos", pointLightPos);
 
-        Matrix vp = GetVPMatrix(&camera);
-
         UseMaterial(window, &mat);
-        SetShaderUniform(window, "model", sphereTransform);
-        DrawMesh(window, sphere, vp * sphereTransform);
+        DrawMesh(window, sphere, camera, sphereTransform);
 
         UseMaterial(window, &mat2);
-        SetShaderUniform(window, "model", planeTransform);
-        DrawMesh(window, plane, vp * planeTransform);
+        DrawMesh(window, plane, camera, planeTransform);
 
         if(ImGui::ColorPicker3("Point light Color", (float*) &pointLightColor, ImGuiColorEditFlags_PickerHueWheel)) {
             SetShaderUniform(window, "pointLightColor", pointLightColor);
@@ -1,4 +1,4 @@
-#version 330 core
+#version 430 core
 
 layout (location = 0) in vec3 aPos;
 layout (location = 1) in vec3 aNorm;
@@ -8,13 +8,14 @@ out vec3 worldPos;
 out vec3 normal;
 out vec2 uv;
 
+#include "SimpleRenderer/FrameData.glsl"
+
 uniform mat4 model;
-uniform mat4 MVP;
 
 void main() {
     worldPos = (model * vec4(aPos, 1.0)).xyz;
     normal = aNorm;
     uv = aUV;
 
-    gl_Position = MVP * vec4(aPos, 1.0);
+    gl_Position = frame.viewProjection * model * vec4(aPos, 1.0);
 }
\ No newline at end of file
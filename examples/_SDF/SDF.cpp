@@ -37,8 +37,6 @@ int main() {
     Vector3 lightRotation = {0, 0, 0};
 
     UseShader(window, shader);
-    Vector2 r = {(float)window->width, (float)window->height};
-    SetShaderUniform(window, "resolution", r);
     SetShaderUniform(window, "albedo",     albedo);
     SetShaderUniform(window, "lightColor", lightColor);
     SetShaderUniform(window, "lightDir",   lightDir);
@@ -49,7 +47,6 @@ int main() {
         
         if(ReloadShaderIfNecessary(&shader, &window->tempArena)) {
             UseShader(window, shader);
-            SetShaderUniform(window, "resolution", r);
             SetShaderUniform(window, "albedo",     albedo);
             SetShaderUniform(window, "lightColor", lightColor);
             SetShaderUniform(window, "lightDir",   lightDir);
@@ -83,21 +80,16 @@ int main() {
         camera.aspect = (float) window->width / window->height;
         MoveCamera(&camera, window);
 
-        Matrix vp = GetVPMatrix(&camera);
-
         // Rendering
         UseShader(window, ColorShader);
-        DrawMesh(window, plane, vp * planeTransform);
+        DrawMesh(window, plane, camera, planeTransform);
 
         UseShader(window, shader);
 
-        SetShaderUniform(window, "cameraPos", camera.position);
         SetShaderUniform(window, "viewTarget", camera.position + GetCameraForward(&camera));
         SetShaderUniform(window, "viewUp", GetCameraUp(&camera));
-        SetShaderUniform(window, "viewMatrix", GetView(&camera));
-        SetShaderUniform(window, "iTime", (float)window->timeSinceStart);
-        
-        DrawMesh(window, cube, vp * cubeTransform);
+
+        DrawMesh(window, cube, camera, cubeTransform);
 
         FrameEnd(window);
     }
@@ -1,14 +1,11 @@
-#version 330 core
+#version 430 core
 
-uniform vec2 resolution;
-uniform vec3 cameraPos;
+#include "SimpleRenderer/FrameData.glsl"
 
 // uniform mat4 viewMatrix;
 uniform vec3 viewTarget;
 uniform vec3 viewUp;
 
-uniform float iTime;
-
 uniform vec3 lightDir;
 uniform vec3 albedo;
 uniform vec3 lightColor;
@@ -29,7 +26,7 @@ float opSmoothUnion(float d1, float d2, float k) {
 }
 
 float sceneSDF(vec3 point) {
-    float t = iTime * 0.7;
+    float t = frame.time.x * 0.7;
     vec3 s1Pos = vec3(0.0, sin(t)         + 4, 0.0);
     vec3 s2Pos = vec3(0.5, sin(t - 60.0)  + 4 , 0.0);
     vec3 s3Pos = vec3(-0.2, sin(t - 90.0) + 4, 0.0);
@@ -90,7 +87,7 @@ vec3 DirectionalLight(vec3 worldPos, vec3 normal, vec3 lightDir) {
     float ndotl = max(0, dot(lightDir, normal));
     vec3 diffuse = ndotl * lightColor * 2;
 
-    vec3 viewDir = normalize(worldPos - cameraPos);
+    vec3 viewDir = normalize(worldPos - frame.cameraPosition.xyz);
     vec3 reflectDir = reflect(lightDir, normal);
     float spec = pow(max(dot(viewDir, reflectDir), 0.0), 4);
     vec3 specular = 0.3 * spec * lightColor;
@@ -103,20 +100,20 @@ void main() {
     vec3 p = clipSpacePos.xyz / clipSpacePos.w;
     p = p * 0.5 + 0.5;
 
-    vec2 fragCoord = p.xy * resolution;
-    vec3 dir = -rayDirection(60, resolution, fragCoord);
+    vec2 fragCoord = p.xy * frame.resolution.xy;
+    vec3 dir = -rayDirection(60, frame.resolution.xy, fragCoord);
 
-    mat4 cam = ViewMatrix(cameraPos, viewTarget, viewUp);
+    mat4 cam = ViewMatrix(frame.cameraPosition.xyz, viewTarget, viewUp);
     dir = (cam * vec4(dir, 0.0)).xyz;
 
-    float dist = rayMarch(cameraPos, dir, 0.0, 100.0);
+    float dist = rayMarch(frame.cameraPosition.xyz, dir, 0.0, 100.0);
 
     if(dist > 100.0 - EPSILON) {
         FragColor = vec4(p.xy, 0.0, 0.0);
         return;
     }
 
-    vec3 hitPoint = cameraPos + dist * dir;
+    vec3 hitPoint = frame.cameraPosition.xyz + dist * dir;
     vec3 normal = normal(hitPoint);
 
     vec3 col = DirectionalLight(hitPoint, normal, lightDir);
@@ -1,4 +1,4 @@
-#version 330 core
+#version 430 core
 
 layout (location = 0) in vec3 aPos;
 layout (location = 1) in vec3 aNorm;
@@ -6,9 +6,11 @@ layout (location = 2) in vec2 aUV;
 
 out vec4 clipSpacePos;
 
-uniform mat4 MVP;
+#include "SimpleRenderer/FrameData.glsl"
+
+uniform mat4 model;
 
 void main() {
-    gl_Position = MVP * vec4(aPos, 1.0);
+    gl_Position = frame.viewProjection * model * vec4(aPos, 1.0);
     clipSpacePos = gl_Position;
 }
\ No newline at end of file
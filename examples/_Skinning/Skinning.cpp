@@ -0,0 +1,163 @@
+#ifdef UNITY_BUILD
+#include "../../src/unity.cpp"
+#endif
+
+#include "../common/CameraMovement.cpp"
+
+// Grid of animated tentacles, every one blends two clips with its own weight.
+// Palettes of all instances are evaluated in one batch and drawn with a single call.
+// Press SPACE to pause the animation.
+
+const int GridSize = 24;
+const int InstancesCount = GridSize * GridSize;
+
+const int JointsCount = 8;
+const float TentacleHeight = 4.0f;
+const float JointLength = TentacleHeight / JointsCount;
+
+// Chain of joints along the Y axis, every joint is placed at the start of its segment
+Skeleton CreateTentacleSkeleton(Pose* bindPose, MemoryArena* arena, MemoryArena* tempArena) {
+    Skeleton skeleton = CreateSkeleton(JointsCount, arena);
+    *bindPose = CreatePose(JointsCount, arena);
+
+    for(int i = 0; i < JointsCount; i++) {
+        skeleton.parents[i] = i - 1;
+
+        Vector3 translation = i == 0 ? Vector3{0, -TentacleHeight / 2.0f, 0} : Vector3{0, JointLength, 0};
+        SetJointPose(bindPose, i, translation, QuaternionIdentity());
+    }
+
+    CalculateInverseBindMatrices(&skeleton, bindPose, tempArena);
+    return skeleton;
+}
+
+// Vertices are weighted between the two closest joints
+Mesh CreateTentacleMesh(MemoryArena* arena) {
+    Mesh mesh = CreateCylinderMesh(arena, 16, JointsCount * 2, 0.25f, TentacleHeight);
+
+    mesh.joints  = PushSliceToArena<JointIndices>(arena, mesh.vertices.length);
+    mesh.weights = PushSliceToArena<Vector4>(arena, mesh.vertices.length);
+
+    for(int i = 0; i < mesh.vertices.length; i++) {
+        float position = (mesh.vertices[i].y + TentacleHeight / 2.0f) / JointLength - 0.5f;
+        position = Clamp(position, 0, JointsCount - 1);
+
+        int first = (int) position;
+        int second = first + 1 < JointsCount ? first + 1 : first;
+        float weight = position - first;
+
+        mesh.joints[i]  = {{(uint8_t) first, (uint8_t) second, 0, 0}};
+        mesh.weights[i] = {1 - weight, weight, 0, 0};
+    }
+
+    ApplyMesh(&mesh, VertexLayout::Quantized);
+    return mesh;
+}
+
+// Looped clip, every joint rotates around the axis with the phase shifted along the chain
+AnimationClip CreateWaveClip(Pose* bindPose, Vector3 axis, float amplitude, float phaseShift, MemoryArena* arena) {
+    int framesCount = 33;
+    AnimationClip clip = CreateAnimationClip(JointsCount, framesCount, 16, arena);
+
+    for(int frame = 0; frame < framesCount; frame++) {
+        Pose* pose = clip.frames + frame;
+        CopyPose(pose, bindPose);
+
+        // Last frame is the same as the first one
+        float phase = 2 * PI * frame / (framesCount - 1);
+
+        for(int i = 1; i < JointsCount; i++) {
+            float angle = amplitude * sinf(phase + i * phaseShift);
+            Vector3 translation = {0, JointLength, 0};
+
+            SetJointPose(pose, i, translation, QuaternionFromAxisAngle(axis, angle));
+        }
+    }
+
+    return clip;
+}
+
+int main() {
+    SRWindow* window = InitializeWindow(Str8Lit("Skinning"));
+
+    Camera camera = CreatePerspective(60, 0.01f, 1000.f, (float) window->width / window->height);
+    camera.position = {-GridSize * 0.5f, GridSize * 0.4f, -GridSize * 0.5f};
+    camera.rotation = {-0.4f, 0.78f, 0};
+
+    MemoryArena* arena = &window->persistentArena;
+
+    Pose bindPose;
+    Skeleton skeleton = CreateTentacleSkeleton(&bindPose, arena, &window->tempArena);
+    Mesh tentacle = CreateTentacleMesh(arena);
+
+    AnimationClip wave  = CreateWaveClip(&bindPose, {0, 0, 1}, 0.35f, 0.6f, arena);
+    AnimationClip sweep = CreateWaveClip(&bindPose, {1, 0, 0}, 0.25f, 0.3f, arena);
+
+    Slice<AnimationInstance> instances = PushSliceToArena<AnimationInstance>(arena, InstancesCount);
+    Slice<Matrix> transforms = PushSliceToArena<Matrix>(arena, InstancesCount);
+    Slice<Vector4> colors = PushSliceToArena<Vector4>(arena, InstancesCount);
+    Slice<Matrix> palettes = PushSliceToArena<Matrix>(arena, InstancesCount * JointsCount);
+
+    for(int i = 0; i < InstancesCount; i++) {
+        float x = (float) (i % GridSize);
+        float z = (float) (i / GridSize);
+
+        transforms[i] = MatrixTranslate(x * 1.5f, TentacleHeight / 2.0f, z * 1.5f);
+        colors[i] = {0.4f + 0.6f * x / GridSize, 0.5f, 0.4f + 0.6f * z / GridSize, 1};
+
+        AnimationInstance* instance = instances.data + i;
+        instance->clip = &wave;
+        instance->time = 0.13f * i;
+        instance->blendClip = &sweep;
+        instance->blendTime = 0.07f * i;
+        instance->blendWeight = 0.5f + 0.5f * sinf((float) i);
+    }
+
+    bool paused = false;
+
+    FaceCulling(window, true);
+    DepthTest(window, true);
+
+    UseShader(window, SkinnedColorShader);
+
+    while(ShouldClose(window) == false) {
+        FrameStart(window);
+        ClearColorAndDepthBuffer({0.2f, 0.2f, 0.25f, 1});
+
+        camera.aspect = (float) window->width / window->height;
+        MoveCamera(&camera, window);
+
+        if(GetKeyState(window, KEY_SPACE) == KeyState::JustPressed) {
+            paused = !paused;
+        }
+
+        double evaluateStart = glfwGetTime();
+
+        if(paused == false) {
+            for(int i = 0; i < InstancesCount; i++) {
+                instances[i].time += window->timeDelta;
+                instances[i].blendTime += window->timeDelta;
+            }
+        }
+
+        EvaluateAnimations(&skeleton, instances, palettes, &window->tempArena);
+
+        double evaluateTime = glfwGetTime() - evaluateStart;
+
+        DrawSkinnedMeshInstanced(window, tentacle, camera, &skeleton, transforms, palettes, colors);
+
+        ShowFrameTime(window, {10, 10});
+
+        ImGui::SetNextWindowPos(ImVec2(10, 120));
+        ImGui::Begin("Skinning", NULL, ImGuiWindowFlags_AlwaysAutoResize | ImGuiWindowFlags_NoSavedSettings);
+        ImGui::Text("Instances: %d", InstancesCount);
+        ImGui::Text("Joints: %d", InstancesCount * JointsCount);
+        ImGui::Text("Evaluation: %.3f ms", evaluateTime * 1000);
+        ImGui::Text("Paused: %s (SPACE to toggle)", paused ? "yes" : "no");
+        ImGui::End();
+
+        FrameEnd(window);
+    }
+
+    return 0;
+}
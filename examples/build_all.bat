@@ -3,6 +3,8 @@
 set projects=01_HelloTriangle
 set projects=%projects%;02_HelloQuad
 set projects=%projects%;03_szescian_cpp
+set projects=%projects%;_MeshBenchmark
+set projects=%projects%;_Skinning
 
 for %%p in (%projects%) do (
     pushd %%p
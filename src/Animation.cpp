@@ -0,0 +1,354 @@
+#include "SimpleRenderer.h"
+
+#include <string.h>
+#include <xmmintrin.h> // SSE
+
+//========================================
+// Skeletal animation
+//========================================
+
+static int GetPaddedJointsCount(int jointsCount) {
+    return (jointsCount + 3) & ~3;
+}
+
+Pose CreatePose(int jointsCount, MemoryArena* arena) {
+    assert(jointsCount > 0 && jointsCount <= MAX_SKELETON_JOINTS);
+
+    int padded = GetPaddedJointsCount(jointsCount);
+    float* data = (float*) PushArena(arena, padded * PoseStreamsCount * sizeof(float));
+
+    Pose pose = {};
+    pose.jointsCount = jointsCount;
+
+    for(int i = 0; i < PoseStreamsCount; i++) {
+        pose.streams[i] = data + i * padded;
+    }
+
+    // Padding joints are identity too, so they don't produce NaNs in the SIMD paths
+    for(int i = 0; i < padded; i++) {
+        pose.streams[PoseRotationW][i] = 1;
+        pose.streams[PoseScaleX][i] = 1;
+        pose.streams[PoseScaleY][i] = 1;
+        pose.streams[PoseScaleZ][i] = 1;
+    }
+
+    return pose;
+}
+
+Skeleton CreateSkeleton(int jointsCount, MemoryArena* arena) {
+    assert(jointsCount > 0 && jointsCount <= MAX_SKELETON_JOINTS);
+
+    Skeleton skeleton = {};
+    skeleton.jointsCount = jointsCount;
+    skeleton.parents = (int32_t*) PushArena(arena, jointsCount * sizeof(int32_t));
+    skeleton.inverseBindMatrices = (Matrix*) PushArena(arena, jointsCount * sizeof(Matrix));
+
+    for(int i = 0; i < jointsCount; i++) {
+        skeleton.parents[i] = -1;
+        skeleton.inverseBindMatrices[i] = MatrixIdentity();
+    }
+
+    return skeleton;
+}
+
+AnimationClip CreateAnimationClip(int jointsCount, int framesCount, float sampleRate, MemoryArena* arena) {
+    assert(framesCount > 0 && sampleRate > 0);
+
+    AnimationClip clip = {};
+    clip.jointsCount = jointsCount;
+    clip.framesCount = framesCount;
+    clip.sampleRate = sampleRate;
+    clip.duration = (framesCount - 1) / sampleRate;
+
+    clip.frames = (Pose*) PushArena(arena, framesCount * sizeof(Pose));
+    for(int i = 0; i < framesCount; i++) {
+        clip.frames[i] = CreatePose(jointsCount, arena);
+    }
+
+    return clip;
+}
+
+void SetJointPose(Pose* pose, int joint, Vector3 translation, Quaternion rotation, Vector3 scale) {
+    assert(joint >= 0 && joint < pose->jointsCount);
+
+    float values[PoseStreamsCount] = {
+        translation.x, translation.y, translation.z,
+        rotation.x, rotation.y, rotation.z, rotation.w,
+        scale.x, scale.y, scale.z,
+    };
+
+    for(int i = 0; i < PoseStreamsCount; i++) {
+        pose->streams[i][joint] = values[i];
+    }
+}
+
+void CopyPose(Pose* dest, Pose* source) {
+    assert(dest->jointsCount == source->jointsCount);
+
+    int padded = GetPaddedJointsCount(source->jointsCount);
+    for(int i = 0; i < PoseStreamsCount; i++) {
+        memcpy(dest->streams[i], source->streams[i], padded * sizeof(float));
+    }
+}
+
+void BlendPoses(Pose* outPose, Pose* a, Pose* b, float weight) {
+    assert(a->jointsCount == b->jointsCount && outPose->jointsCount == a->jointsCount);
+
+    int padded = GetPaddedJointsCount(a->jointsCount);
+
+    __m128 w = _mm_set1_ps(weight);
+    __m128 oneMinusW = _mm_set1_ps(1 - weight);
+    __m128 signMask = _mm_set1_ps(-0.0f);
+
+    // Translation and scale are lerped
+    const int linearStreams[6] = {
+        PoseTranslationX, PoseTranslationY, PoseTranslationZ,
+        PoseScaleX, PoseScaleY, PoseScaleZ,
+    };
+
+    for(int j = 0; j < padded; j += 4) {
+        for(int i = 0; i < 6; i++) {
+            int s = linearStreams[i];
+
+            __m128 va = _mm_loadu_ps(a->streams[s] + j);
+            __m128 vb = _mm_loadu_ps(b->streams[s] + j);
+            _mm_storeu_ps(outPose->streams[s] + j, _mm_add_ps(va, _mm_mul_ps(_mm_sub_ps(vb, va), w)));
+        }
+
+        // Rotations, q and -q are the same rotation, so b is negated when quaternions
+        // are in the opposite hemispheres to take the shortest path
+        __m128 ax = _mm_loadu_ps(a->streams[PoseRotationX] + j);
+        __m128 ay = _mm_loadu_ps(a->streams[PoseRotationY] + j);
+        __m128 az = _mm_loadu_ps(a->streams[PoseRotationZ] + j);
+        __m128 aw = _mm_loadu_ps(a->streams[PoseRotationW] + j);
+
+        __m128 bx = _mm_loadu_ps(b->streams[PoseRotationX] + j);
+        __m128 by = _mm_loadu_ps(b->streams[PoseRotationY] + j);
+        __m128 bz = _mm_loadu_ps(b->streams[PoseRotationZ] + j);
+        __m128 bw = _mm_loadu_ps(b->streams[PoseRotationW] + j);
+
+        __m128 dot = _mm_add_ps(_mm_add_ps(_mm_mul_ps(ax, bx), _mm_mul_ps(ay, by)),
+                                _mm_add_ps(_mm_mul_ps(az, bz), _mm_mul_ps(aw, bw)));
+
+        __m128 bWeight = _mm_xor_ps(w, _mm_and_ps(dot, signMask));
+
+        __m128 rx = _mm_add_ps(_mm_mul_ps(ax, oneMinusW), _mm_mul_ps(bx, bWeight));
+        __m128 ry = _mm_add_ps(_mm_mul_ps(ay, oneMinusW), _mm_mul_ps(by, bWeight));
+        __m128 rz = _mm_add_ps(_mm_mul_ps(az, oneMinusW), _mm_mul_ps(bz, bWeight));
+        __m128 rw = _mm_add_ps(_mm_mul_ps(aw, oneMinusW), _mm_mul_ps(bw, bWeight));
+
+        __m128 lengthSq = _mm_add_ps(_mm_add_ps(_mm_mul_ps(rx, rx), _mm_mul_ps(ry, ry)),
+                                     _mm_add_ps(_mm_mul_ps(rz, rz), _mm_mul_ps(rw, rw)));
+        __m128 invLength = _mm_div_ps(_mm_set1_ps(1), _mm_sqrt_ps(lengthSq));
+
+        _mm_storeu_ps(outPose->streams[PoseRotationX] + j, _mm_mul_ps(rx, invLength));
+        _mm_storeu_ps(outPose->streams[PoseRotationY] + j, _mm_mul_ps(ry, invLength));
+        _mm_storeu_ps(outPose->streams[PoseRotationZ] + j, _mm_mul_ps(rz, invLength));
+        _mm_storeu_ps(outPose->streams[PoseRotationW] + j, _mm_mul_ps(rw, invLength));
+    }
+}
+
+void SampleClip(AnimationClip* clip, float time, bool loop, Pose* outPose) {
+    assert(clip->jointsCount == outPose->jointsCount);
+
+    if(clip->framesCount == 1 || clip->duration <= 0) {
+        CopyPose(outPose, clip->frames);
+        return;
+    }
+
+    if(loop) {
+        time = fmodf(time, clip->duration);
+        if(time < 0) {
+            time += clip->duration;
+        }
+    }
+    else {
+        time = Clamp(time, 0, clip->duration);
+    }
+
+    float frame = time * clip->sampleRate;
+    int first = (int) frame;
+    if(first >= clip->framesCount - 1) {
+        CopyPose(outPose, clip->frames + clip->framesCount - 1);
+        return;
+    }
+
+    BlendPoses(outPose, clip->frames + first, clip->frames + first + 1, frame - first);
+}
+
+// Builds local matrices of 4 joints at once from the SoA streams, and transposes
+// them into the regular column major layout
+static void CalculateLocalMatrices(Pose* pose, Matrix* locals) {
+    int padded = GetPaddedJointsCount(pose->jointsCount);
+
+    __m128 one = _mm_set1_ps(1);
+    __m128 two = _mm_set1_ps(2);
+
+    for(int j = 0; j < padded; j += 4) {
+        __m128 tx = _mm_loadu_ps(pose->streams[PoseTranslationX] + j);
+        __m128 ty = _mm_loadu_ps(pose->streams[PoseTranslationY] + j);
+        __m128 tz = _mm_loadu_ps(pose->streams[PoseTranslationZ] + j);
+
+        __m128 x = _mm_loadu_ps(pose->streams[PoseRotationX] + j);
+        __m128 y = _mm_loadu_ps(pose->streams[PoseRotationY] + j);
+        __m128 z = _mm_loadu_ps(pose->streams[PoseRotationZ] + j);
+        __m128 w = _mm_loadu_ps(pose->streams[PoseRotationW] + j);
+
+        __m128 sx = _mm_loadu_ps(pose->streams[PoseScaleX] + j);
+        __m128 sy = _mm_loadu_ps(pose->streams[PoseScaleY] + j);
+        __m128 sz = _mm_loadu_ps(pose->streams[PoseScaleZ] + j);
+
+        __m128 xx = _mm_mul_ps(x, x), yy = _mm_mul_ps(y, y), zz = _mm_mul_ps(z, z);
+        __m128 xy = _mm_mul_ps(x, y), xz = _mm_mul_ps(x, z), yz = _mm_mul_ps(y, z);
+        __m128 wx = _mm_mul_ps(w, x), wy = _mm_mul_ps(w, y), wz = _mm_mul_ps(w, z);
+
+        // Rotation matrix columns scaled by the scale of their axis
+        __m128 columns[4][4];
+
+        columns[0][0] = _mm_mul_ps(_mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(yy, zz))), sx);
+        columns[0][1] = _mm_mul_ps(_mm_mul_ps(two, _mm_add_ps(xy, wz)), sx);
+        columns[0][2] = _mm_mul_ps(_mm_mul_ps(two, _mm_sub_ps(xz, wy)), sx);
+        columns[0][3] = _mm_setzero_ps();
+
+        columns[1][0] = _mm_mul_ps(_mm_mul_ps(two, _mm_sub_ps(xy, wz)), sy);
+        columns[1][1] = _mm_mul_ps(_mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(xx, zz))), sy);
+        columns[1][2] = _mm_mul_ps(_mm_mul_ps(two, _mm_add_ps(yz, wx)), sy);
+        columns[1][3] = _mm_setzero_ps();
+
+        columns[2][0] = _mm_mul_ps(_mm_mul_ps(two, _mm_add_ps(xz, wy)), sz);
+        columns[2][1] = _mm_mul_ps(_mm_mul_ps(two, _mm_sub_ps(yz, wx)), sz);
+        columns[2][2] = _mm_mul_ps(_mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(xx, yy))), sz);
+        columns[2][3] = _mm_setzero_ps();
+
+        columns[3][0] = tx;
+        columns[3][1] = ty;
+        columns[3][2] = tz;
+        columns[3][3] = one;
+
+        for(int c = 0; c < 4; c++) {
+            // After the transpose every register holds this column of one joint
+            _MM_TRANSPOSE4_PS(columns[c][0], columns[c][1], columns[c][2], columns[c][3]);
+
+            for(int k = 0; k < 4; k++) {
+                _mm_storeu_ps((float*) (locals + j + k) + c * 4, columns[c][k]);
+            }
+        }
+    }
+}
+
+// out = a * b, out can't alias the inputs
+static void MultiplyJointMatrices(const Matrix* a, const Matrix* b, Matrix* out) {
+    const float* af = (const float*) a;
+    const float* bf = (const float*) b;
+    float* outf = (float*) out;
+
+    __m128 a0 = _mm_loadu_ps(af + 0);
+    __m128 a1 = _mm_loadu_ps(af + 4);
+    __m128 a2 = _mm_loadu_ps(af + 8);
+    __m128 a3 = _mm_loadu_ps(af + 12);
+
+    for(int c = 0; c < 4; c++) {
+        const float* column = bf + c * 4;
+
+        __m128 result = _mm_mul_ps(a0, _mm_set1_ps(column[0]));
+        result = _mm_add_ps(result, _mm_mul_ps(a1, _mm_set1_ps(column[1])));
+        result = _mm_add_ps(result, _mm_mul_ps(a2, _mm_set1_ps(column[2])));
+        result = _mm_add_ps(result, _mm_mul_ps(a3, _mm_set1_ps(column[3])));
+
+        _mm_storeu_ps(outf + c * 4, result);
+    }
+}
+
+// Model space transforms of the joints, padded to a multiple of 4
+static Matrix* CalculateModelSpaceJoints(Skeleton* skeleton, Pose* pose, MemoryArena* tempArena) {
+    assert(skeleton->jointsCount == pose->jointsCount);
+
+    Matrix* locals = (Matrix*) PushArena(tempArena, GetPaddedJointsCount(pose->jointsCount) * sizeof(Matrix));
+    CalculateLocalMatrices(pose, locals);
+
+    // In place, parents are always already in the model space
+    for(int i = 0; i < skeleton->jointsCount; i++) {
+        int32_t parent = skeleton->parents[i];
+        assert(parent < i);
+
+        if(parent >= 0) {
+            Matrix local = locals[i];
+            MultiplyJointMatrices(locals + parent, &local, locals + i);
+        }
+    }
+
+    return locals;
+}
+
+void CalculateInverseBindMatrices(Skeleton* skeleton, Pose* bindPose, MemoryArena* tempArena) {
+    uint64_t tempPos = GetArenaPos(tempArena);
+
+    Matrix* joints = CalculateModelSpaceJoints(skeleton, bindPose, tempArena);
+    for(int i = 0; i < skeleton->jointsCount; i++) {
+        skeleton->inverseBindMatrices[i] = MatrixInvert(joints[i]);
+    }
+
+    PopArenaTo(tempArena, tempPos);
+}
+
+void CalculateJointPalette(Skeleton* skeleton, Pose* pose, Matrix* palette, MemoryArena* tempArena) {
+    uint64_t tempPos = GetArenaPos(tempArena);
+
+    Matrix* joints = CalculateModelSpaceJoints(skeleton, pose, tempArena);
+    for(int i = 0; i < skeleton->jointsCount; i++) {
+        MultiplyJointMatrices(joints + i, skeleton->inverseBindMatrices + i, palette + i);
+    }
+
+    PopArenaTo(tempArena, tempPos);
+}
+
+void EvaluateAnimations(Skeleton* skeleton, Slice<AnimationInstance> instances, Slice<Matrix> palettes, MemoryArena* tempArena) {
+    int jointsCount = skeleton->jointsCount;
+    assert(palettes.length >= instances.length * jointsCount);
+
+    uint64_t tempPos = GetArenaPos(tempArena);
+
+    // Poses are reused by all instances
+    Pose pose = CreatePose(jointsCount, tempArena);
+    Pose blendPose = CreatePose(jointsCount, tempArena);
+
+    for(int i = 0; i < instances.length; i++) {
+        AnimationInstance* instance = instances.data + i;
+
+        SampleClip(instance->clip, instance->time, true, &pose);
+
+        if(instance->blendClip && instance->blendWeight > 0) {
+            SampleClip(instance->blendClip, instance->blendTime, true, &blendPose);
+            BlendPoses(&pose, &pose, &blendPose, instance->blendWeight);
+        }
+
+        CalculateJointPalette(skeleton, &pose, palettes.data + i * jointsCount, tempArena);
+    }
+
+    PopArenaTo(tempArena, tempPos);
+}
+
+void DrawSkinnedMeshInstanced(SRWindow* window, Mesh mesh, Camera camera, Skeleton* skeleton, Slice<Matrix> transforms,
+                              Slice<Matrix> palettes, Slice<Vector4> colors) {
+    // Joints and weights aren't stored in the GeometryHeap
+    assert(mesh.heap == NULL);
+    assert(palettes.length == transforms.length * skeleton->jointsCount);
+
+    if(transforms.length == 0) {
+        return;
+    }
+
+    if(window->jointPaletteBuffer == 0) {
+        glCreateBuffers(1, &window->jointPaletteBuffer);
+    }
+
+    // @NOTE: respecified every call, like the instance buffer in DrawMeshInstanced
+    glNamedBufferData(window->jointPaletteBuffer, palettes.length * sizeof(Matrix), palettes.data, GL_STREAM_DRAW);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, JOINT_PALETTE_BINDING, window->jointPaletteBuffer);
+
+    int jointsCountLoc = GetShaderUniformLocation(&window->currentShader, "jointsCount");
+    if(jointsCountLoc != -1)
+        glUniform1i(jointsCountLoc, skeleton->jointsCount);
+
+    DrawMeshInstanced(window, mesh, camera, transforms, colors);
+}
@@ -0,0 +1,589 @@
+#include "SimpleRenderer.h"
+
+#include <float.h>
+#include <string.h>
+
+//========================================
+// BVH
+//========================================
+
+#define BVH_BINS 16
+#define BVH_MAX_LEAF_SIZE 4
+
+// SAH costs, relative to one object bounds test
+#define BVH_TRAVERSAL_COST 1.0f
+#define BVH_INTERSECTION_COST 1.0f
+
+struct BvhBin {
+    BoundingBox bounds;
+    int count;
+};
+
+// Objects are partitioned together with their bounds during the build, so the
+// data of every node stays contiguous in memory
+struct BvhBuildItem {
+    BoundingBox bounds;
+    Vector3 centroid;
+    int32_t object;
+};
+
+static BoundingBox EmptyBounds() {
+    return {{FLT_MAX, FLT_MAX, FLT_MAX}, {-FLT_MAX, -FLT_MAX, -FLT_MAX}};
+}
+
+// @NOTE: plain comparisons instead of fminf/fmaxf, they compile to single min/max instructions
+static BoundingBox MergeBounds(BoundingBox a, BoundingBox b) {
+    BoundingBox ret;
+    ret.min.x = a.min.x < b.min.x ? a.min.x : b.min.x;
+    ret.min.y = a.min.y < b.min.y ? a.min.y : b.min.y;
+    ret.min.z = a.min.z < b.min.z ? a.min.z : b.min.z;
+    ret.max.x = a.max.x > b.max.x ? a.max.x : b.max.x;
+    ret.max.y = a.max.y > b.max.y ? a.max.y : b.max.y;
+    ret.max.z = a.max.z > b.max.z ? a.max.z : b.max.z;
+    return ret;
+}
+
+static float BoundsArea(BoundingBox bounds) {
+    Vector3 size = bounds.max - bounds.min;
+    return 2.0f * (size.x * size.y + size.y * size.z + size.z * size.x);
+}
+
+static float GetAxis(Vector3 v, int axis) {
+    return axis == 0 ? v.x : axis == 1 ? v.y : v.z;
+}
+
+static void UpdateNodeBounds(Bvh* bvh, BvhNode* node) {
+    node->bounds = EmptyBounds();
+    for(int i = node->first; i < node->first + node->count; i++) {
+        node->bounds = MergeBounds(node->bounds, bvh->objectBounds[bvh->objectIndices[i]]);
+    }
+}
+
+static void UpdateNodeBounds(BvhNode* node, BvhBuildItem* items) {
+    node->bounds = EmptyBounds();
+    for(int i = node->first; i < node->first + node->count; i++) {
+        node->bounds = MergeBounds(node->bounds, items[i].bounds);
+    }
+}
+
+// Binned SAH split along the longest centroid axis. Returns false if keeping the leaf is cheaper.
+static bool FindSplit(BvhNode* node, BvhBuildItem* items, int* splitAxis, float* splitPosition) {
+    BoundingBox centroidBounds = EmptyBounds();
+    for(int i = node->first; i < node->first + node->count; i++) {
+        centroidBounds = MergeBounds(centroidBounds, {items[i].centroid, items[i].centroid});
+    }
+
+    Vector3 centroidMin = centroidBounds.min;
+    Vector3 extent = centroidBounds.max - centroidBounds.min;
+    int axis = extent.x > extent.y && extent.x > extent.z ? 0 : extent.y > extent.z ? 1 : 2;
+
+    float axisMin = GetAxis(centroidMin, axis);
+    float axisExtent = GetAxis(extent, axis);
+    if(axisExtent <= 0) {
+        // All centroids in the same place, objects can't be separated
+        return false;
+    }
+
+    BvhBin bins[BVH_BINS];
+    for(int b = 0; b < BVH_BINS; b++) {
+        bins[b] = {EmptyBounds(), 0};
+    }
+
+    // Extent can be so small that the scale overflows, objects are practically in the same place then
+    float binScale = BVH_BINS / axisExtent;
+    if(binScale > FLT_MAX) {
+        return false;
+    }
+
+    for(int i = node->first; i < node->first + node->count; i++) {
+        int b = (int) ((GetAxis(items[i].centroid, axis) - axisMin) * binScale);
+        b = b < BVH_BINS - 1 ? b : BVH_BINS - 1;
+        b = b > 0 ? b : 0;
+
+        bins[b].bounds = MergeBounds(bins[b].bounds, items[i].bounds);
+        bins[b].count++;
+    }
+
+    // Sweep from the right to get costs of all right sides, then from the left
+    float rightArea[BVH_BINS];
+    int rightCount[BVH_BINS];
+
+    BoundingBox bounds = EmptyBounds();
+    int count = 0;
+    for(int b = BVH_BINS - 1; b > 0; b--) {
+        bounds = MergeBounds(bounds, bins[b].bounds);
+        count += bins[b].count;
+
+        rightArea[b] = count ? BoundsArea(bounds) : 0;
+        rightCount[b] = count;
+    }
+
+    float bestCost = FLT_MAX;
+    int bestBin = -1;
+
+    bounds = EmptyBounds();
+    count = 0;
+    for(int b = 1; b < BVH_BINS; b++) {
+        bounds = MergeBounds(bounds, bins[b - 1].bounds);
+        count += bins[b - 1].count;
+
+        if(count == 0 || rightCount[b] == 0) {
+            continue;
+        }
+
+        float cost = count * BoundsArea(bounds) + rightCount[b] * rightArea[b];
+        if(cost < bestCost) {
+            bestCost = cost;
+            bestBin = b;
+        }
+    }
+
+    if(bestBin == -1) {
+        return false;
+    }
+
+    float nodeArea = BoundsArea(node->bounds);
+    float splitCost = BVH_TRAVERSAL_COST + BVH_INTERSECTION_COST * bestCost / (nodeArea > 0 ? nodeArea : 1);
+    float leafCost = BVH_INTERSECTION_COST * node->count;
+
+    // Big leaves are split even when SAH says otherwise, so queries stay fast
+    if(splitCost >= leafCost && node->count <= BVH_MAX_LEAF_SIZE * 4) {
+        return false;
+    }
+
+    *splitAxis = axis;
+    *splitPosition = axisMin + bestBin / binScale;
+    return true;
+}
+
+Bvh BuildBvh(Slice<BoundingBox> objectBounds, MemoryArena* arena, MemoryArena* tempArena) {
+    assert(arena && tempArena);
+
+    Bvh bvh = {};
+    int objectsCount = (int) objectBounds.length;
+    if(objectsCount == 0) {
+        return bvh;
+    }
+
+    bvh.objectsCount  = objectsCount;
+    bvh.nodes         = (BvhNode*) PushArena(arena, (2 * objectsCount - 1) * sizeof(BvhNode));
+    bvh.objectIndices = (int32_t*) PushArena(arena, objectsCount * sizeof(int32_t));
+    bvh.objectBounds  = (BoundingBox*) PushArena(arena, objectsCount * sizeof(BoundingBox));
+
+    memcpy(bvh.objectBounds, objectBounds.data, objectsCount * sizeof(BoundingBox));
+
+    uint64_t tempPos = GetArenaPos(tempArena);
+    BvhBuildItem* items = (BvhBuildItem*) PushArena(tempArena, objectsCount * sizeof(BvhBuildItem));
+
+    for(int i = 0; i < objectsCount; i++) {
+        items[i].bounds   = objectBounds[i];
+        items[i].centroid = (objectBounds[i].min + objectBounds[i].max) * 0.5f;
+        items[i].object   = i;
+    }
+
+    BvhNode* root = bvh.nodes;
+    root->first = 0;
+    root->count = objectsCount;
+    UpdateNodeBounds(root, items);
+    bvh.nodesCount = 1;
+
+    int stack[BVH_STACK_SIZE];
+    int depths[BVH_STACK_SIZE];
+    int stackSize = 0;
+
+    stack[stackSize] = 0;
+    depths[stackSize] = 0;
+    stackSize++;
+
+    while(stackSize > 0) {
+        stackSize--;
+        BvhNode* node = bvh.nodes + stack[stackSize];
+        int depth = depths[stackSize];
+
+        // Degenerate input (like many coincident centroids) could go deeper than the
+        // traversal stacks, nodes at the max depth stay leaves
+        if(depth >= BVH_MAX_DEPTH) {
+            continue;
+        }
+
+        int axis = 0;
+        float splitPosition = 0;
+        if(node->count <= 1 || FindSplit(node, items, &axis, &splitPosition) == false) {
+            continue;
+        }
+
+        // In place partition of the node objects
+        int i = node->first;
+        int j = node->first + node->count - 1;
+        while(i <= j) {
+            if(GetAxis(items[i].centroid, axis) < splitPosition) {
+                i++;
+            }
+            else {
+                BvhBuildItem tmp = items[i];
+                items[i] = items[j];
+                items[j] = tmp;
+                j--;
+            }
+        }
+
+        int leftCount = i - node->first;
+        if(leftCount == 0 || leftCount == node->count) {
+            continue;
+        }
+
+        int leftIndex = bvh.nodesCount;
+        bvh.nodesCount += 2;
+
+        BvhNode* left  = bvh.nodes + leftIndex;
+        BvhNode* right = left + 1;
+
+        left->first  = node->first;
+        left->count  = leftCount;
+        right->first = i;
+        right->count = node->count - leftCount;
+
+        UpdateNodeBounds(left, items);
+        UpdateNodeBounds(right, items);
+
+        node->leftChild = leftIndex;
+
+        assert(stackSize + 2 <= BVH_STACK_SIZE);
+        stack[stackSize] = leftIndex;
+        depths[stackSize] = depth + 1;
+        stackSize++;
+
+        stack[stackSize] = leftIndex + 1;
+        depths[stackSize] = depth + 1;
+        stackSize++;
+    }
+
+    for(int i = 0; i < objectsCount; i++) {
+        bvh.objectIndices[i] = items[i].object;
+    }
+
+    PopArenaTo(tempArena, tempPos);
+    return bvh;
+}
+
+void RefitBvh(Bvh* bvh, Slice<BoundingBox> objectBounds) {
+    assert(objectBounds.length == bvh->objectsCount);
+
+    memcpy(bvh->objectBounds, objectBounds.data, bvh->objectsCount * sizeof(BoundingBox));
+
+    // Children are always created after their parents, so reverse order visits them first
+    for(int i = bvh->nodesCount - 1; i >= 0; i--) {
+        BvhNode* node = bvh->nodes + i;
+
+        if(node->leftChild == 0) {
+            UpdateNodeBounds(bvh, node);
+        }
+        else {
+            node->bounds = MergeBounds(bvh->nodes[node->leftChild].bounds, bvh->nodes[node->leftChild + 1].bounds);
+        }
+    }
+}
+
+//========================================
+// BVH queries
+//========================================
+
+// Node objects are contiguous in objectIndices, so whole subtrees are copied at once
+static int AppendNodeObjects(Bvh* bvh, BvhNode* node, int32_t* result, int count) {
+    memcpy(result + count, bvh->objectIndices + node->first, node->count * sizeof(int32_t));
+    return count + node->count;
+}
+
+int QueryBvhFrustum(Bvh* bvh, Frustum* frustum, int32_t* result) {
+    if(bvh->nodesCount == 0) {
+        return 0;
+    }
+
+    // Planes that still intersect the node, planes fully containing a parent are skipped in children
+    struct Entry {
+        int node;
+        int planeMask;
+    };
+
+    Entry stack[BVH_STACK_SIZE];
+    int stackSize = 0;
+    stack[stackSize++] = {0, 0x3F};
+
+    int count = 0;
+
+    while(stackSize > 0) {
+        Entry entry = stack[--stackSize];
+        BvhNode* node = bvh->nodes + entry.node;
+
+        Vector3 center = (node->bounds.min + node->bounds.max) * 0.5f;
+        Vector3 halfSize = (node->bounds.max - node->bounds.min) * 0.5f;
+
+        bool outside = false;
+        int planeMask = 0;
+
+        for(int p = 0; p < 6; p++) {
+            if((entry.planeMask & (1 << p)) == 0) {
+                continue;
+            }
+
+            Vector4 plane = frustum->planes[p];
+            float distance = plane.x * center.x + plane.y * center.y + plane.z * center.z + plane.w;
+            float radius = halfSize.x * fabsf(plane.x) + halfSize.y * fabsf(plane.y) + halfSize.z * fabsf(plane.z);
+
+            if(distance < -radius) {
+                outside = true;
+                break;
+            }
+
+            if(distance < radius) {
+                planeMask |= 1 << p;
+            }
+        }
+
+        if(outside) {
+            continue;
+        }
+
+        if(planeMask == 0 || node->leftChild == 0) {
+            // Fully inside, or a leaf: objects are tested only against the intersecting planes
+            if(planeMask == 0) {
+                count = AppendNodeObjects(bvh, node, result, count);
+                continue;
+            }
+
+            for(int i = node->first; i < node->first + node->count; i++) {
+                int32_t object = bvh->objectIndices[i];
+                BoundingBox bounds = bvh->objectBounds[object];
+
+                Vector3 objectCenter = (bounds.min + bounds.max) * 0.5f;
+                Vector3 objectHalfSize = (bounds.max - bounds.min) * 0.5f;
+
+                bool visible = true;
+                for(int p = 0; p < 6 && visible; p++) {
+                    if((planeMask & (1 << p)) == 0) {
+                        continue;
+                    }
+
+                    Vector4 plane = frustum->planes[p];
+                    float distance = plane.x * objectCenter.x + plane.y * objectCenter.y + plane.z * objectCenter.z + plane.w;
+                    float radius = objectHalfSize.x * fabsf(plane.x) + objectHalfSize.y * fabsf(plane.y) + objectHalfSize.z * fabsf(plane.z);
+
+                    visible = distance >= -radius;
+                }
+
+                if(visible) {
+                    result[count++] = object;
+                }
+            }
+
+            continue;
+        }
+
+        assert(stackSize + 2 <= BVH_STACK_SIZE);
+        stack[stackSize++] = {node->leftChild, planeMask};
+        stack[stackSize++] = {node->leftChild + 1, planeMask};
+    }
+
+    return count;
+}
+
+static bool BoxOverlapsBox(BoundingBox a, BoundingBox b) {
+    return a.min.x <= b.max.x && a.max.x >= b.min.x &&
+           a.min.y <= b.max.y && a.max.y >= b.min.y &&
+           a.min.z <= b.max.z && a.max.z >= b.min.z;
+}
+
+static bool BoxContainsBox(BoundingBox outer, BoundingBox inner) {
+    return outer.min.x <= inner.min.x && outer.max.x >= inner.max.x &&
+           outer.min.y <= inner.min.y && outer.max.y >= inner.max.y &&
+           outer.min.z <= inner.min.z && outer.max.z >= inner.max.z;
+}
+
+static bool BoxOverlapsSphere(BoundingBox box, Vector3 center, float radius) {
+    Vector3 closest = Vector3Clamp(center, box.min, box.max);
+    return Vector3DistanceSqr(closest, center) <= radius * radius;
+}
+
+int QueryBvhBox(Bvh* bvh, BoundingBox box, int32_t* result) {
+    if(bvh->nodesCount == 0) {
+        return 0;
+    }
+
+    int stack[BVH_STACK_SIZE];
+    int stackSize = 0;
+    stack[stackSize++] = 0;
+
+    int count = 0;
+
+    while(stackSize > 0) {
+        BvhNode* node = bvh->nodes + stack[--stackSize];
+
+        if(BoxOverlapsBox(box, node->bounds) == false) {
+            continue;
+        }
+
+        if(BoxContainsBox(box, node->bounds)) {
+            count = AppendNodeObjects(bvh, node, result, count);
+            continue;
+        }
+
+        if(node->leftChild == 0) {
+            for(int i = node->first; i < node->first + node->count; i++) {
+                int32_t object = bvh->objectIndices[i];
+                if(BoxOverlapsBox(box, bvh->objectBounds[object])) {
+                    result[count++] = object;
+                }
+            }
+
+            continue;
+        }
+
+        assert(stackSize + 2 <= BVH_STACK_SIZE);
+        stack[stackSize++] = node->leftChild;
+        stack[stackSize++] = node->leftChild + 1;
+    }
+
+    return count;
+}
+
+int QueryBvhSphere(Bvh* bvh, Vector3 center, float radius, int32_t* result) {
+    if(bvh->nodesCount == 0) {
+        return 0;
+    }
+
+    int stack[BVH_STACK_SIZE];
+    int stackSize = 0;
+    stack[stackSize++] = 0;
+
+    int count = 0;
+
+    while(stackSize > 0) {
+        BvhNode* node = bvh->nodes + stack[--stackSize];
+
+        if(BoxOverlapsSphere(node->bounds, center, radius) == false) {
+            continue;
+        }
+
+        if(node->leftChild == 0) {
+            for(int i = node->first; i < node->first + node->count; i++) {
+                int32_t object = bvh->objectIndices[i];
+                if(BoxOverlapsSphere(bvh->objectBounds[object], center, radius)) {
+                    result[count++] = object;
+                }
+            }
+
+            continue;
+        }
+
+        assert(stackSize + 2 <= BVH_STACK_SIZE);
+        stack[stackSize++] = node->leftChild;
+        stack[stackSize++] = node->leftChild + 1;
+    }
+
+    return count;
+}
+
+Vector3 GetRayInverseDirection(Vector3 direction) {
+    Vector3 ret;
+    ret.x = 1.0f / (fabsf(direction.x) > 1e-20f ? direction.x : copysignf(1e-20f, direction.x));
+    ret.y = 1.0f / (fabsf(direction.y) > 1e-20f ? direction.y : copysignf(1e-20f, direction.y));
+    ret.z = 1.0f / (fabsf(direction.z) > 1e-20f ? direction.z : copysignf(1e-20f, direction.z));
+    return ret;
+}
+
+// Slab test, returns entry distance or FLT_MAX when the box is missed
+static float IntersectRayBox(BoundingBox box, Vector3 origin, Vector3 inverseDirection, float maxDistance) {
+    float tx1 = (box.min.x - origin.x) * inverseDirection.x;
+    float tx2 = (box.max.x - origin.x) * inverseDirection.x;
+    float ty1 = (box.min.y - origin.y) * inverseDirection.y;
+    float ty2 = (box.max.y - origin.y) * inverseDirection.y;
+    float tz1 = (box.min.z - origin.z) * inverseDirection.z;
+    float tz2 = (box.max.z - origin.z) * inverseDirection.z;
+
+    float tmin = fmaxf(fmaxf(fminf(tx1, tx2), fminf(ty1, ty2)), fminf(tz1, tz2));
+    float tmax = fminf(fminf(fmaxf(tx1, tx2), fmaxf(ty1, ty2)), fmaxf(tz1, tz2));
+
+    if(tmax < fmaxf(tmin, 0) || tmin > maxDistance) {
+        return FLT_MAX;
+    }
+
+    return fmaxf(tmin, 0);
+}
+
+int RaycastBvh(Bvh* bvh, Vector3 origin, Vector3 direction, float maxDistance, float* distance,
+               BvhRayCallback callback, void* userData)
+{
+    if(bvh->nodesCount == 0) {
+        return -1;
+    }
+
+    Vector3 inverseDirection = GetRayInverseDirection(direction);
+
+    int stack[BVH_STACK_SIZE];
+    int stackSize = 0;
+    stack[stackSize++] = 0;
+
+    int hitObject = -1;
+    float closest = maxDistance;
+
+    while(stackSize > 0) {
+        BvhNode* node = bvh->nodes + stack[--stackSize];
+
+        if(IntersectRayBox(node->bounds, origin, inverseDirection, closest) == FLT_MAX) {
+            continue;
+        }
+
+        if(node->leftChild == 0) {
+            for(int i = node->first; i < node->first + node->count; i++) {
+                int32_t object = bvh->objectIndices[i];
+
+                float t = IntersectRayBox(bvh->objectBounds[object], origin, inverseDirection, closest);
+                if(t == FLT_MAX) {
+                    continue;
+                }
+
+                if(callback && callback(userData, object, origin, direction, &t) == false) {
+                    continue;
+                }
+
+                if(t <= closest) {
+                    closest = t;
+                    hitObject = object;
+                }
+            }
+
+            continue;
+        }
+
+        // Nearer child is visited first, so far subtrees are skipped more often
+        BvhNode* left  = bvh->nodes + node->leftChild;
+        BvhNode* right = left + 1;
+
+        float leftDistance  = IntersectRayBox(left->bounds, origin, inverseDirection, closest);
+        float rightDistance = IntersectRayBox(right->bounds, origin, inverseDirection, closest);
+
+        int nearChild = node->leftChild;
+        int farChild = node->leftChild + 1;
+        float farDistance = rightDistance;
+
+        if(rightDistance < leftDistance) {
+            nearChild = node->leftChild + 1;
+            farChild = node->leftChild;
+            farDistance = leftDistance;
+        }
+
+        assert(stackSize + 2 <= BVH_STACK_SIZE);
+        if(farDistance != FLT_MAX) {
+            stack[stackSize++] = farChild;
+        }
+        if(fminf(leftDistance, rightDistance) != FLT_MAX) {
+            stack[stackSize++] = nearChild;
+        }
+    }
+
+    if(distance && hitObject != -1) {
+        *distance = closest;
+    }
+
+    return hitObject;
+}
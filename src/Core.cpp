@@ -9,6 +9,9 @@
 
 SRWindow windowInstance = {};
 
+// Order has to match the BUILT_IN_SHADER_* bits
+static const char* BuiltInShaderKeywords[] = {"MULTI_DRAW", "SKINNED", "QUANTIZED"};
+
 void KeyCallback(GLFWwindow* window, int key, int scancode, int action, int mods);
 void ResizeCallback(GLFWwindow* window, int width, int height);
 void GLFWErrorCallback(int, const char *);
@@ -20,8 +23,12 @@ SRWindow* InitializeWindow(Str8 name, int width, int height) {
 
     // GLFW Init
     glfwInit();
+
+    double startupStart = glfwGetTime();
     glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+    // @NOTE: 4.5 is needed for DSA functions (Interleaved mesh layout),
+    // 4.6 for gl_BaseInstance in the multi draw shaders
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 6);
     glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
 
     windowInstance.glfwWin = glfwCreateWindow(width, height, name.str, NULL, NULL);
@@ -53,21 +60,74 @@ SRWindow* InitializeWindow(Str8 name, int width, int height) {
 
     glfwSwapInterval(1);
 
-    // built-in shaders
-    ErrorShader = LoadShaderSource(DefaultVertexShaderSource, ErrorFragmentShaderSource);
-    ColorShader = LoadShaderSource(DefaultVertexShaderSource, ColorShaderSource);
-    TextureShader = LoadShaderSource(DefaultVertexShaderSource, TextureShaderSource);
-    VertexColorShader = LoadShaderSource(DefaultVertexShaderSource, VertexColorShaderSource);
-    ScreenSpaceShader = LoadShaderSource(ScreenSpaceVertexSource, ScreenSpaceFragmentSource);
+    double contextTime = glfwGetTime() - startupStart;
+
+    // Program binaries are stored in the working directory
+    bool shaderCache = EnableShaderCache("shader_cache");
+
+    InitParallelShaderCompile();
+
+    // built-in shaders, all compilations are started before waiting for any of them.
+    // Only the base variants are compiled here, the others on their first use.
+    double shadersStart = glfwGetTime();
+
+    AddShaderInclude("SimpleRenderer/FrameData.glsl", FrameDataShaderInclude);
+    AddShaderInclude("SimpleRenderer/Quantization.glsl", QuantizationShaderInclude);
+
+    MemoryArena* tempArena = &windowInstance.tempArena;
+    MemoryArena* persistentArena = &windowInstance.persistentArena;
+
+    ShaderPermutations* errorPermutations       = CreateShaderPermutations(MeshVertexShaderSource, ErrorFragmentShaderSource, BuiltInShaderKeywords, 3, persistentArena);
+    ShaderPermutations* colorPermutations       = CreateShaderPermutations(MeshVertexShaderSource, ColorShaderSource, BuiltInShaderKeywords, 3, persistentArena);
+    ShaderPermutations* texturePermutations     = CreateShaderPermutations(MeshVertexShaderSource, TextureShaderSource, BuiltInShaderKeywords, 3, persistentArena);
+    ShaderPermutations* vertexColorPermutations = CreateShaderPermutations(MeshVertexShaderSource, VertexColorShaderSource, BuiltInShaderKeywords, 3, persistentArena);
+
+    ShaderPermutations* builtInPermutations[] = {
+        errorPermutations, colorPermutations, texturePermutations, vertexColorPermutations,
+    };
+
+    for(int i = 0; i < (int) (sizeof(builtInPermutations) / sizeof(builtInPermutations[0])); i++) {
+        assert(builtInPermutations[i]);
+        builtInPermutations[i]->builtIn = true;
+
+        PrefetchShaderVariant(builtInPermutations[i], 0, tempArena);
+    }
+
+    uint64_t tempPos = GetArenaPos(tempArena);
+
+    char* screenSpaceSource = PreprocessShader(ScreenSpaceVertexSource, NULL, 0, tempArena);
+    ScreenSpaceShader = LoadShaderSourceAsync(screenSpaceSource, ScreenSpaceFragmentSource);
+
+    PopArenaTo(tempArena, tempPos);
 
-    assert(ErrorShader.isValid);
-    assert(ColorShader.isValid);
-    assert(TextureShader.isValid);
-    assert(VertexColorShader.isValid);
-    assert(ScreenSpaceShader.isValid);
+    ErrorShader       = *GetShaderVariant(errorPermutations, 0, tempArena);
+    ColorShader       = *GetShaderVariant(colorPermutations, 0, tempArena);
+    TextureShader     = *GetShaderVariant(texturePermutations, 0, tempArena);
+    VertexColorShader = *GetShaderVariant(vertexColorPermutations, 0, tempArena);
+    FinishShader(&ScreenSpaceShader);
+
+    Shader* builtInShaders[] = {
+        &ErrorShader, &ColorShader, &TextureShader, &VertexColorShader, &ScreenSpaceShader,
+    };
+
+    for(int i = 0; i < (int) (sizeof(builtInShaders) / sizeof(builtInShaders[0])); i++) {
+        assert(builtInShaders[i]->isValid);
+    }
+
+    MultiDrawColorShader       = GetShaderVariantHandle(colorPermutations, BUILT_IN_SHADER_MULTI_DRAW);
+    MultiDrawVertexColorShader = GetShaderVariantHandle(vertexColorPermutations, BUILT_IN_SHADER_MULTI_DRAW);
+    MultiDrawTextureShader     = GetShaderVariantHandle(texturePermutations, BUILT_IN_SHADER_MULTI_DRAW);
+
+    SkinnedColorShader       = GetShaderVariantHandle(colorPermutations, BUILT_IN_SHADER_SKINNED);
+    SkinnedVertexColorShader = GetShaderVariantHandle(vertexColorPermutations, BUILT_IN_SHADER_SKINNED);
+    SkinnedTextureShader     = GetShaderVariantHandle(texturePermutations, BUILT_IN_SHADER_SKINNED);
+
+    double shadersTime = glfwGetTime() - shadersStart;
 
     UseShader(&windowInstance, ErrorShader);
 
+    InitFrameUniforms(&windowInstance);
+
     // Error textures
     glGenTextures(1, &ErrorTexture.id);
     glBindTexture(GL_TEXTURE_2D, ErrorTexture.id);
@@ -110,6 +170,16 @@ SRWindow* InitializeWindow(Str8 name, int width, int height) {
     glDebugMessageControl(GL_DONT_CARE, GL_DONT_CARE, GL_DEBUG_SEVERITY_NOTIFICATION, 0, NULL, GL_FALSE);
     glDebugMessageControl(GL_DONT_CARE, GL_DONT_CARE, GL_DEBUG_SEVERITY_LOW, 0, NULL, GL_FALSE);
 
+    ShaderCacheStats cacheStats = GetShaderCacheStats();
+
+    printf("[Startup] Window and context: %.2f ms\n", contextTime * 1000);
+    printf("[Startup] Built-in shaders: %.2f ms, %d from cache, %d compiled%s\n", shadersTime * 1000,
+           cacheStats.hits, cacheStats.misses, shaderCache ? "" : " (cache not supported)");
+    if(cacheStats.hits > 0) {
+        printf("[Startup] Shader cache saved: %.2f ms\n", cacheStats.savedTime * 1000);
+    }
+    printf("[Startup] Total: %.2f ms\n", (glfwGetTime() - startupStart) * 1000);
+
     return &windowInstance;
 }
 
@@ -128,6 +198,8 @@ void FrameStart(SRWindow* window) {
 
     glfwGetFramebufferSize(window->glfwWin, &window->width, &window->height);
 
+    UpdateFrameUniforms(window);
+
     double currsorPosX;
     double currsorPosY;
     glfwGetCursorPos(window->glfwWin, &currsorPosX, &currsorPosY);
@@ -184,6 +256,9 @@ void FrameEnd(SRWindow* window) {
         d->maxFrameTime = d->meanFrameTime;
     }
 
+    d->lastOcclusion = d->occlusion;
+    d->occlusion = {};
+
     ClearArena(&window->tempArena);
 
     glfwSwapBuffers(window->glfwWin);
@@ -303,6 +378,15 @@ void ShowFrameTime(SRWindow* window, Vector2 position) {
         ImGui::Text("Min Frame Time: %.2f ms", window->frameTimeData.minFrameTime * 1000);
         ImGui::Text("Max Frame Time: %.2f ms", window->frameTimeData.maxFrameTime * 1000);
 
+        OcclusionStats* occlusion = &window->frameTimeData.lastOcclusion;
+        if(occlusion->tested > 0 || occlusion->occluderTriangles > 0) {
+            ImGui::Separator();
+            ImGui::Text("Occluder Triangles: %d", occlusion->occluderTriangles);
+            ImGui::Text("Occlusion Culled:   %d / %d", occlusion->culled, occlusion->tested);
+            ImGui::Text("Occlusion Raster:   %.3f ms", occlusion->rasterizeTime * 1000);
+            ImGui::Text("Occlusion Test:     %.3f ms", occlusion->testTime * 1000);
+        }
+
         ImGui::End();
     }
 }
@@ -313,7 +397,7 @@ void ShowFrameTime(SRWindow* window, Vector2 position) {
 // =======================================
 void InitBatch(BatchBuffer* batch) {
     glGenVertexArrays(1, &batch->VAO);
-    glBindVertexArray(batch->VAO);
+    BindVertexArray(batch->VAO);
 
     glGenBuffers(1, &batch->VBO);
     glBindBuffer(GL_ARRAY_BUFFER, batch->VBO);
@@ -329,7 +413,7 @@ void InitBatch(BatchBuffer* batch) {
 
     glBufferData(GL_ARRAY_BUFFER, sizeof(BatchVertex) * BATCH_MAX_SIZE, NULL, GL_STREAM_DRAW);
 
-    glBindVertexArray(0);
+    BindVertexArray(0);
     glBindBuffer(GL_ARRAY_BUFFER, 0);
 
     // glGenTextures(1, &batch->whiteTextureId);
@@ -573,6 +657,7 @@ Font LoadFontFromMemory(const unsigned char* data, int fontSize, MemoryArena* ar
 
         glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, bitmapSize, bitmapSize, 0, GL_RGBA, GL_UNSIGNED_BYTE, colorBitmap);
         glBindTexture(GL_TEXTURE_2D, 0);
+        ResetTextureBindings();
 
         for(int i = 0; i < CharacterRange - 32; i++) {
             stbtt_packedchar m = packedGlyphs[i];
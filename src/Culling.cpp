@@ -0,0 +1,128 @@
+#include "SimpleRenderer.h"
+
+#include <xmmintrin.h> // SSE
+
+//========================================
+// Culling
+//========================================
+
+// Row of the matrix, Matrix fields are named mColumnRow
+static Vector4 GetMatrixRow(Matrix m, int row) {
+    float* f = (float*) &m;
+    return {f[row], f[4 + row], f[8 + row], f[12 + row]};
+}
+
+static Vector4 NormalizePlane(Vector4 plane) {
+    float length = sqrtf(plane.x * plane.x + plane.y * plane.y + plane.z * plane.z);
+    if(length > 0) {
+        plane = plane * (1.0f / length);
+    }
+
+    return plane;
+}
+
+// Gribb-Hartmann plane extraction, for -w <= x, y, z <= w clip space
+Frustum ExtractFrustum(Matrix vp) {
+    Vector4 row0 = GetMatrixRow(vp, 0);
+    Vector4 row1 = GetMatrixRow(vp, 1);
+    Vector4 row2 = GetMatrixRow(vp, 2);
+    Vector4 row3 = GetMatrixRow(vp, 3);
+
+    Frustum frustum = {};
+    frustum.planes[0] = NormalizePlane(row3 + row0); // left
+    frustum.planes[1] = NormalizePlane(row3 - row0); // right
+    frustum.planes[2] = NormalizePlane(row3 + row1); // bottom
+    frustum.planes[3] = NormalizePlane(row3 - row1); // top
+    frustum.planes[4] = NormalizePlane(row3 + row2); // near
+    frustum.planes[5] = NormalizePlane(row3 - row2); // far
+
+    return frustum;
+}
+
+Frustum GetCameraFrustum(Camera* camera) {
+    return ExtractFrustum(GetVPMatrix(camera));
+}
+
+bool IsSphereInFrustum(Frustum* frustum, Vector3 center, float radius) {
+    for(int i = 0; i < 6; i++) {
+        Vector4 plane = frustum->planes[i];
+        float distance = plane.x * center.x + plane.y * center.y + plane.z * center.z + plane.w;
+
+        if(distance < -radius) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+BoundingSphere TransformBoundingSphere(BoundingSphere sphere, Matrix transform) {
+    float scaleX = transform.m00 * transform.m00 + transform.m01 * transform.m01 + transform.m02 * transform.m02;
+    float scaleY = transform.m10 * transform.m10 + transform.m11 * transform.m11 + transform.m12 * transform.m12;
+    float scaleZ = transform.m20 * transform.m20 + transform.m21 * transform.m21 + transform.m22 * transform.m22;
+    float scale = sqrtf(fmaxf(scaleX, fmaxf(scaleY, scaleZ)));
+
+    BoundingSphere ret = {};
+    ret.center = transform * sphere.center;
+    ret.radius = sphere.radius * scale;
+
+    return ret;
+}
+
+void TransformBoundingSpheres(BoundingSphere sphere, Slice<Matrix> transforms, Vector4* destination) {
+    for(int i = 0; i < transforms.length; i++) {
+        BoundingSphere world = TransformBoundingSphere(sphere, transforms[i]);
+        destination[i] = {world.center.x, world.center.y, world.center.z, world.radius};
+    }
+}
+
+int CullSpheres(Frustum* frustum, Slice<Vector4> spheres, int32_t* visible) {
+    __m128 planeX[6], planeY[6], planeZ[6], planeW[6];
+    for(int p = 0; p < 6; p++) {
+        planeX[p] = _mm_set1_ps(frustum->planes[p].x);
+        planeY[p] = _mm_set1_ps(frustum->planes[p].y);
+        planeZ[p] = _mm_set1_ps(frustum->planes[p].z);
+        planeW[p] = _mm_set1_ps(frustum->planes[p].w);
+    }
+
+    const __m128 signMask = _mm_set1_ps(-0.0f);
+
+    int count = 0;
+    int i = 0;
+
+    for(; i + 4 <= spheres.length; i += 4) {
+        // Four spheres transposed to x, y, z and radius vectors
+        __m128 x = _mm_loadu_ps((float*) (spheres.data + i + 0));
+        __m128 y = _mm_loadu_ps((float*) (spheres.data + i + 1));
+        __m128 z = _mm_loadu_ps((float*) (spheres.data + i + 2));
+        __m128 r = _mm_loadu_ps((float*) (spheres.data + i + 3));
+        _MM_TRANSPOSE4_PS(x, y, z, r);
+
+        __m128 negativeRadius = _mm_xor_ps(r, signMask);
+        __m128 inside = _mm_cmpeq_ps(r, r);
+
+        for(int p = 0; p < 6; p++) {
+            __m128 distance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(planeX[p], x), _mm_mul_ps(planeY[p], y)),
+                                         _mm_add_ps(_mm_mul_ps(planeZ[p], z), planeW[p]));
+
+            inside = _mm_and_ps(inside, _mm_cmpge_ps(distance, negativeRadius));
+        }
+
+        // Branchless compaction, every index is written but only visible ones are kept.
+        // count <= i + k here, so writes stay within spheres.length.
+        int mask = _mm_movemask_ps(inside);
+        visible[count] = i + 0; count += (mask >> 0) & 1;
+        visible[count] = i + 1; count += (mask >> 1) & 1;
+        visible[count] = i + 2; count += (mask >> 2) & 1;
+        visible[count] = i + 3; count += (mask >> 3) & 1;
+    }
+
+    for(; i < spheres.length; i++) {
+        Vector4 s = spheres[i];
+        if(IsSphereInFrustum(frustum, {s.x, s.y, s.z}, s.w)) {
+            visible[count++] = i;
+        }
+    }
+
+    return count;
+}
@@ -3,9 +3,12 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <memory.h>
+#include <string.h>
+#include <stddef.h>
 #include <assert.h>
 
 #include <errno.h>
+#include <emmintrin.h> // SSE2
 
 #define STB_IMAGE_IMPLEMENTATION
 #include "stb/stb_image.h"
@@ -17,14 +20,51 @@ Shader TextureShader;
 Shader VertexColorShader;
 Shader ScreenSpaceShader;
 
+Shader MultiDrawColorShader;
+Shader MultiDrawVertexColorShader;
+Shader MultiDrawTextureShader;
+
+Shader SkinnedColorShader;
+Shader SkinnedVertexColorShader;
+Shader SkinnedTextureShader;
+
 Texture ErrorTexture;
 
 //=========================================
 // Default shaders
 //=========================================
 
-const char* DefaultVertexShaderSource = 
-R"###(#version 430 core
+// Shared by the built-in vertex shaders, see AddShaderInclude
+const char* QuantizationShaderInclude =
+R"###(vec3 OctahedralDecode(vec2 e) {
+    vec3 v = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+    if(v.z < 0) {
+        vec2 signs = vec2(v.x >= 0 ? 1 : -1, v.y >= 0 ? 1 : -1);
+        v.xy = (1.0 - abs(v.yx)) * signs;
+    }
+    return normalize(v);
+})###";
+
+// Shared by all built-in shaders, see FrameUniforms. Binding has to match FRAME_DATA_BINDING.
+const char* FrameDataShaderInclude =
+R"###(layout (std140, binding = 0) uniform FrameData {
+    mat4 view;
+    mat4 projection;
+    mat4 viewProjection;
+    vec4 cameraPosition;
+    vec4 time;
+    vec4 resolution;
+} frame;)###";
+
+// Built-in vertex shader, variants are compiled with different keywords:
+//   none       - DrawMesh, model matrix is set as uniform
+//   QUANTIZED  - DrawMesh with Quantized meshes, quantization data is set as uniforms too
+//   MULTI_DRAW - DrawList and DrawMeshInstanced, model matrix and quantization data are read
+//                from the draw data buffer. gl_BaseInstance is set to the draw index.
+//   SKINNED    - DrawSkinnedMeshInstanced, same as MULTI_DRAW, but vertices are skinned with
+//                the joint palette of the instance before applying the model matrix
+const char* MeshVertexShaderSource =
+R"###(#version 460 core
 layout (location = 0) in vec3 aPos;
 layout (location = 1) in vec3 aNorm;
 layout (location = 2) in vec2 aUV;
@@ -33,14 +73,86 @@ out vec3 pos;
 out vec3 normal;
 out vec2 uv;
 out vec4 vertexColor;
-uniform mat4 MVP;
+
+#include "SimpleRenderer/FrameData.glsl"
+#include "SimpleRenderer/Quantization.glsl"
+
+#if defined(MULTI_DRAW) || defined(SKINNED)
+out vec4 instanceColor;
+
+struct DrawData {
+    mat4 model;
+    vec4 boundsMin;
+    vec4 boundsSize;
+    vec4 uvBounds;
+    vec4 color;
+};
+
+layout (std430, binding = 0) readonly buffer DrawDataBuffer {
+    DrawData draws[];
+};
+#else
+uniform mat4 model;
+#endif
+
+#ifdef QUANTIZED
+uniform vec3 boundsMin;
+uniform vec3 boundsSize;
+uniform vec4 uvBounds;
+#endif
+
+#ifdef SKINNED
+layout (location = 4) in vec4 aJoints;
+layout (location = 5) in vec4 aWeights;
+uniform int jointsCount;
+
+layout (std430, binding = 1) readonly buffer JointPaletteBuffer {
+    mat4 palette[];
+};
+#endif
+
 void main() {
-    pos = aPos;
-    normal = aNorm;
-    uv = aUV;
+    vec3 position = aPos;
+    vec3 norm = aNorm;
+    vec2 texcoord = aUV;
+
+#if defined(MULTI_DRAW) || defined(SKINNED)
+    int drawIndex = gl_BaseInstance + gl_InstanceID;
+    DrawData draw = draws[drawIndex];
+
+    if(draw.boundsMin.w != 0) {
+        position = draw.boundsMin.xyz + aPos * draw.boundsSize.xyz;
+        norm = OctahedralDecode(aNorm.xy);
+        texcoord = draw.uvBounds.xy + aUV * draw.uvBounds.zw;
+    }
+#elif defined(QUANTIZED)
+    position = boundsMin + aPos * boundsSize;
+    norm = OctahedralDecode(aNorm.xy);
+    texcoord = uvBounds.xy + aUV * uvBounds.zw;
+#endif
+
+#ifdef SKINNED
+    int firstJoint = drawIndex * jointsCount;
+    mat4 skin = aWeights.x * palette[firstJoint + int(aJoints.x)] +
+                aWeights.y * palette[firstJoint + int(aJoints.y)] +
+                aWeights.z * palette[firstJoint + int(aJoints.z)] +
+                aWeights.w * palette[firstJoint + int(aJoints.w)];
+
+    position = (skin * vec4(position, 1.0)).xyz;
+    norm = normalize(mat3(skin) * norm);
+#endif
+
+    pos = position;
+    normal = norm;
+    uv = texcoord;
     vertexColor = aColor;
 
-    gl_Position = MVP * vec4(aPos, 1.0);
+#if defined(MULTI_DRAW) || defined(SKINNED)
+    instanceColor = draw.color;
+    gl_Position = frame.viewProjection * draw.model * vec4(position, 1.0);
+#else
+    gl_Position = frame.viewProjection * model * vec4(position, 1.0);
+#endif
 })###";
 
 const char* VertexColorShaderSource =
@@ -51,12 +163,21 @@ void main() {
     FragColor = vertexColor;
 })###";
 
+// Multi draw variants use the color from the draw data instead of the tint
 const char* ColorShaderSource =
 R"###(#version 430 core
+#if defined(MULTI_DRAW) || defined(SKINNED)
+in vec4 instanceColor;
+#else
 uniform vec4 tint;
+#endif
 out vec4 FragColor;
 void main() {
+#if defined(MULTI_DRAW) || defined(SKINNED)
+    FragColor = instanceColor;
+#else
     FragColor = tint;
+#endif
 })###";
 
 const char* TextureShaderSource =
@@ -84,14 +205,13 @@ layout (location = 0) in vec3 aPos;
 layout (location = 1) in vec2 aUV;
 layout (location = 2) in vec4 aColor;
 
-uniform int framebufferWidth;
-uniform int framebufferHeight;
+#include "SimpleRenderer/FrameData.glsl"
 
 out vec2 uv;
 out vec4 vertexColor;
 
 vec3 ScreenToClip(vec3 pos) {
-    vec2 p = pos.xy / vec2(framebufferWidth, framebufferHeight);
+    vec2 p = pos.xy * frame.resolution.zw;
     p = p * 2 - 1;
     p.y *= -1;
 
@@ -187,6 +307,11 @@ void DepthTest(SRWindow* window, bool enabled) {
 
 
 void UseShader(SRWindow* window, Shader shader) {
+    // Variant handles are compiled on the first use
+    if(shader.permutations && shader.isValid == false) {
+        shader = *GetShaderVariant(shader.permutations, shader.keywords, &window->tempArena);
+    }
+
     window->currentShader = shader.isValid ? shader : ErrorShader;
     glUseProgram(window->currentShader.id);
 }
@@ -237,56 +362,304 @@ void SetBlendingPremultipliedAlpha(SRWindow* window) {
 // Shaders
 //=========================================
 
-Shader LoadShaderSource(const char *vertexShaderCode, const char *fragmentShaderCode)
+// 32 bit FNV-1a, 0 is reserved for empty slots
+static uint32_t HashUniformName(const char* name, int length) {
+    uint32_t hash = 2166136261u;
+    for(int i = 0; i < length; i++) {
+        hash ^= (uint8_t) name[i];
+        hash *= 16777619u;
+    }
+
+    return hash ? hash : 1;
+}
+
+static bool ShaderUniformNameEquals(Shader* shader, ShaderUniform* uniform, const char* name, int length) {
+    return uniform->nameLength == length && memcmp(shader->uniformNames + uniform->nameOffset, name, length) == 0;
+}
+
+static void AddShaderUniform(Shader* shader, const char* name, int length, int32_t location) {
+    uint32_t hash = HashUniformName(name, length);
+
+    // @NOTE: keep a quarter of the slots empty, so lookups of missing names stay short
+    if(shader->uniformsCount >= SHADER_UNIFORM_SLOTS * 3 / 4 ||
+       shader->uniformNamesSize + length > SHADER_UNIFORM_NAMES_SIZE)
+    {
+        shader->uniformsComplete = false;
+        return;
+    }
+
+    uint32_t mask = SHADER_UNIFORM_SLOTS - 1;
+    for(uint32_t slot = hash & mask; ; slot = (slot + 1) & mask) {
+        ShaderUniform* uniform = shader->uniforms + slot;
+
+        if(uniform->nameHash == 0) {
+            uniform->nameHash   = hash;
+            uniform->location   = location;
+            uniform->nameOffset = (uint16_t) shader->uniformNamesSize;
+            uniform->nameLength = (uint16_t) length;
+
+            memcpy(shader->uniformNames + shader->uniformNamesSize, name, length);
+            shader->uniformNamesSize += length;
+            shader->uniformsCount++;
+            return;
+        }
+
+        if(uniform->nameHash == hash && ShaderUniformNameEquals(shader, uniform, name, length)) {
+            return;
+        }
+    }
+}
+
+static bool IsSamplerType(GLenum type) {
+    switch(type) {
+        case GL_SAMPLER_1D:
+        case GL_SAMPLER_2D:
+        case GL_SAMPLER_3D:
+        case GL_SAMPLER_CUBE:
+        case GL_SAMPLER_1D_SHADOW:
+        case GL_SAMPLER_2D_SHADOW:
+        case GL_SAMPLER_1D_ARRAY:
+        case GL_SAMPLER_2D_ARRAY:
+        case GL_SAMPLER_2D_ARRAY_SHADOW:
+        case GL_SAMPLER_CUBE_SHADOW:
+        case GL_SAMPLER_CUBE_MAP_ARRAY:
+        case GL_SAMPLER_2D_MULTISAMPLE:
+        case GL_SAMPLER_BUFFER:
+        case GL_INT_SAMPLER_2D:
+        case GL_INT_SAMPLER_3D:
+        case GL_INT_SAMPLER_2D_ARRAY:
+        case GL_UNSIGNED_INT_SAMPLER_2D:
+        case GL_UNSIGNED_INT_SAMPLER_3D:
+        case GL_UNSIGNED_INT_SAMPLER_2D_ARRAY:
+            return true;
+    }
+
+    return false;
+}
+
+// Called once after linking, so drawing doesn't need string queries to the driver.
+// @NOTE: every sampler gets its own texture unit here, units are program state, so
+// materials of the same shader only bind their textures to them.
+static void ReflectShaderUniforms(Shader* shader) {
+    memset(shader->uniforms, 0, sizeof(shader->uniforms));
+    shader->uniformsCount = 0;
+    shader->uniformNamesSize = 0;
+    shader->uniformsComplete = true;
+
+    GLint count = 0;
+    glGetProgramInterfaceiv(shader->id, GL_UNIFORM, GL_ACTIVE_RESOURCES, &count);
+
+    int textureUnits = 0;
+
+    for(int i = 0; i < count; i++) {
+        GLenum properties[] = {GL_LOCATION, GL_TYPE, GL_ARRAY_SIZE};
+        GLint values[3] = {-1, 0, 1};
+        glGetProgramResourceiv(shader->id, GL_UNIFORM, i, 3, properties, 3, NULL, values);
+
+        // Uniform block members don't have locations
+        GLint location = values[0];
+        if(location == -1) {
+            continue;
+        }
+
+        // Array elements have consecutive locations
+        if(IsSamplerType((GLenum) values[1])) {
+            for(int e = 0; e < values[2]; e++) {
+                glProgramUniform1i(shader->id, location + e, textureUnits++);
+            }
+        }
+
+        char name[256];
+        GLsizei length = 0;
+        glGetProgramResourceName(shader->id, GL_UNIFORM, i, sizeof(name), &length, name);
+
+        AddShaderUniform(shader, name, length, location);
+
+        // Arrays are reported as "name[0]", but can be set with just the name
+        if(length > 3 && strcmp(name + length - 3, "[0]") == 0) {
+            AddShaderUniform(shader, name, length - 3, location);
+        }
+    }
+}
+
+int GetShaderUniformLocation(Shader* shader, const char* name) {
+    int length = (int) strlen(name);
+    uint32_t hash = HashUniformName(name, length);
+
+    uint32_t mask = SHADER_UNIFORM_SLOTS - 1;
+    for(uint32_t slot = hash & mask; ; slot = (slot + 1) & mask) {
+        ShaderUniform* uniform = shader->uniforms + slot;
+
+        if(uniform->nameHash == 0) {
+            break;
+        }
+
+        if(uniform->nameHash == hash && ShaderUniformNameEquals(shader, uniform, name, length)) {
+            return uniform->location;
+        }
+    }
+
+    // Array elements other than the first one aren't in the table
+    if(shader->uniformsComplete && strchr(name, '[') == NULL) {
+        return -1;
+    }
+
+    return glGetUniformLocation(shader->id, name);
+}
+
+// @NOTE: glad was generated without GL_KHR_parallel_shader_compile, ARB version uses the same values
+#define GL_MAX_SHADER_COMPILER_THREADS_KHR 0x91B0
+#define GL_COMPLETION_STATUS_KHR           0x91B1
+
+typedef void (APIENTRYP PFNGLMAXSHADERCOMPILERTHREADSKHRPROC)(GLuint count);
+
+// Without the extension completion can't be queried, PollShader finishes compilation right away
+static bool ParallelShaderCompile;
+
+void InitParallelShaderCompile() {
+    const char* functionName = NULL;
+    if(glfwExtensionSupported("GL_KHR_parallel_shader_compile")) {
+        functionName = "glMaxShaderCompilerThreadsKHR";
+    }
+    else if(glfwExtensionSupported("GL_ARB_parallel_shader_compile")) {
+        functionName = "glMaxShaderCompilerThreadsARB";
+    }
+
+    if(functionName == NULL) {
+        return;
+    }
+
+    PFNGLMAXSHADERCOMPILERTHREADSKHRPROC maxShaderCompilerThreads =
+        (PFNGLMAXSHADERCOMPILERTHREADSKHRPROC) glfwGetProcAddress(functionName);
+
+    // Lets the driver pick the threads count
+    if(maxShaderCompilerThreads) {
+        maxShaderCompilerThreads(0xFFFFFFFF);
+    }
+
+    ParallelShaderCompile = true;
+}
+
+Shader LoadShaderSourceAsync(const char *vertexShaderCode, const char *fragmentShaderCode)
 {
     Shader ret = {0};
 
+    ret.cacheKey = GetShaderCacheKey(vertexShaderCode, fragmentShaderCode);
+
+    ret.id = LoadCachedProgram(ret.cacheKey);
+    if(ret.id != 0) {
+        ReflectShaderUniforms(&ret);
+
+        ret.isValid = true;
+        return ret;
+    }
+
+    ret.compileStart = glfwGetTime();
+
+    // Statuses aren't queried here, so the driver doesn't have to wait for the compilation
     unsigned int vertexShader = glCreateShader(GL_VERTEX_SHADER);
     glShaderSource(vertexShader, 1, &vertexShaderCode, NULL);
     glCompileShader(vertexShader);
 
+    unsigned int fragmentShader = glCreateShader(GL_FRAGMENT_SHADER);
+    glShaderSource(fragmentShader, 1, &fragmentShaderCode, NULL);
+    glCompileShader(fragmentShader);
+
+    unsigned int shaderProgram = glCreateProgram();
+    glAttachShader(shaderProgram, vertexShader);
+    glAttachShader(shaderProgram, fragmentShader);
+    glProgramParameteri(shaderProgram, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+    glLinkProgram(shaderProgram);
+
+    ret.id = shaderProgram;
+    ret.pendingVertex = vertexShader;
+    ret.pendingFragment = fragmentShader;
+    ret.isPending = true;
+
+    return ret;
+}
+
+void FinishShader(Shader* shader) {
+    if(shader->isPending == false) {
+        return;
+    }
+
+    shader->isPending = false;
+
     int success;
     char infoLog[512];
-    glGetShaderiv(vertexShader, GL_COMPILE_STATUS, &success);
+    bool compiled = true;
+
+    glGetShaderiv(shader->pendingVertex, GL_COMPILE_STATUS, &success);
     if (!success)
     {
-        glGetShaderInfoLog(vertexShader, 512, NULL, infoLog);
+        glGetShaderInfoLog(shader->pendingVertex, 512, NULL, infoLog);
         fprintf(stderr, "[Error] Vertex Shader compilation failed: \n%s\n", infoLog);
 
-        return ret;
+        compiled = false;
     }
 
-    unsigned int fragmentShader = glCreateShader(GL_FRAGMENT_SHADER);
-    glShaderSource(fragmentShader, 1, &fragmentShaderCode, NULL);
-    glCompileShader(fragmentShader);
-    glGetShaderiv(fragmentShader, GL_COMPILE_STATUS, &success);
+    glGetShaderiv(shader->pendingFragment, GL_COMPILE_STATUS, &success);
     if (!success)
     {
-        glGetShaderInfoLog(fragmentShader, 512, NULL, infoLog);
+        glGetShaderInfoLog(shader->pendingFragment, 512, NULL, infoLog);
         fprintf(stderr, "[Error] Fragment shader compilation failed: \n%s\n", infoLog);
 
-        return ret;
+        compiled = false;
     }
 
-    unsigned int shaderProgram = glCreateProgram();
-    glAttachShader(shaderProgram, vertexShader);
-    glAttachShader(shaderProgram, fragmentShader);
-    glLinkProgram(shaderProgram);
-    glGetProgramiv(shaderProgram, GL_LINK_STATUS, &success);
-    if (!success)
-    {
-        glGetProgramInfoLog(shaderProgram, 512, NULL, infoLog);
-        printf("ERROR::SHADER::PROGRAM::LINKING_FAILED\n%s", infoLog);
+    if(compiled) {
+        glGetProgramiv(shader->id, GL_LINK_STATUS, &success);
+        if (!success)
+        {
+            glGetProgramInfoLog(shader->id, 512, NULL, infoLog);
+            printf("ERROR::SHADER::PROGRAM::LINKING_FAILED\n%s", infoLog);
 
-        return ret;
+            compiled = false;
+        }
     }
 
-    glDeleteShader(vertexShader);
-    glDeleteShader(fragmentShader);
+    glDeleteShader(shader->pendingVertex);
+    glDeleteShader(shader->pendingFragment);
 
-    ret.id = shaderProgram;
+    shader->pendingVertex = 0;
+    shader->pendingFragment = 0;
+
+    if(compiled == false) {
+        glDeleteProgram(shader->id);
+        shader->id = 0;
+
+        return;
+    }
+
+    CacheProgram(shader->cacheKey, shader->id, glfwGetTime() - shader->compileStart);
+    ReflectShaderUniforms(shader);
+
+    shader->isValid = true;
+}
+
+bool PollShader(Shader* shader) {
+    if(shader->isPending == false) {
+        return true;
+    }
+
+    if(ParallelShaderCompile) {
+        GLint completed = 0;
+        glGetProgramiv(shader->id, GL_COMPLETION_STATUS_KHR, &completed);
+        if(completed == 0) {
+            return false;
+        }
+    }
+
+    FinishShader(shader);
+    return true;
+}
+
+Shader LoadShaderSource(const char *vertexShaderCode, const char *fragmentShaderCode)
+{
+    Shader ret = LoadShaderSourceAsync(vertexShaderCode, fragmentShaderCode);
+    FinishShader(&ret);
 
-    ret.isValid = true;
     return ret;
 }
 
@@ -346,6 +719,13 @@ Shader LoadShaderFromFile(const char *vertexPath, const char *fragmentPath, Memo
         return {0};
     }
 
+    // Resolves #include directives, included files aren't checked by ReloadShaderIfNecessary
+    vertexSource   = PreprocessShader(vertexSource, NULL, 0, arena);
+    fragmentSource = vertexSource ? PreprocessShader(fragmentSource, NULL, 0, arena) : NULL;
+    if(fragmentSource == NULL) {
+        return {0};
+    }
+
     Shader shader = LoadShaderSource(vertexSource, fragmentSource);
 
     shader.vertFileData.changeTime  = Win32_GetLastWriteTime(vertexPath);
@@ -383,12 +763,23 @@ bool ReloadShaderIfNecessary(Shader* shader, MemoryArena* arena) {
 void UnloadShader(Shader* shader) {
     glDeleteProgram(shader->id);
 
+    if(shader->isPending) {
+        glDeleteShader(shader->pendingVertex);
+        glDeleteShader(shader->pendingFragment);
+
+        shader->isPending = false;
+    }
+
     shader->isValid = false;
     shader->id = -1;
+
+    shader->uniformsCount = 0;
+    shader->uniformNamesSize = 0;
+    memset(shader->uniforms, 0, sizeof(shader->uniforms));
 }
 
 void SetShaderUniform(SRWindow* window, char *name, int value) {
-    int loc = glGetUniformLocation(window->currentShader.id, name);
+    int loc = GetShaderUniformLocation(&window->currentShader, name);
     if (loc != -1) {
         glUniform1i(loc, value);
     }
@@ -399,7 +790,7 @@ void SetShaderUniform(SRWindow* window, char *name, int value) {
 }
 
 void SetShaderUniform(SRWindow* window, char *name, float value) {
-    int loc = glGetUniformLocation(window->currentShader.id, name);
+    int loc = GetShaderUniformLocation(&window->currentShader, name);
     if (loc != -1)
     {
         glUniform1f(loc, value);
@@ -411,7 +802,7 @@ void SetShaderUniform(SRWindow* window, char *name, float value) {
 }
 
 void SetShaderUniform(SRWindow* window, char *name, Vector2 value) {
-    int loc = glGetUniformLocation(window->currentShader.id, name);
+    int loc = GetShaderUniformLocation(&window->currentShader, name);
     if(loc != -1) {
         glUniform2f(loc, value.x, value.y);
     }
@@ -422,7 +813,7 @@ void SetShaderUniform(SRWindow* window, char *name, Vector2 value) {
 }
 
 void SetShaderUniform(SRWindow* window, char *name, Vector3 value){
-    int loc = glGetUniformLocation(window->currentShader.id, name);
+    int loc = GetShaderUniformLocation(&window->currentShader, name);
     if (loc != -1) {
         glUniform3f(loc, value.x, value.y, value.z);
     }
@@ -433,7 +824,7 @@ void SetShaderUniform(SRWindow* window, char *name, Vector3 value){
 }
 
 void SetShaderUniform(SRWindow* window, char *name, Vector4 value) {
-    int loc = glGetUniformLocation(window->currentShader.id, name);
+    int loc = GetShaderUniformLocation(&window->currentShader, name);
     if (loc != -1) {
         // glUniform4f(loc, value.x, value.y, value.z, value.w);
         glUniform4fv(loc, 1, (const float *)(&value));
@@ -445,7 +836,7 @@ void SetShaderUniform(SRWindow* window, char *name, Vector4 value) {
 }
 
 void SetShaderUniform(SRWindow* window, char* name, Matrix value) {
-    int loc = glGetUniformLocation(window->currentShader.id, name);
+    int loc = GetShaderUniformLocation(&window->currentShader, name);
     if (loc != -1) {
         // glUniform4f(loc, value.x, value.y, value.z, value.w);
         glUniformMatrix4fv(loc, 1, false, (const float *)(&value));
@@ -460,149 +851,592 @@ void SetShaderUniform(SRWindow* window, char* name, Matrix value) {
 // Meshes
 //=========================================
 
-void ApplyMesh(Mesh *mesh)
-{
-    for(int i = 0; i < mesh->triangles.length; i++) {
-        assert(mesh->triangles[i] < mesh->vertices.length);
+int GetGLTypeSize(GLenum type) {
+    switch(type) {
+        case GL_FLOAT:          return 4;
+        case GL_UNSIGNED_INT:   return 4;
+        case GL_SHORT:          return 2;
+        case GL_UNSIGNED_SHORT: return 2;
+        case GL_UNSIGNED_BYTE:  return 1;
+    }
+
+    assert(false);
+    return 0;
+}
+
+void PackIndices(Slice<int32_t> triangles, GLenum indexType, void* destination) {
+    if(indexType == GL_UNSIGNED_INT) {
+        memcpy(destination, triangles.data, triangles.length * sizeof(int32_t));
+        return;
+    }
+
+    assert(indexType == GL_UNSIGNED_SHORT);
+
+    uint16_t* dst = (uint16_t*) destination;
+    for(int i = 0; i < triangles.length; i++) {
+        assert(triangles.data[i] <= UINT16_MAX);
+        dst[i] = (uint16_t) triangles.data[i];
+    }
+}
+
+int GetMeshIndexCount(Mesh* mesh) {
+    return (int) (mesh->triangles.length + mesh->lodTriangles.length);
+}
+
+// @NOTE: 32 bit indices without LODs are uploaded straight from the mesh, so memory is allocated
+// only when conversion is needed. Use FreePackedMeshIndices to release returned pointer.
+void* PackMeshIndices(Mesh* mesh) {
+    if(mesh->indexType == GL_UNSIGNED_INT && mesh->lodTriangles.length == 0) {
+        return mesh->triangles.data;
+    }
+
+    int indexSize = GetGLTypeSize(mesh->indexType);
+
+    char* ret = (char*) malloc(GetMeshIndexCount(mesh) * indexSize);
+    assert(ret);
+
+    PackIndices(mesh->triangles, mesh->indexType, ret);
+    PackIndices(mesh->lodTriangles, mesh->indexType, ret + mesh->triangles.length * indexSize);
+
+    return ret;
+}
+
+void FreePackedMeshIndices(Mesh* mesh, void* indices) {
+    if(indices != mesh->triangles.data) {
+        free(indices);
     }
+}
+
+void SetSplitAttribute(GLuint vao, int index, GLuint buffer, int components, GLenum type = GL_FLOAT) {
+    glVertexArrayVertexBuffer(vao, index, buffer, 0, components * GetGLTypeSize(type));
+    glEnableVertexArrayAttrib(vao, index);
+    glVertexArrayAttribFormat(vao, index, components, type, GL_FALSE, 0);
+    glVertexArrayAttribBinding(vao, index, index);
+}
 
-    glGenVertexArrays(1, &mesh->VAO);
-    glGenBuffers(1, &mesh->positionsVBO);
-    glGenBuffers(1, &mesh->EBO);
+// @NOTE: VAO is created with DSA, so the current binding doesn't change.
+// Every attribute has its own buffer, bound at binding index equal to the attribute index.
+void ApplyMeshSplit(Mesh *mesh)
+{
+    glCreateVertexArrays(1, &mesh->VAO);
+    glCreateBuffers(1, &mesh->positionsVBO);
+    glCreateBuffers(1, &mesh->EBO);
 
-    glBindVertexArray(mesh->VAO);
-    glBindBuffer(GL_ARRAY_BUFFER, mesh->positionsVBO);
-    glBufferData(GL_ARRAY_BUFFER, mesh->vertices.length * sizeof(Vector3), mesh->vertices.data, GL_STATIC_DRAW);
+    glNamedBufferData(mesh->positionsVBO, mesh->vertices.length * sizeof(Vector3), mesh->vertices.data, GL_STATIC_DRAW);
+    SetSplitAttribute(mesh->VAO, VertexPositionIndex, mesh->positionsVBO, 3);
 
-    glVertexAttribPointer(VertexPositionIndex, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void *)0);
-    glEnableVertexAttribArray(VertexPositionIndex);
+    void* indexData = PackMeshIndices(mesh);
+    glNamedBufferData(mesh->EBO, GetMeshIndexCount(mesh) * GetGLTypeSize(mesh->indexType), indexData, GL_STATIC_DRAW);
+    FreePackedMeshIndices(mesh, indexData);
 
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mesh->EBO);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, mesh->triangles.length * sizeof(int), mesh->triangles.data, GL_STATIC_DRAW);
+    glVertexArrayElementBuffer(mesh->VAO, mesh->EBO);
 
     if (mesh->normals.length != 0)
     {
         assert(mesh->normals.length == mesh->vertices.length);
 
-        glGenBuffers(1, &mesh->normalsVBO);
-        glBindBuffer(GL_ARRAY_BUFFER, mesh->normalsVBO);
-        glBufferData(GL_ARRAY_BUFFER, mesh->normals.length * sizeof(Vector3), mesh->normals.data, GL_STATIC_DRAW);
-
-        glVertexAttribPointer(VertexNormalIndex, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void *)0);
-        glEnableVertexAttribArray(VertexNormalIndex);
+        glCreateBuffers(1, &mesh->normalsVBO);
+        glNamedBufferData(mesh->normalsVBO, mesh->normals.length * sizeof(Vector3), mesh->normals.data, GL_STATIC_DRAW);
+        SetSplitAttribute(mesh->VAO, VertexNormalIndex, mesh->normalsVBO, 3);
     }
 
     if (mesh->uv.length != 0)
     {
         assert(mesh->uv.length == mesh->vertices.length);
 
-        glGenBuffers(1, &mesh->uvVBO);
-        glBindBuffer(GL_ARRAY_BUFFER, mesh->uvVBO);
-        glBufferData(GL_ARRAY_BUFFER, mesh->uv.length * sizeof(Vector2), mesh->uv.data, GL_STATIC_DRAW);
-
-        glVertexAttribPointer(VertexUVIndex, 2, GL_FLOAT, GL_FALSE, 2 * sizeof(float), (void *)0);
-        glEnableVertexAttribArray(VertexUVIndex);
+        glCreateBuffers(1, &mesh->uvVBO);
+        glNamedBufferData(mesh->uvVBO, mesh->uv.length * sizeof(Vector2), mesh->uv.data, GL_STATIC_DRAW);
+        SetSplitAttribute(mesh->VAO, VertexUVIndex, mesh->uvVBO, 2);
     }
 
     if (mesh->colors.length != 0)
     {
         assert(mesh->colors.length == mesh->vertices.length);
 
-        glGenBuffers(1, &mesh->colorsVBO);
-        glBindBuffer(GL_ARRAY_BUFFER, mesh->colorsVBO);
-        glBufferData(GL_ARRAY_BUFFER, mesh->colors.length * sizeof(Vector4), mesh->colors.data, GL_STATIC_DRAW);
-
-        glVertexAttribPointer(VertexColorIndex, 4, GL_FLOAT, GL_FALSE, 4 * sizeof(float), (void *)0);
-        glEnableVertexAttribArray(VertexColorIndex);
+        glCreateBuffers(1, &mesh->colorsVBO);
+        glNamedBufferData(mesh->colorsVBO, mesh->colors.length * sizeof(Vector4), mesh->colors.data, GL_STATIC_DRAW);
+        SetSplitAttribute(mesh->VAO, VertexColorIndex, mesh->colorsVBO, 4);
     }
 
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
-    glBindVertexArray(0);
-}
+    if (mesh->joints.length != 0)
+    {
+        assert(mesh->joints.length == mesh->vertices.length);
+        assert(mesh->weights.length == mesh->vertices.length);
 
-void DeleteMesh(Mesh* mesh) {
-    assert(mesh);
+        // Joint indices are converted to floats, like in the other layouts
+        glCreateBuffers(1, &mesh->jointsVBO);
+        glNamedBufferData(mesh->jointsVBO, mesh->joints.length * sizeof(JointIndices), mesh->joints.data, GL_STATIC_DRAW);
+        SetSplitAttribute(mesh->VAO, VertexJointsIndex, mesh->jointsVBO, 4, GL_UNSIGNED_BYTE);
 
-    glDeleteVertexArrays(1, &mesh->VAO);
-    glDeleteBuffers(1, &mesh->EBO);
-    glDeleteBuffers(1, &mesh->positionsVBO);
-    glDeleteBuffers(1, &mesh->normalsVBO);
-    glDeleteBuffers(1, &mesh->colorsVBO);
-    glDeleteBuffers(1, &mesh->uvVBO);
+        glCreateBuffers(1, &mesh->weightsVBO);
+        glNamedBufferData(mesh->weightsVBO, mesh->weights.length * sizeof(Vector4), mesh->weights.data, GL_STATIC_DRAW);
+        SetSplitAttribute(mesh->VAO, VertexWeightsIndex, mesh->weightsVBO, 4);
+    }
 }
 
-Mesh CreateQuadMesh(MemoryArena* arena)
-{
-    Mesh mesh = {};
-    mesh.vertices = PushSliceToArena<Vector3>(arena, 4);
-    mesh.vertices[0] = {0.5f, 0.5f, 0.0f},   // top right
-    mesh.vertices[1] = {0.5f, -0.5f, 0.0f},   // top right
-    mesh.vertices[2] = {-0.5f, -0.5f, 0.0f},   // top right
-    mesh.vertices[3] = {-0.5f, 0.5f, 0.0f},   // top right
+uint32_t GetMeshAttributes(Mesh* mesh) {
+    uint32_t ret = 1 << VertexPositionIndex;
 
-    mesh.triangles = PushSliceToArena<int>(arena, 6);
-    mesh.triangles[0] = 0;
-    mesh.triangles[1] = 3;
-    mesh.triangles[2] = 1;
+    if(mesh->normals.length != 0) ret |= 1 << VertexNormalIndex;
+    if(mesh->uv.length != 0)      ret |= 1 << VertexUVIndex;
+    if(mesh->colors.length != 0)  ret |= 1 << VertexColorIndex;
+    if(mesh->joints.length != 0)  ret |= (1 << VertexJointsIndex) | (1 << VertexWeightsIndex);
 
-    mesh.triangles[3] = 1;
-    mesh.triangles[4] = 3;
-    mesh.triangles[5] = 2;
+    return ret;
+}
 
-    mesh.normals = PushSliceToArena<Vector3>(arena, 4);
-    mesh.normals[0] = {0, 0, 1};
-    mesh.normals[1] = {0, 0, 1};
-    mesh.normals[2] = {0, 0, 1};
-    mesh.normals[3] = {0, 0, 1};
+VertexFormat GetVertexFormat(Mesh* mesh, VertexLayout layout) {
+    return GetVertexFormat(GetMeshAttributes(mesh), layout);
+}
 
-    ApplyMesh(&mesh);
+VertexFormat GetVertexFormat(uint32_t meshAttributes, VertexLayout layout) {
+    VertexFormat format = {};
+    format.layout = layout;
 
-    return mesh;
-}
+    VertexAttributeFormat* attributes = format.attributes;
 
-Mesh CreateCubeMesh(MemoryArena* arena)
-{
-    Mesh mesh = {};
+    bool hasNormals = (meshAttributes & (1 << VertexNormalIndex)) != 0;
+    bool hasUV      = (meshAttributes & (1 << VertexUVIndex)) != 0;
+    bool hasColors  = (meshAttributes & (1 << VertexColorIndex)) != 0;
+    bool hasJoints  = (meshAttributes & (1 << VertexJointsIndex)) != 0;
 
-    mesh.vertices  = PushSliceToArena<Vector3>(arena, 24);
-    mesh.normals   = PushSliceToArena<Vector3>(arena, 24);
-    mesh.uv        = PushSliceToArena<Vector2>(arena, 24);
-    mesh.colors    = PushSliceToArena<Vector4>(arena, 24);
-    mesh.triangles = PushSliceToArena<int>(arena, 36);
+    if(layout == VertexLayout::Quantized) {
+        // @NOTE: positions use 4 components to keep every attribute 4 bytes aligned
+        attributes[VertexPositionIndex] = {true,       4, GL_UNSIGNED_SHORT, true};
+        attributes[VertexNormalIndex]   = {hasNormals, 2, GL_SHORT,          true};
+        attributes[VertexUVIndex]       = {hasUV,      2, GL_UNSIGNED_SHORT, true};
+        attributes[VertexColorIndex]    = {hasColors,  4, GL_UNSIGNED_BYTE,  true};
+        attributes[VertexJointsIndex]   = {hasJoints,  4, GL_UNSIGNED_BYTE,  false};
+        attributes[VertexWeightsIndex]  = {hasJoints,  4, GL_UNSIGNED_BYTE,  true};
+    }
+    else {
+        attributes[VertexPositionIndex] = {true,       3, GL_FLOAT, false};
+        attributes[VertexNormalIndex]   = {hasNormals, 3, GL_FLOAT, false};
+        attributes[VertexUVIndex]       = {hasUV,      2, GL_FLOAT, false};
+        attributes[VertexColorIndex]    = {hasColors,  4, GL_FLOAT, false};
+        attributes[VertexJointsIndex]   = {hasJoints,  4, GL_UNSIGNED_BYTE, false};
+        attributes[VertexWeightsIndex]  = {hasJoints,  4, GL_FLOAT, false};
+    }
 
-    // front
-    mesh.vertices[0] = {0.5f, 0.5f, 0.5f},   // top right 0
-    mesh.vertices[1] = {0.5f, -0.5f, 0.5f},  // bottom right 1
-    mesh.vertices[2] = {-0.5f, -0.5f, 0.5f}, // bottom left 2
-    mesh.vertices[3] = {-0.5f, 0.5f, 0.5f},  // top left 3
+    int offset = 0;
+    for(int i = 0; i < VertexAttributesCount; i++) {
+        if(attributes[i].enabled == false) {
+            continue;
+        }
 
-    mesh.colors[0] = {0, 0, 1, 1};
-    mesh.colors[1] = {0, 1, 0, 1};
-    mesh.colors[2] = {0, 1, 1, 1};
-    mesh.colors[3] = {1, 0, 0, 1};
+        attributes[i].offset = offset;
+        offset += attributes[i].components * GetGLTypeSize(attributes[i].type);
+    }
 
-    mesh.uv[0] = {1, 1};
-    mesh.uv[1] = {1, 0};
-    mesh.uv[2] = {0, 0};
-    mesh.uv[3] = {0, 1};
+    format.stride = offset;
+    return format;
+}
 
-    // back
-    mesh.vertices[4] = {0.5f, 0.5f, -0.5f},   // top right 4
-    mesh.vertices[5] = {0.5f, -0.5f, -0.5f},  // bottom right 5
-    mesh.vertices[6] = {-0.5f, -0.5f, -0.5f}, // bottom left 6
-    mesh.vertices[7] = {-0.5f, 0.5f, -0.5f},  // top left 7
+BoundingBox CalculateBounds(Slice<Vector3> vertices) {
+    BoundingBox ret = {};
+    if(vertices.length == 0) {
+        return ret;
+    }
 
-    mesh.colors[4] = {1, 0, 1, 1};
-    mesh.colors[5] = {1, 1, 0, 1};
-    mesh.colors[6] = {1, 1, 1, 1};
-    mesh.colors[7] = {0, 0, 0, 1};
+    ret.min = vertices.data[0];
+    ret.max = vertices.data[0];
 
-    mesh.uv[4] = {1, 1};
-    mesh.uv[5] = {1, 0};
-    mesh.uv[6] = {0, 0};
-    mesh.uv[7] = {0, 1};
+    for(int i = 1; i < vertices.length; i++) {
+        ret.min = Vector3Min(ret.min, vertices.data[i]);
+        ret.max = Vector3Max(ret.max, vertices.data[i]);
+    }
 
-    // left
+    return ret;
+}
+
+BoundingSphere CalculateBoundingSphere(Slice<Vector3> vertices, BoundingBox bounds) {
+    BoundingSphere ret = {};
+    ret.center = (bounds.min + bounds.max) * 0.5f;
+
+    float radiusSq = 0;
+    for(int i = 0; i < vertices.length; i++) {
+        radiusSq = fmaxf(radiusSq, Vector3DistanceSqr(vertices.data[i], ret.center));
+    }
+
+    ret.radius = sqrtf(radiusSq);
+    return ret;
+}
+
+float SignNotZero(float v) {
+    return v >= 0 ? 1.0f : -1.0f;
+}
+
+// Octahedral normal encoding, see "A Survey of Efficient Representations for Independent Unit Vectors"
+Vector2 OctahedralEncode(Vector3 n) {
+    float l1 = fabsf(n.x) + fabsf(n.y) + fabsf(n.z);
+    if(l1 == 0) {
+        return {0, 0};
+    }
+
+    Vector2 e = {n.x / l1, n.y / l1};
+    if(n.z < 0) {
+        e = Vector2{
+            (1 - fabsf(e.y)) * SignNotZero(e.x),
+            (1 - fabsf(e.x)) * SignNotZero(e.y)
+        };
+    }
+
+    return e;
+}
+
+Vector3 OctahedralDecode(Vector2 e) {
+    Vector3 v = {e.x, e.y, 1 - fabsf(e.x) - fabsf(e.y)};
+    if(v.z < 0) {
+        float x = v.x;
+        v.x = (1 - fabsf(v.y)) * SignNotZero(x);
+        v.y = (1 - fabsf(x))   * SignNotZero(v.y);
+    }
+
+    return Vector3Normalize(v);
+}
+
+uint16_t QuantizeUnorm16(float v) {
+    return (uint16_t) (Clamp(v, 0, 1) * 65535.0f + 0.5f);
+}
+
+int16_t QuantizeSnorm16(float v) {
+    v = Clamp(v, -1, 1) * 32767.0f;
+    return (int16_t) (v >= 0 ? v + 0.5f : v - 0.5f);
+}
+
+uint8_t QuantizeUnorm8(float v) {
+    return (uint8_t) (Clamp(v, 0, 1) * 255.0f + 0.5f);
+}
+
+// Written when format has an attribute the mesh doesn't have, same as GL default for disabled attribute
+const Vector4 MissingVertexColor = {0, 0, 0, 1};
+
+void PackVerticesQuantized(Mesh* mesh, VertexFormat format, void* destination) {
+    char* dst = (char*) destination;
+    VertexAttributeFormat* attributes = format.attributes;
+
+    Vector3 boundsMin  = mesh->bounds.min;
+    Vector3 boundsSize = mesh->bounds.max - mesh->bounds.min;
+
+    Vector3 invSize = {
+        boundsSize.x > 0 ? 1.0f / boundsSize.x : 0,
+        boundsSize.y > 0 ? 1.0f / boundsSize.y : 0,
+        boundsSize.z > 0 ? 1.0f / boundsSize.z : 0,
+    };
+
+    Vector2 invUVSize = {
+        mesh->uvSize.x > 0 ? 1.0f / mesh->uvSize.x : 0,
+        mesh->uvSize.y > 0 ? 1.0f / mesh->uvSize.y : 0,
+    };
+
+    for(int i = 0; i < mesh->vertices.length; i++) {
+        char* vertex = dst + (size_t) i * format.stride;
+
+        Vector3 p = mesh->vertices.data[i] - boundsMin;
+        uint16_t* position = (uint16_t*) (vertex + attributes[VertexPositionIndex].offset);
+        position[0] = QuantizeUnorm16(p.x * invSize.x);
+        position[1] = QuantizeUnorm16(p.y * invSize.y);
+        position[2] = QuantizeUnorm16(p.z * invSize.z);
+        position[3] = 0;
+
+        if(attributes[VertexNormalIndex].enabled) {
+            Vector2 e = mesh->normals.length != 0 ? OctahedralEncode(mesh->normals.data[i]) : Vector2{0, 0};
+
+            int16_t* normal = (int16_t*) (vertex + attributes[VertexNormalIndex].offset);
+            normal[0] = QuantizeSnorm16(e.x);
+            normal[1] = QuantizeSnorm16(e.y);
+        }
+
+        if(attributes[VertexUVIndex].enabled) {
+            Vector2 uv = mesh->uv.length != 0 ? mesh->uv.data[i] : Vector2{0, 0};
+
+            uint16_t* packedUV = (uint16_t*) (vertex + attributes[VertexUVIndex].offset);
+            packedUV[0] = QuantizeUnorm16((uv.x - mesh->uvMin.x) * invUVSize.x);
+            packedUV[1] = QuantizeUnorm16((uv.y - mesh->uvMin.y) * invUVSize.y);
+        }
+
+        if(attributes[VertexColorIndex].enabled) {
+            Vector4 c = mesh->colors.length != 0 ? mesh->colors.data[i] : MissingVertexColor;
+
+            uint8_t* color = (uint8_t*) (vertex + attributes[VertexColorIndex].offset);
+            color[0] = QuantizeUnorm8(c.x);
+            color[1] = QuantizeUnorm8(c.y);
+            color[2] = QuantizeUnorm8(c.z);
+            color[3] = QuantizeUnorm8(c.w);
+        }
+
+        if(attributes[VertexJointsIndex].enabled) {
+            Vector4 w = mesh->weights.data[i];
+
+            memcpy(vertex + attributes[VertexJointsIndex].offset, mesh->joints.data + i, sizeof(JointIndices));
+
+            uint8_t* weights = (uint8_t*) (vertex + attributes[VertexWeightsIndex].offset);
+            weights[0] = QuantizeUnorm8(w.x);
+            weights[1] = QuantizeUnorm8(w.y);
+            weights[2] = QuantizeUnorm8(w.z);
+            weights[3] = QuantizeUnorm8(w.w);
+        }
+    }
+}
+
+void PackVertices(Mesh* mesh, VertexFormat format, void* destination) {
+    assert(format.layout != VertexLayout::Split);
+
+    if(format.layout == VertexLayout::Quantized) {
+        PackVerticesQuantized(mesh, format, destination);
+        return;
+    }
+
+    char* dst = (char*) destination;
+    VertexAttributeFormat* attributes = format.attributes;
+
+    for(int i = 0; i < mesh->vertices.length; i++) {
+        char* vertex = dst + (size_t) i * format.stride;
+
+        memcpy(vertex + attributes[VertexPositionIndex].offset, mesh->vertices.data + i, sizeof(Vector3));
+
+        if(attributes[VertexNormalIndex].enabled) {
+            Vector3 normal = mesh->normals.length != 0 ? mesh->normals.data[i] : Vector3{0, 0, 0};
+            memcpy(vertex + attributes[VertexNormalIndex].offset, &normal, sizeof(Vector3));
+        }
+
+        if(attributes[VertexUVIndex].enabled) {
+            Vector2 uv = mesh->uv.length != 0 ? mesh->uv.data[i] : Vector2{0, 0};
+            memcpy(vertex + attributes[VertexUVIndex].offset, &uv, sizeof(Vector2));
+        }
+
+        if(attributes[VertexColorIndex].enabled) {
+            Vector4 color = mesh->colors.length != 0 ? mesh->colors.data[i] : MissingVertexColor;
+            memcpy(vertex + attributes[VertexColorIndex].offset, &color, sizeof(Vector4));
+        }
+
+        if(attributes[VertexJointsIndex].enabled) {
+            memcpy(vertex + attributes[VertexJointsIndex].offset, mesh->joints.data + i, sizeof(JointIndices));
+            memcpy(vertex + attributes[VertexWeightsIndex].offset, mesh->weights.data + i, sizeof(Vector4));
+        }
+    }
+}
+
+// @NOTE: all attributes are read from the vertex buffer binding 0
+void SetVertexArrayFormat(GLuint vao, VertexFormat format) {
+    for(int i = 0; i < VertexAttributesCount; i++) {
+        VertexAttributeFormat attribute = format.attributes[i];
+        if(attribute.enabled == false) {
+            continue;
+        }
+
+        glEnableVertexArrayAttrib(vao, i);
+        glVertexArrayAttribFormat(vao, i, attribute.components, attribute.type, attribute.normalized, attribute.offset);
+        glVertexArrayAttribBinding(vao, i, 0);
+    }
+}
+
+void ApplyMeshInterleaved(Mesh* mesh) {
+    if (mesh->normals.length != 0) assert(mesh->normals.length == mesh->vertices.length);
+    if (mesh->uv.length != 0)      assert(mesh->uv.length == mesh->vertices.length);
+    if (mesh->colors.length != 0)  assert(mesh->colors.length == mesh->vertices.length);
+    if (mesh->joints.length != 0)  assert(mesh->joints.length == mesh->vertices.length);
+    if (mesh->joints.length != 0)  assert(mesh->weights.length == mesh->vertices.length);
+
+    VertexFormat format = GetVertexFormat(mesh, mesh->layout);
+
+    size_t vertexDataSize = (size_t) format.stride * mesh->vertices.length;
+    void* vertexData = malloc(vertexDataSize);
+    assert(vertexData);
+
+    PackVertices(mesh, format, vertexData);
+
+    void* indexData = PackMeshIndices(mesh);
+    size_t indexDataSize = (size_t) GetMeshIndexCount(mesh) * GetGLTypeSize(mesh->indexType);
+
+    CreateMeshBuffers(mesh, format, vertexData, vertexDataSize, indexData, indexDataSize);
+
+    free(vertexData);
+    FreePackedMeshIndices(mesh, indexData);
+}
+
+void CreateMeshBuffers(Mesh* mesh, VertexFormat format, void* vertexData, uint64_t vertexDataSize,
+                       void* indexData, uint64_t indexDataSize)
+{
+    // Immutable storage, data never changes after upload
+    glCreateBuffers(1, &mesh->interleavedVBO);
+    glNamedBufferStorage(mesh->interleavedVBO, vertexDataSize, vertexData, 0);
+
+    glCreateBuffers(1, &mesh->EBO);
+    glNamedBufferStorage(mesh->EBO, indexDataSize, indexData, 0);
+
+    glCreateVertexArrays(1, &mesh->VAO);
+    glVertexArrayVertexBuffer(mesh->VAO, 0, mesh->interleavedVBO, 0, format.stride);
+    glVertexArrayElementBuffer(mesh->VAO, mesh->EBO);
+
+    SetVertexArrayFormat(mesh->VAO, format);
+}
+
+void ApplyMesh(Mesh *mesh, VertexLayout layout)
+{
+    for(int i = 0; i < mesh->triangles.length; i++) {
+        assert(mesh->triangles[i] < mesh->vertices.length);
+    }
+
+    for(int i = 0; i < mesh->lodTriangles.length; i++) {
+        assert(mesh->lodTriangles[i] < mesh->vertices.length);
+    }
+
+    if(mesh->VAO != 0 || mesh->heap) {
+        DeleteMesh(mesh);
+    }
+
+    SetMeshMetadata(mesh, layout);
+
+    switch(layout) {
+        case VertexLayout::Split:       ApplyMeshSplit(mesh);       break;
+        case VertexLayout::Interleaved: ApplyMeshInterleaved(mesh); break;
+        case VertexLayout::Quantized:   ApplyMeshInterleaved(mesh); break;
+    }
+}
+
+void SetMeshMetadata(Mesh* mesh, VertexLayout layout) {
+    mesh->layout = layout;
+    mesh->bounds = CalculateBounds(mesh->vertices);
+    mesh->boundingSphere = CalculateBoundingSphere(mesh->vertices, mesh->bounds);
+
+    mesh->uvMin  = {0, 0};
+    mesh->uvSize = {1, 1};
+    if(mesh->uv.length != 0) {
+        Vector2 uvMin = mesh->uv.data[0];
+        Vector2 uvMax = mesh->uv.data[0];
+
+        for(int i = 1; i < mesh->uv.length; i++) {
+            uvMin.x = fminf(uvMin.x, mesh->uv.data[i].x);
+            uvMin.y = fminf(uvMin.y, mesh->uv.data[i].y);
+            uvMax.x = fmaxf(uvMax.x, mesh->uv.data[i].x);
+            uvMax.y = fmaxf(uvMax.y, mesh->uv.data[i].y);
+        }
+
+        mesh->uvMin  = uvMin;
+        mesh->uvSize = uvMax - uvMin;
+    }
+
+    // Every index of mesh with at most 65536 vertices fits in 16 bits
+    mesh->indexType = mesh->vertices.length <= 65536 ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+
+    mesh->lods[0] = {0, (int32_t) mesh->triangles.length, 0};
+    if(mesh->lodCount == 0) {
+        mesh->lodCount = 1;
+    }
+}
+
+void CopyMeshMetadata(Mesh* destination, Mesh* source) {
+    destination->layout         = source->layout;
+    destination->bounds         = source->bounds;
+    destination->boundingSphere = source->boundingSphere;
+    destination->uvMin          = source->uvMin;
+    destination->uvSize         = source->uvSize;
+    destination->indexType      = source->indexType;
+    destination->lods[0]        = source->lods[0];
+    destination->lodCount       = source->lodCount;
+}
+
+void DeleteMesh(Mesh* mesh) {
+    assert(mesh);
+
+    if(mesh->heap) {
+        RemoveMeshFromHeap(mesh);
+    }
+
+    DeleteVertexArray(&mesh->VAO);
+    glDeleteBuffers(1, &mesh->EBO);
+    glDeleteBuffers(1, &mesh->positionsVBO);
+    glDeleteBuffers(1, &mesh->normalsVBO);
+    glDeleteBuffers(1, &mesh->colorsVBO);
+    glDeleteBuffers(1, &mesh->uvVBO);
+    glDeleteBuffers(1, &mesh->jointsVBO);
+    glDeleteBuffers(1, &mesh->weightsVBO);
+    glDeleteBuffers(1, &mesh->interleavedVBO);
+
+    mesh->VAO            = 0;
+    mesh->EBO            = 0;
+    mesh->positionsVBO   = 0;
+    mesh->normalsVBO     = 0;
+    mesh->colorsVBO      = 0;
+    mesh->uvVBO          = 0;
+    mesh->jointsVBO      = 0;
+    mesh->weightsVBO     = 0;
+    mesh->interleavedVBO = 0;
+}
+
+Mesh CreateQuadMesh(MemoryArena* arena)
+{
+    Mesh mesh = {};
+    mesh.vertices = PushSliceToArena<Vector3>(arena, 4);
+    mesh.vertices[0] = {0.5f, 0.5f, 0.0f},   // top right
+    mesh.vertices[1] = {0.5f, -0.5f, 0.0f},   // top right
+    mesh.vertices[2] = {-0.5f, -0.5f, 0.0f},   // top right
+    mesh.vertices[3] = {-0.5f, 0.5f, 0.0f},   // top right
+
+    mesh.triangles = PushSliceToArena<int>(arena, 6);
+    mesh.triangles[0] = 0;
+    mesh.triangles[1] = 3;
+    mesh.triangles[2] = 1;
+
+    mesh.triangles[3] = 1;
+    mesh.triangles[4] = 3;
+    mesh.triangles[5] = 2;
+
+    mesh.normals = PushSliceToArena<Vector3>(arena, 4);
+    mesh.normals[0] = {0, 0, 1};
+    mesh.normals[1] = {0, 0, 1};
+    mesh.normals[2] = {0, 0, 1};
+    mesh.normals[3] = {0, 0, 1};
+
+    ApplyMesh(&mesh);
+
+    return mesh;
+}
+
+Mesh CreateCubeMesh(MemoryArena* arena)
+{
+    Mesh mesh = {};
+
+    mesh.vertices  = PushSliceToArena<Vector3>(arena, 24);
+    mesh.normals   = PushSliceToArena<Vector3>(arena, 24);
+    mesh.uv        = PushSliceToArena<Vector2>(arena, 24);
+    mesh.colors    = PushSliceToArena<Vector4>(arena, 24);
+    mesh.triangles = PushSliceToArena<int>(arena, 36);
+
+    // front
+    mesh.vertices[0] = {0.5f, 0.5f, 0.5f},   // top right 0
+    mesh.vertices[1] = {0.5f, -0.5f, 0.5f},  // bottom right 1
+    mesh.vertices[2] = {-0.5f, -0.5f, 0.5f}, // bottom left 2
+    mesh.vertices[3] = {-0.5f, 0.5f, 0.5f},  // top left 3
+
+    mesh.colors[0] = {0, 0, 1, 1};
+    mesh.colors[1] = {0, 1, 0, 1};
+    mesh.colors[2] = {0, 1, 1, 1};
+    mesh.colors[3] = {1, 0, 0, 1};
+
+    mesh.uv[0] = {1, 1};
+    mesh.uv[1] = {1, 0};
+    mesh.uv[2] = {0, 0};
+    mesh.uv[3] = {0, 1};
+
+    // back
+    mesh.vertices[4] = {0.5f, 0.5f, -0.5f},   // top right 4
+    mesh.vertices[5] = {0.5f, -0.5f, -0.5f},  // bottom right 5
+    mesh.vertices[6] = {-0.5f, -0.5f, -0.5f}, // bottom left 6
+    mesh.vertices[7] = {-0.5f, 0.5f, -0.5f},  // top left 7
+
+    mesh.colors[4] = {1, 0, 1, 1};
+    mesh.colors[5] = {1, 1, 0, 1};
+    mesh.colors[6] = {1, 1, 1, 1};
+    mesh.colors[7] = {0, 0, 0, 1};
+
+    mesh.uv[4] = {1, 1};
+    mesh.uv[5] = {1, 0};
+    mesh.uv[6] = {0, 0};
+    mesh.uv[7] = {0, 1};
+
+    // left
     mesh.vertices[8] = {-0.5f, 0.5f, 0.5f},   // top front 8
     mesh.vertices[9] = {-0.5f, -0.5f, 0.5f},  // bottom front 9
     mesh.vertices[10] = {-0.5f, -0.5f, -0.5f}, // bottom back 10
@@ -656,197 +1490,695 @@ Mesh CreateCubeMesh(MemoryArena* arena)
     mesh.vertices[22] = {0.5f, -0.5f, -0.5f},  // right back 22
     mesh.vertices[23] = {-0.5f, -0.5f, -0.5f}, // left back 23
 
-    mesh.colors[20] = {0, 1, 1, 1};
-    mesh.colors[21] = {0, 1, 0, 1};
-    mesh.colors[22] = {1, 1, 0, 1};
-    mesh.colors[23] = {1, 1, 1, 1};
+    mesh.colors[20] = {0, 1, 1, 1};
+    mesh.colors[21] = {0, 1, 0, 1};
+    mesh.colors[22] = {1, 1, 0, 1};
+    mesh.colors[23] = {1, 1, 1, 1};
+
+    mesh.uv[20] = {1, 1};
+    mesh.uv[21] = {1, 0};
+    mesh.uv[22] = {0, 0};
+    mesh.uv[23] = {0, 1};
+
+    // {
+    //     0, 2, 1,    //
+    //     0, 3, 2,    // front
+    //     4, 5, 6,    //
+    //     4, 6, 7,    // back
+    //     8, 10, 9,   //
+    //     8, 11, 10,  // left
+    //     12, 13, 14, //
+    //     12, 14, 15, // right
+    //     16, 17, 18, //
+    //     16, 18, 19, // top
+    //     20, 23, 22, //
+    //     20, 22, 21  // bottom
+    // };
+
+    mesh.triangles[0] = 0; mesh.triangles[1] = 2; mesh.triangles[2] = 1;
+    mesh.triangles[3] = 0; mesh.triangles[4] = 3; mesh.triangles[5] = 2; // front
+
+    mesh.triangles[6] = 4; mesh.triangles[7]  = 5;  mesh.triangles[8] = 6;
+    mesh.triangles[9] = 4; mesh.triangles[10] = 6; mesh.triangles[11] = 7; // back
+
+    mesh.triangles[12] = 8; mesh.triangles[13] = 10; mesh.triangles[14] = 9;
+    mesh.triangles[15] = 8; mesh.triangles[16] = 11; mesh.triangles[17] = 10; // left
+    
+    mesh.triangles[18] = 12; mesh.triangles[19] = 13; mesh.triangles[20] = 14;
+    mesh.triangles[21] = 12; mesh.triangles[22] = 14; mesh.triangles[23] = 15; // right
+
+    mesh.triangles[24] = 16; mesh.triangles[25] = 17; mesh.triangles[26] = 18;
+    mesh.triangles[27] = 16; mesh.triangles[28] = 18; mesh.triangles[29] = 19; // top
+
+    mesh.triangles[30] = 20; mesh.triangles[31] = 23; mesh.triangles[32] = 22;
+    mesh.triangles[33] = 20; mesh.triangles[34] = 22; mesh.triangles[35] = 21; // bottm
+
+    CalculateNormals(&mesh);
+    ApplyMesh(&mesh);
+
+    return mesh;
+}
+
+// Fills quads of a (columns x rows) grid. Vertex of the grid cell (x, y) is at
+// firstVertex + x + y * vertexStride
+static void FillGridTriangles(int32_t* triangles, int columns, int rows, int vertexStride, int firstVertex) {
+    int index = 0;
+    for(int y = 0; y < rows; y++) {
+        int rowStart = firstVertex + y * vertexStride;
+
+        for(int x = 0; x < columns; x++) {
+            int idx = rowStart + x;
+
+            triangles[index++] = idx;
+            triangles[index++] = idx + vertexStride + 1;
+            triangles[index++] = idx + 1;
+
+            triangles[index++] = idx;
+            triangles[index++] = idx + vertexStride;
+            triangles[index++] = idx + vertexStride + 1;
+        }
+    }
+}
+
+// Fills vertices of the plane grid from (firstX, firstY), in rows of the given width
+static void FillPlaneVertices(Vector3* vertices, Vector3* normals, int firstX, int firstY, int columns, int rows,
+                              float spacing, float offset)
+{
+    for(int y = 0; y < rows; y++) {
+        float posZ = (float) (firstY + y) * spacing - offset;
+
+        Vector3* rowVertices = vertices + y * columns;
+        Vector3* rowNormals  = normals + y * columns;
+        for(int x = 0; x < columns; x++) {
+            rowVertices[x] = {(float) (firstX + x) * spacing - offset, 0, posZ};
+            rowNormals[x]  = {0, 1, 0};
+        }
+    }
+}
+
+Mesh CreatePlaneMesh(MemoryArena* arena, int resolution, float size) {
+    assert(resolution >= 2);
+
+    Mesh mesh = {};
+
+    int vertsCount     = resolution * resolution;
+    int trianglesCount = (resolution - 1) * (resolution - 1) * 6;
+
+    mesh.vertices  = PushSliceToArena<Vector3>(arena, vertsCount);
+    mesh.normals   = PushSliceToArena<Vector3>(arena, vertsCount);
+    mesh.triangles = PushSliceToArena<int>(arena, trianglesCount);
+
+    float spacing = size / (resolution - 1);
+    FillPlaneVertices(mesh.vertices.data, mesh.normals.data, 0, 0, resolution, resolution, spacing, size / 2.0f);
+    FillGridTriangles(mesh.triangles.data, resolution - 1, resolution - 1, resolution, 0);
+
+    ApplyMesh(&mesh);
+    return mesh;
+}
+
+void GeneratePlaneChunks(int resolution, float size, int chunkResolution, MemoryArena* arena,
+                         MeshChunkCallback callback, void* userData)
+{
+    assert(resolution >= 2 && chunkResolution >= 1);
+    assert(arena && callback);
+
+    float spacing = size / (resolution - 1);
+    int quads = resolution - 1;
+
+    // Every chunk has the same size, except the last row and column
+    int maxVertsCount     = (chunkResolution + 1) * (chunkResolution + 1);
+    int maxTrianglesCount = chunkResolution * chunkResolution * 6;
+
+    uint64_t arenaPos = GetArenaPos(arena);
+
+    Slice<Vector3> vertices  = PushSliceToArena<Vector3>(arena, maxVertsCount);
+    Slice<Vector3> normals   = PushSliceToArena<Vector3>(arena, maxVertsCount);
+    Slice<int32_t> triangles = PushSliceToArena<int32_t>(arena, maxTrianglesCount);
+
+    for(int chunkY = 0; chunkY * chunkResolution < quads; chunkY++)
+    for(int chunkX = 0; chunkX * chunkResolution < quads; chunkX++) {
+        MeshChunk chunk = {};
+        chunk.x = chunkX * chunkResolution;
+        chunk.y = chunkY * chunkResolution;
+
+        int columns = quads - chunk.x < chunkResolution ? quads - chunk.x : chunkResolution;
+        int rows    = quads - chunk.y < chunkResolution ? quads - chunk.y : chunkResolution;
+
+        // Border vertices are shared with neighbours, so chunks stitch without cracks
+        chunk.mesh.vertices  = MakeSlice(vertices.data, 0, (columns + 1) * (rows + 1));
+        chunk.mesh.normals   = MakeSlice(normals.data, 0, (columns + 1) * (rows + 1));
+        chunk.mesh.triangles = MakeSlice(triangles.data, 0, columns * rows * 6);
+
+        FillPlaneVertices(vertices.data, normals.data, chunk.x, chunk.y, columns + 1, rows + 1, spacing, size / 2.0f);
+        FillGridTriangles(triangles.data, columns, rows, columns + 1, 0);
+
+        callback(&chunk, userData);
+    }
+
+    PopArenaTo(arena, arenaPos);
+}
+
+Mesh CreateUVSphereMesh(MemoryArena* arena, int segments, int rings)
+{
+    assert(segments >= 3 && rings >= 2);
+
+    Mesh mesh = {};
+
+    int vertsCount     = (rings - 1) * segments + 2;
+    int trianglesCount = (rings - 2) * segments * 6 + 2 * (segments * 3);
+
+    mesh.vertices  = PushSliceToArena<Vector3>(arena, vertsCount);
+    mesh.normals   = PushSliceToArena<Vector3>(arena, vertsCount);
+    mesh.triangles = PushSliceToArena<int>(arena, trianglesCount);
+
+    uint64_t arenaPos = GetArenaPos(arena);
+
+    // Every ring uses the same angles, so they are calculated once
+    double* segmentSin = (double*) PushArena(arena, segments * sizeof(double));
+    double* segmentCos = (double*) PushArena(arena, segments * sizeof(double));
+    for(int j = 0; j < segments; j++) {
+        double a = 2.0 * PI * (double) j / segments;
+        segmentSin[j] = sin(a);
+        segmentCos[j] = cos(a);
+    }
+
+    Vector3* vertices = mesh.vertices.data;
+
+    vertices[0] = {0, 1, 0};
+    for(int i = 0; i < rings - 1; i++) {
+        double p = PI * (double) (i + 1) / rings;
+        double pSin = sin(p);
+        double pCos = cos(p);
+
+        Vector3* ring = vertices + 1 + i * segments;
+        for(int j = 0; j < segments; j++) {
+            ring[j] = { (float) (pSin * segmentCos[j]), (float) pCos, (float) (pSin * segmentSin[j]) };
+        }
+    }
+    vertices[vertsCount - 1] = {0, -1, 0};
+
+    PopArenaTo(arena, arenaPos);
+
+    int32_t* triangles = mesh.triangles.data;
+    int index = 0;
+    for(int i = 0; i < segments; i++) {
+        triangles[index++] = 0;
+        triangles[index++] = ((i + 1) % segments) + 1;
+        triangles[index++] = i + 1;
+    }
+
+    for (int y = 0; y < rings - 2; y++) {
+        for (int x = 0; x < segments; x++) {
+            int idx = x + y * segments + 1;
+
+            int t1 = idx;
+            int t2 = (x == segments - 1) ? idx - segments + 1 : idx + 1;
+            int t3 = idx + segments;
+            int t4 = (x == segments - 1) ? idx + 1 : idx + segments + 1;
+
+            triangles[index++] = t1;
+            triangles[index++] = t2;
+            triangles[index++] = t4;
+
+            triangles[index++] = t1;
+            triangles[index++] = t4;
+            triangles[index++] = t3;
+        }
+    }
+
+    for(int i = 0; i < segments; i++) {
+        triangles[index++] = vertsCount - 1;
+        triangles[index++] = (i == segments - 1) ? vertsCount - 2 : vertsCount - 3 - i;
+        triangles[index++] = vertsCount - 2 - i;
+    }
+
+    CalculateNormals(&mesh);
+    ApplyMesh(&mesh);
+
+    return mesh;
+}
+
+// Open addressing map from the edge to its midpoint vertex
+struct IcosphereEdgeMap {
+    uint64_t* keys;
+    int32_t*  values;
+    uint64_t  mask;
+};
+
+static int32_t GetEdgeMidpoint(IcosphereEdgeMap* map, Vector3* vertices, int* vertsCount, int32_t a, int32_t b) {
+    // @NOTE: a != b, so key is never 0, which marks empty slot
+    uint64_t key = a < b ? ((uint64_t) a << 32 | (uint64_t) b) : ((uint64_t) b << 32 | (uint64_t) a);
+    uint64_t slot = (key * 0x9E3779B97F4A7C15ull) >> 32 & map->mask;
+
+    while(map->keys[slot] != 0) {
+        if(map->keys[slot] == key) {
+            return map->values[slot];
+        }
+
+        slot = (slot + 1) & map->mask;
+    }
+
+    int32_t index = (*vertsCount)++;
+    vertices[index] = Vector3Normalize(vertices[a] + vertices[b]);
+
+    map->keys[slot]   = key;
+    map->values[slot] = index;
+
+    return index;
+}
+
+Mesh CreateIcosphereMesh(MemoryArena* arena, int subdivisions) {
+    assert(subdivisions >= 0 && subdivisions <= 10);
+
+    Mesh mesh = {};
+
+    int vertsCount     = 10 * (1 << (2 * subdivisions)) + 2;
+    int trianglesCount = 20 * (1 << (2 * subdivisions)) * 3;
+
+    mesh.vertices  = PushSliceToArena<Vector3>(arena, vertsCount);
+    mesh.normals   = PushSliceToArena<Vector3>(arena, vertsCount);
+    mesh.triangles = PushSliceToArena<int>(arena, trianglesCount);
+
+    const float t = (1.0f + sqrtf(5.0f)) / 2.0f;
+    Vector3 baseVertices[12] = {
+        {-1,  t,  0}, { 1,  t,  0}, {-1, -t,  0}, { 1, -t,  0},
+        { 0, -1,  t}, { 0,  1,  t}, { 0, -1, -t}, { 0,  1, -t},
+        { t,  0, -1}, { t,  0,  1}, {-t,  0, -1}, {-t,  0,  1},
+    };
+
+    int32_t baseTriangles[60] = {
+        0, 11, 5,   0, 5, 1,    0, 1, 7,    0, 7, 10,   0, 10, 11,
+        1, 5, 9,    5, 11, 4,   11, 10, 2,  10, 7, 6,   7, 1, 8,
+        3, 9, 4,    3, 4, 2,    3, 2, 6,    3, 6, 8,    3, 8, 9,
+        4, 9, 5,    2, 4, 11,   6, 2, 10,   8, 6, 7,    9, 8, 1,
+    };
 
-    mesh.uv[20] = {1, 1};
-    mesh.uv[21] = {1, 0};
-    mesh.uv[22] = {0, 0};
-    mesh.uv[23] = {0, 1};
+    int currentVertsCount = 12;
+    for(int i = 0; i < 12; i++) {
+        mesh.vertices[i] = Vector3Normalize(baseVertices[i]);
+    }
 
-    // {
-    //     0, 2, 1,    //
-    //     0, 3, 2,    // front
-    //     4, 5, 6,    //
-    //     4, 6, 7,    // back
-    //     8, 10, 9,   //
-    //     8, 11, 10,  // left
-    //     12, 13, 14, //
-    //     12, 14, 15, // right
-    //     16, 17, 18, //
-    //     16, 18, 19, // top
-    //     20, 23, 22, //
-    //     20, 22, 21  // bottom
-    // };
+    uint64_t arenaPos = GetArenaPos(arena);
 
-    mesh.triangles[0] = 0; mesh.triangles[1] = 2; mesh.triangles[2] = 1;
-    mesh.triangles[3] = 0; mesh.triangles[4] = 3; mesh.triangles[5] = 2; // front
+    // Every subdivision swaps source and destination buffers, so the last one ends up in the mesh
+    int32_t* scratch = subdivisions > 0 ? (int32_t*) PushArena(arena, (trianglesCount / 4) * sizeof(int32_t)) : NULL;
+    int32_t* source = (subdivisions % 2 == 0) ? mesh.triangles.data : scratch;
+    memcpy(source, baseTriangles, sizeof(baseTriangles));
 
-    mesh.triangles[6] = 4; mesh.triangles[7]  = 5;  mesh.triangles[8] = 6;
-    mesh.triangles[9] = 4; mesh.triangles[10] = 6; mesh.triangles[11] = 7; // back
+    // Every edge is shared by two triangles
+    uint64_t mapSize = 1;
+    while(mapSize < (uint64_t) trianglesCount / 4) {
+        mapSize <<= 1;
+    }
 
-    mesh.triangles[12] = 8; mesh.triangles[13] = 10; mesh.triangles[14] = 9;
-    mesh.triangles[15] = 8; mesh.triangles[16] = 11; mesh.triangles[17] = 10; // left
-    
-    mesh.triangles[18] = 12; mesh.triangles[19] = 13; mesh.triangles[20] = 14;
-    mesh.triangles[21] = 12; mesh.triangles[22] = 14; mesh.triangles[23] = 15; // right
+    IcosphereEdgeMap map = {};
+    map.keys   = (uint64_t*) PushArena(arena, mapSize * sizeof(uint64_t));
+    map.values = (int32_t*) PushArena(arena, mapSize * sizeof(int32_t));
+    map.mask   = mapSize - 1;
+
+    int sourceTriangles = 20;
+    for(int level = 0; level < subdivisions; level++) {
+        int32_t* destination = source == scratch ? mesh.triangles.data : scratch;
+        memset(map.keys, 0, mapSize * sizeof(uint64_t));
+
+        int index = 0;
+        for(int i = 0; i < sourceTriangles; i++) {
+            int32_t a = source[i * 3 + 0];
+            int32_t b = source[i * 3 + 1];
+            int32_t c = source[i * 3 + 2];
+
+            int32_t ab = GetEdgeMidpoint(&map, mesh.vertices.data, &currentVertsCount, a, b);
+            int32_t bc = GetEdgeMidpoint(&map, mesh.vertices.data, &currentVertsCount, b, c);
+            int32_t ca = GetEdgeMidpoint(&map, mesh.vertices.data, &currentVertsCount, c, a);
+
+            destination[index++] = a;  destination[index++] = ab; destination[index++] = ca;
+            destination[index++] = b;  destination[index++] = bc; destination[index++] = ab;
+            destination[index++] = c;  destination[index++] = ca; destination[index++] = bc;
+            destination[index++] = ab; destination[index++] = bc; destination[index++] = ca;
+        }
 
-    mesh.triangles[24] = 16; mesh.triangles[25] = 17; mesh.triangles[26] = 18;
-    mesh.triangles[27] = 16; mesh.triangles[28] = 18; mesh.triangles[29] = 19; // top
+        source = destination;
+        sourceTriangles *= 4;
+    }
 
-    mesh.triangles[30] = 20; mesh.triangles[31] = 23; mesh.triangles[32] = 22;
-    mesh.triangles[33] = 20; mesh.triangles[34] = 22; mesh.triangles[35] = 21; // bottm
+    assert(currentVertsCount == vertsCount);
+    PopArenaTo(arena, arenaPos);
 
-    CalculateNormals(&mesh);
-    ApplyMesh(&mesh);
+    // Vertices are on the unit sphere, so they are their own normals
+    memcpy(mesh.normals.data, mesh.vertices.data, vertsCount * sizeof(Vector3));
 
+    ApplyMesh(&mesh);
     return mesh;
 }
 
-Mesh CreatePlaneMesh(MemoryArena* arena) {
+Mesh CreateCylinderMesh(MemoryArena* arena, int segments, int heightSegments, float radius, float height) {
+    assert(segments >= 3 && heightSegments >= 1);
+
     Mesh mesh = {};
 
-    const int meshSize = 11;
+    // Side has a seam column for UVs, caps have their own vertices for hard edges
+    int sideVertsCount = (segments + 1) * (heightSegments + 1);
+    int capVertsCount  = segments + 1;
 
-    int vertsCount     = meshSize * meshSize;
-    int trianglesCount = (meshSize - 1) * (meshSize - 1) * 6;
+    int vertsCount     = sideVertsCount + 2 * capVertsCount;
+    int trianglesCount = segments * heightSegments * 6 + 2 * segments * 3;
 
     mesh.vertices  = PushSliceToArena<Vector3>(arena, vertsCount);
     mesh.normals   = PushSliceToArena<Vector3>(arena, vertsCount);
+    mesh.uv        = PushSliceToArena<Vector2>(arena, vertsCount);
     mesh.triangles = PushSliceToArena<int>(arena, trianglesCount);
 
-    float offset = meshSize / 2.0f - 0.5f;
+    uint64_t arenaPos = GetArenaPos(arena);
+
+    float* segmentSin = (float*) PushArena(arena, (segments + 1) * sizeof(float));
+    float* segmentCos = (float*) PushArena(arena, (segments + 1) * sizeof(float));
+    for(int j = 0; j <= segments; j++) {
+        float a = 2.0f * PI * (float) (j % segments) / segments;
+        segmentSin[j] = sinf(a);
+        segmentCos[j] = cosf(a);
+    }
+
+    Vector3* vertices = mesh.vertices.data;
+    Vector3* normals  = mesh.normals.data;
+    Vector2* uv       = mesh.uv.data;
+
+    for(int i = 0; i <= heightSegments; i++) {
+        float v = (float) i / heightSegments;
+        float posY = -height / 2.0f + height * v;
 
-    for(int y = 0; y < meshSize; y++) {
-        for(int x = 0; x < meshSize; x++) {
-            int idx = x + y * meshSize;
-            mesh.vertices[idx] = {(float) x - offset, 0, (float) y - offset};
-            mesh.normals[idx]  = {0, 1, 0};
+        int row = i * (segments + 1);
+        for(int j = 0; j <= segments; j++) {
+            vertices[row + j] = {radius * segmentCos[j], posY, radius * segmentSin[j]};
+            normals[row + j]  = {segmentCos[j], 0, segmentSin[j]};
+            uv[row + j]       = {(float) j / segments, v};
         }
     }
 
-    int index = 0;
-    for (int y = 0; y < meshSize - 1; y++) {
-        for (int x = 0; x < meshSize - 1; x++) {
-            int idx = x + y * meshSize;
+    int32_t* triangles = mesh.triangles.data;
+    FillGridTriangles(triangles, segments, heightSegments, segments + 1, 0);
+
+    int index = segments * heightSegments * 6;
+    for(int cap = 0; cap < 2; cap++) {
+        float side = cap == 0 ? 1.0f : -1.0f;
+        int center = sideVertsCount + cap * capVertsCount;
+
+        vertices[center] = {0, side * height / 2.0f, 0};
+        normals[center]  = {0, side, 0};
+        uv[center]       = {0.5f, 0.5f};
+
+        for(int j = 0; j < segments; j++) {
+            vertices[center + 1 + j] = {radius * segmentCos[j], side * height / 2.0f, radius * segmentSin[j]};
+            normals[center + 1 + j]  = {0, side, 0};
+            uv[center + 1 + j]       = {0.5f + 0.5f * segmentCos[j], 0.5f + 0.5f * segmentSin[j]};
+        }
 
-            mesh.triangles[index++] = idx;
-            mesh.triangles[index++] = idx + meshSize + 1;
-            mesh.triangles[index++] = idx + 1;
+        // Bottom cap is facing the other way
+        for(int j = 0; j < segments; j++) {
+            int current = center + 1 + j;
+            int next    = center + 1 + (j + 1) % segments;
 
-            mesh.triangles[index++] = idx;
-            mesh.triangles[index++] = idx + meshSize;
-            mesh.triangles[index++] = idx + meshSize + 1;
+            triangles[index++] = center;
+            triangles[index++] = cap == 0 ? next : current;
+            triangles[index++] = cap == 0 ? current : next;
         }
     }
 
+    PopArenaTo(arena, arenaPos);
+
     ApplyMesh(&mesh);
     return mesh;
 }
 
+Mesh CreateTorusMesh(MemoryArena* arena, int majorSegments, int minorSegments, float majorRadius, float minorRadius) {
+    assert(majorSegments >= 3 && minorSegments >= 3);
 
-Mesh CreateUVSphereMesh(MemoryArena* arena)
-{
     Mesh mesh = {};
 
-    const int meshSize = 16;
-
-    int vertsCount     = (meshSize - 1) * meshSize + 2;
-    int trianglesCount = (meshSize - 1) * (meshSize - 1) * 6 + 2 * ((meshSize - 1) * 3);
+    // Seam row and column are duplicated for UVs
+    int vertsCount     = (majorSegments + 1) * (minorSegments + 1);
+    int trianglesCount = majorSegments * minorSegments * 6;
 
     mesh.vertices  = PushSliceToArena<Vector3>(arena, vertsCount);
     mesh.normals   = PushSliceToArena<Vector3>(arena, vertsCount);
+    mesh.uv        = PushSliceToArena<Vector2>(arena, vertsCount);
     mesh.triangles = PushSliceToArena<int>(arena, trianglesCount);
 
-    int index = 0;
-    mesh.vertices[index++] = {0, 1, 0};
-    for(int i = 0; i < meshSize - 1; i++) {
-        double p = PI * (double) (i + 1) / meshSize;
-        double pSin = sin(p);
-        double pCos = cos(p);
+    uint64_t arenaPos = GetArenaPos(arena);
+
+    float* majorSin = (float*) PushArena(arena, (majorSegments + 1) * sizeof(float));
+    float* majorCos = (float*) PushArena(arena, (majorSegments + 1) * sizeof(float));
+    for(int j = 0; j <= majorSegments; j++) {
+        float a = 2.0f * PI * (float) (j % majorSegments) / majorSegments;
+        majorSin[j] = sinf(a);
+        majorCos[j] = cosf(a);
+    }
+
+    Vector3* vertices = mesh.vertices.data;
+    Vector3* normals  = mesh.normals.data;
+    Vector2* uv       = mesh.uv.data;
 
-        for(int j = 0; j < meshSize; j++) {
-            double a = 2.0 * PI * (double) j / meshSize;
-            double aSin = sin(a);
-            double aCos = cos(a);
+    for(int i = 0; i <= minorSegments; i++) {
+        float a = 2.0f * PI * (float) (i % minorSegments) / minorSegments;
+        float minorSin = sinf(a);
+        float minorCos = cosf(a);
 
-            mesh.vertices[index++] = { (float) (pSin * aCos), (float) pCos, (float) (pSin * aSin) };
+        float ringRadius = majorRadius + minorRadius * minorCos;
+        float v = (float) i / minorSegments;
+
+        int row = i * (majorSegments + 1);
+        for(int j = 0; j <= majorSegments; j++) {
+            vertices[row + j] = {ringRadius * majorCos[j], minorRadius * minorSin, ringRadius * majorSin[j]};
+            normals[row + j]  = {minorCos * majorCos[j], minorSin, minorCos * majorSin[j]};
+            uv[row + j]       = {(float) j / majorSegments, v};
         }
     }
-    mesh.vertices[index++] = {0, -1, 0};
 
-    index = 0;
-    for(int i = 0; i < meshSize; i++) {
-        mesh.triangles[index++] = 0;
-        mesh.triangles[index++] = ((i + 1) % meshSize) + 1;
-        mesh.triangles[index++] = i + 1;
+    PopArenaTo(arena, arenaPos);
+
+    FillGridTriangles(mesh.triangles.data, majorSegments, minorSegments, majorSegments + 1, 0);
+
+    ApplyMesh(&mesh);
+    return mesh;
+}
+
+// @NOTE: face normals are computed 4 triangles at a time with SSE2. Both serial and parallel
+// versions go through the same code and sum contributions in the same order, so the results
+// are bitwise identical.
+#define NORMALS_BATCH 4
+
+static __m128 SafeLength(__m128 x, __m128 y, __m128 z) {
+    __m128 length = _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(x, x), _mm_mul_ps(y, y)), _mm_mul_ps(z, z)));
+    __m128 isZero = _mm_cmpeq_ps(length, _mm_setzero_ps());
+
+    return _mm_or_ps(_mm_andnot_ps(isZero, length), _mm_and_ps(isZero, _mm_set1_ps(1.0f)));
+}
+
+static __m128 CornerCosine(__m128 ux, __m128 uy, __m128 uz, __m128 vx, __m128 vy, __m128 vz) {
+    __m128 dot = _mm_add_ps(_mm_add_ps(_mm_mul_ps(ux, vx), _mm_mul_ps(uy, vy)), _mm_mul_ps(uz, vz));
+    __m128 lengths = _mm_mul_ps(SafeLength(ux, uy, uz), SafeLength(vx, vy, vz));
+    __m128 cosine = _mm_div_ps(dot, lengths);
+
+    return _mm_max_ps(_mm_min_ps(cosine, _mm_set1_ps(1.0f)), _mm_set1_ps(-1.0f));
+}
+
+// Writes weighted normal of every triangle corner in [firstTriangle, lastTriangle) to corners
+static void CalculateCornerNormals(Vector3* verts, int32_t* tris, int firstTriangle, int lastTriangle,
+                                   NormalWeighting weighting, Vector3* corners)
+{
+    for(int t = firstTriangle; t < lastTriangle; t += NORMALS_BATCH) {
+        int count = lastTriangle - t < NORMALS_BATCH ? lastTriangle - t : NORMALS_BATCH;
+
+        // Tail lanes repeat the last triangle and are not written back
+        Vector3 a[NORMALS_BATCH], b[NORMALS_BATCH], c[NORMALS_BATCH];
+        for(int lane = 0; lane < NORMALS_BATCH; lane++) {
+            int32_t* tri = tris + (t + (lane < count ? lane : count - 1)) * 3;
+            a[lane] = verts[tri[0]];
+            b[lane] = verts[tri[1]];
+            c[lane] = verts[tri[2]];
+        }
+
+        __m128 ax = _mm_setr_ps(a[0].x, a[1].x, a[2].x, a[3].x);
+        __m128 ay = _mm_setr_ps(a[0].y, a[1].y, a[2].y, a[3].y);
+        __m128 az = _mm_setr_ps(a[0].z, a[1].z, a[2].z, a[3].z);
+        __m128 bx = _mm_setr_ps(b[0].x, b[1].x, b[2].x, b[3].x);
+        __m128 by = _mm_setr_ps(b[0].y, b[1].y, b[2].y, b[3].y);
+        __m128 bz = _mm_setr_ps(b[0].z, b[1].z, b[2].z, b[3].z);
+        __m128 cx = _mm_setr_ps(c[0].x, c[1].x, c[2].x, c[3].x);
+        __m128 cy = _mm_setr_ps(c[0].y, c[1].y, c[2].y, c[3].y);
+        __m128 cz = _mm_setr_ps(c[0].z, c[1].z, c[2].z, c[3].z);
+
+        __m128 abx = _mm_sub_ps(ax, bx), aby = _mm_sub_ps(ay, by), abz = _mm_sub_ps(az, bz);
+        __m128 acx = _mm_sub_ps(ax, cx), acy = _mm_sub_ps(ay, cy), acz = _mm_sub_ps(az, cz);
+
+        // cross(a - b, a - c), length is twice the triangle area
+        __m128 nx = _mm_sub_ps(_mm_mul_ps(aby, acz), _mm_mul_ps(abz, acy));
+        __m128 ny = _mm_sub_ps(_mm_mul_ps(abz, acx), _mm_mul_ps(abx, acz));
+        __m128 nz = _mm_sub_ps(_mm_mul_ps(abx, acy), _mm_mul_ps(aby, acx));
+
+        __m128 weights[3] = {_mm_set1_ps(1.0f), _mm_set1_ps(1.0f), _mm_set1_ps(1.0f)};
+        if(weighting != NormalWeighting::Area) {
+            __m128 invLength = _mm_div_ps(_mm_set1_ps(1.0f), SafeLength(nx, ny, nz));
+            nx = _mm_mul_ps(nx, invLength);
+            ny = _mm_mul_ps(ny, invLength);
+            nz = _mm_mul_ps(nz, invLength);
+        }
+
+        if(weighting == NormalWeighting::Angle) {
+            __m128 bcx = _mm_sub_ps(bx, cx), bcy = _mm_sub_ps(by, cy), bcz = _mm_sub_ps(bz, cz);
+            __m128 zero = _mm_setzero_ps();
+
+            __m128 cosines[3];
+            // A: (b - a, c - a), B: (a - b, c - b), C: (a - c, b - c)
+            cosines[0] = CornerCosine(abx, aby, abz, acx, acy, acz);
+            cosines[1] = CornerCosine(abx, aby, abz, _mm_sub_ps(zero, bcx), _mm_sub_ps(zero, bcy), _mm_sub_ps(zero, bcz));
+            cosines[2] = CornerCosine(acx, acy, acz, bcx, bcy, bcz);
+
+            // @NOTE: there is no SSE acos, so it's done per lane
+            for(int corner = 0; corner < 3; corner++) {
+                float values[NORMALS_BATCH];
+                _mm_storeu_ps(values, cosines[corner]);
+                for(int lane = 0; lane < NORMALS_BATCH; lane++) {
+                    values[lane] = acosf(values[lane]);
+                }
+
+                weights[corner] = _mm_loadu_ps(values);
+            }
+        }
+
+        for(int corner = 0; corner < 3; corner++) {
+            float x[NORMALS_BATCH], y[NORMALS_BATCH], z[NORMALS_BATCH];
+            _mm_storeu_ps(x, _mm_mul_ps(nx, weights[corner]));
+            _mm_storeu_ps(y, _mm_mul_ps(ny, weights[corner]));
+            _mm_storeu_ps(z, _mm_mul_ps(nz, weights[corner]));
+
+            for(int lane = 0; lane < count; lane++) {
+                corners[(t - firstTriangle + lane) * 3 + corner] = {x[lane], y[lane], z[lane]};
+            }
+        }
     }
+}
 
-    for (int y = 0; y < meshSize - 2; y++) {
-        for (int x = 0; x < meshSize; x++) {
-            int idx = x + y * meshSize + 1;
+static void NormalizeNormals(Vector3* normals, int start, int end) {
+    for(int i = start; i < end; i += NORMALS_BATCH) {
+        int count = end - i < NORMALS_BATCH ? end - i : NORMALS_BATCH;
 
-            int t1 = idx;
-            int t2 = (x == meshSize - 1) ? idx - meshSize + 1 : idx + 1;
-            int t3 = idx + meshSize;
-            int t4 = (x == meshSize - 1) ? idx + 1 : idx + meshSize + 1;
+        float x[NORMALS_BATCH] = {}, y[NORMALS_BATCH] = {}, z[NORMALS_BATCH] = {};
+        for(int lane = 0; lane < count; lane++) {
+            x[lane] = normals[i + lane].x;
+            y[lane] = normals[i + lane].y;
+            z[lane] = normals[i + lane].z;
+        }
 
-            mesh.triangles[index++] = t1;
-            mesh.triangles[index++] = t2;
-            mesh.triangles[index++] = t4;
+        __m128 nx = _mm_loadu_ps(x);
+        __m128 ny = _mm_loadu_ps(y);
+        __m128 nz = _mm_loadu_ps(z);
 
-            mesh.triangles[index++] = t1;
-            mesh.triangles[index++] = t4;
-            mesh.triangles[index++] = t3;
+        __m128 invLength = _mm_div_ps(_mm_set1_ps(1.0f), SafeLength(nx, ny, nz));
+        _mm_storeu_ps(x, _mm_mul_ps(nx, invLength));
+        _mm_storeu_ps(y, _mm_mul_ps(ny, invLength));
+        _mm_storeu_ps(z, _mm_mul_ps(nz, invLength));
+
+        for(int lane = 0; lane < count; lane++) {
+            normals[i + lane] = {x[lane], y[lane], z[lane]};
         }
     }
+}
+
+void CalculateNormals(Mesh *mesh, NormalWeighting weighting) {
+    assert(mesh && mesh->vertices.data && mesh->triangles.data && mesh->normals.data);
+
+    Vector3* verts = mesh->vertices.data;
+    Vector3* normals = mesh->normals.data;
+    int32_t* tris = mesh->triangles.data;
+    int trianglesCount = mesh->triangles.length / 3;
+
+    memset(normals, 0, mesh->normals.length * sizeof(Vector3));
 
-    for(int i = 0; i < meshSize; i++) {
-        mesh.triangles[index++] = vertsCount - 1;
-        mesh.triangles[index++] = (i == meshSize - 1) ? vertsCount - 2 : vertsCount - 3 - i;
-        mesh.triangles[index++] = vertsCount - 2 - i;
+    Vector3 corners[NORMALS_BATCH * 3];
+    for(int t = 0; t < trianglesCount; t += NORMALS_BATCH) {
+        int end = t + NORMALS_BATCH < trianglesCount ? t + NORMALS_BATCH : trianglesCount;
+        CalculateCornerNormals(verts, tris, t, end, weighting, corners);
+
+        for(int i = 0; i < (end - t) * 3; i++) {
+            normals[tris[t * 3 + i]] = normals[tris[t * 3 + i]] + corners[i];
+        }
     }
 
-    CalculateNormals(&mesh);
-    ApplyMesh(&mesh);
+    NormalizeNormals(normals, 0, mesh->vertices.length);
+}
 
-    return mesh;
+struct NormalsJob {
+    Mesh* mesh;
+    NormalWeighting weighting;
+
+    // Weighted normals of every triangle corner
+    Vector3* corners;
+
+    // For every vertex, list of corners using it (in ascending order)
+    int32_t* vertexCornersOffsets;
+    int32_t* vertexCorners;
+};
+
+static void CornerNormalsJob(void* data, int start, int end) {
+    NormalsJob* job = (NormalsJob*) data;
+    CalculateCornerNormals(job->mesh->vertices.data, job->mesh->triangles.data, start, end,
+                           job->weighting, job->corners + start * 3);
 }
 
+static void GatherNormalsJob(void* data, int start, int end) {
+    NormalsJob* job = (NormalsJob*) data;
+    Vector3* normals = job->mesh->normals.data;
 
-void CalculateNormals(Mesh *mesh) {
-    assert(mesh && mesh->vertices.data && mesh->triangles.data && mesh->normals.data);
+    // Summing in the ascending corner order gives the same result as the serial scatter
+    for(int v = start; v < end; v++) {
+        Vector3 normal = {};
+        for(int i = job->vertexCornersOffsets[v]; i < job->vertexCornersOffsets[v + 1]; i++) {
+            normal = normal + job->corners[job->vertexCorners[i]];
+        }
+
+        normals[v] = normal;
+    }
 
-    Slice<Vector3> verts = mesh->vertices;
-    Slice<int32_t> tris = mesh->triangles;
+    NormalizeNormals(normals, start, end);
+}
 
-    memset(mesh->normals.data, 0, mesh->normals.length * sizeof(Vector3));
+void CalculateNormalsParallel(Mesh* mesh, MemoryArena* arena, NormalWeighting weighting) {
+    assert(mesh && mesh->vertices.data && mesh->triangles.data && mesh->normals.data);
+    assert(arena);
 
-    for (int i = 0; i < mesh->triangles.length; i += 3)
-    {
-        int indexA = tris[i];
-        int indexB = tris[i + 1];
-        int indexC = tris[i + 2];
+    int vertexCount = mesh->vertices.length;
+    int indexCount = mesh->triangles.length;
+    int32_t* tris = mesh->triangles.data;
 
-        Vector3 a = verts[indexA];
-        Vector3 b = verts[indexB];
-        Vector3 c = verts[indexC];
+    uint64_t arenaPos = GetArenaPos(arena);
 
-        Vector3 ab = a - b;
-        Vector3 ac = a - c;
+    NormalsJob job = {};
+    job.mesh = mesh;
+    job.weighting = weighting;
+    job.corners = (Vector3*) PushArena(arena, indexCount * sizeof(Vector3));
+    job.vertexCornersOffsets = (int32_t*) PushArena(arena, (vertexCount + 1) * sizeof(int32_t));
+    job.vertexCorners = (int32_t*) PushArena(arena, indexCount * sizeof(int32_t));
 
-        Vector3 normal = Vector3CrossProduct(ab, ac);
+    ParallelFor(indexCount / 3, 4096, CornerNormalsJob, &job);
 
-        mesh->normals[indexA] = mesh->normals[indexA] + normal;
-        mesh->normals[indexB] = mesh->normals[indexB] + normal;
-        mesh->normals[indexC] = mesh->normals[indexC] + normal;
+    // Vertex -> corners adjacency
+    for(int i = 0; i < indexCount; i++) {
+        job.vertexCornersOffsets[tris[i] + 1]++;
     }
 
-    for (int i = 0; i < mesh->vertices.length; i++) {
-        mesh->normals[i] = Vector3Normalize(mesh->normals[i]);
+    for(int v = 0; v < vertexCount; v++) {
+        job.vertexCornersOffsets[v + 1] += job.vertexCornersOffsets[v];
     }
+
+    int32_t* fill = (int32_t*) PushArena(arena, vertexCount * sizeof(int32_t));
+    memcpy(fill, job.vertexCornersOffsets, vertexCount * sizeof(int32_t));
+    for(int i = 0; i < indexCount; i++) {
+        job.vertexCorners[fill[tris[i]]++] = i;
+    }
+
+    ParallelFor(vertexCount, 4096, GatherNormalsJob, &job);
+
+    PopArenaTo(arena, arenaPos);
 }
 
 //========================================
@@ -912,25 +2244,49 @@ Texture LoadTextureFromMemory(Slice<char> memory) {
     stbi_image_free(texData);
 
     glBindTexture(GL_TEXTURE_2D, 0);
+    ResetTextureBindings();
+
     ret.isValid = true;
 
     return ret;
 }
 
+#define TRACKED_TEXTURE_UNITS 16
+
+// Texture bound to each unit, see ResetTextureBindings
+static GLuint BoundTextures[TRACKED_TEXTURE_UNITS];
+
 void BindTexture(SRWindow* window, Texture texture, uint32_t unit) {
-    // @TODO: add texture units
     // @TODO: add error texture
-    window->currentTextureId = texture.id;
-    glActiveTexture(GL_TEXTURE0 + unit);
-    glBindTexture(GL_TEXTURE_2D, texture.id);
+    BindTexture(window, texture.id, unit);
 }
 
 
 void BindTexture(SRWindow* window, GLuint textureId, uint32_t unit) {
-    // @TODO: add texture units
     window->currentTextureId = textureId;
     glActiveTexture(GL_TEXTURE0 + unit);
     glBindTexture(GL_TEXTURE_2D, textureId);
+
+    if(unit < TRACKED_TEXTURE_UNITS) {
+        BoundTextures[unit] = textureId;
+    }
+}
+
+void ResetTextureBindings() {
+    // Never a valid texture name, so the next bind of every unit goes to the driver
+    memset(BoundTextures, 0xFF, sizeof(BoundTextures));
+}
+
+static void BindTextureUnit(uint32_t unit, GLuint textureId) {
+    if(unit < TRACKED_TEXTURE_UNITS && BoundTextures[unit] == textureId) {
+        return;
+    }
+
+    glBindTextureUnit(unit, textureId);
+
+    if(unit < TRACKED_TEXTURE_UNITS) {
+        BoundTextures[unit] = textureId;
+    }
 }
 
 //========================================
@@ -944,28 +2300,173 @@ void BindTexture(SRWindow* window, GLuint textureId, uint32_t unit) {
 //     printf("\n");
 // }
 
+//========================================
+// Frame uniforms
+//========================================
+
+static void UploadFrameCamera(SRWindow* window, Matrix view, Matrix projection, Vector3 position) {
+    FrameUniforms* uniforms = &window->frameUniforms;
+
+    uniforms->view = view;
+    uniforms->projection = projection;
+    uniforms->viewProjection = projection * view;
+    uniforms->cameraPosition = {position.x, position.y, position.z, 1};
+
+    glNamedBufferSubData(window->frameUniformBuffer, 0, offsetof(FrameUniforms, time), uniforms);
+}
+
+void InitFrameUniforms(SRWindow* window) {
+    glCreateBuffers(1, &window->frameUniformBuffer);
+    glNamedBufferStorage(window->frameUniformBuffer, sizeof(FrameUniforms), NULL, GL_DYNAMIC_STORAGE_BIT);
+
+    // Nothing else uses this binding, so the buffer stays bound for the whole run
+    glBindBufferBase(GL_UNIFORM_BUFFER, FRAME_DATA_BINDING, window->frameUniformBuffer);
+
+    // Identity camera until SetFrameCamera is called
+    UploadFrameCamera(window, MatrixIdentity(), MatrixIdentity(), {});
+    window->frameCameraValid = false;
+}
+
+void UpdateFrameUniforms(SRWindow* window) {
+    FrameUniforms* uniforms = &window->frameUniforms;
+
+    float width  = (float) window->width;
+    float height = (float) window->height;
+
+    uniforms->time = {(float) window->timeSinceStart, window->timeDelta, 0, 0};
+    uniforms->resolution = {width, height, width > 0 ? 1 / width : 0, height > 0 ? 1 / height : 0};
+
+    size_t offset = offsetof(FrameUniforms, time);
+    glNamedBufferSubData(window->frameUniformBuffer, offset, sizeof(FrameUniforms) - offset, &uniforms->time);
+}
+
+void SetFrameCamera(SRWindow* window, Camera* camera) {
+    // @NOTE: Camera has only 4 byte fields, so there is no padding to compare
+    if(window->frameCameraValid && memcmp(&window->frameCamera, camera, sizeof(Camera)) == 0) {
+        return;
+    }
+
+    UploadFrameCamera(window, GetView(camera), GetProjection(camera), camera->position);
+
+    window->frameCamera = *camera;
+    window->frameCameraValid = true;
+}
+
+// @NOTE: Sets uniforms needed to decode Quantized meshes. Built-in shaders are switched to
+// the variant matching the mesh layout, so uniforms set on the other variant (like tint) have
+// to be set again. Custom shaders have to implement decoding themselves.
+void SetMeshUniforms(SRWindow* window, Mesh* mesh) {
+    Shader* shader = &window->currentShader;
+    bool quantized = mesh->layout == VertexLayout::Quantized;
+
+    // Multi draw variants read quantization data from the draw data
+    uint32_t drawKeywords = BUILT_IN_SHADER_MULTI_DRAW | BUILT_IN_SHADER_SKINNED;
+    if(shader->permutations && shader->permutations->builtIn && (shader->keywords & drawKeywords) == 0) {
+        uint32_t keywords = quantized ? BUILT_IN_SHADER_QUANTIZED : 0;
+
+        if(shader->keywords != keywords) {
+            UseShader(window, *GetShaderVariant(shader->permutations, keywords, &window->tempArena));
+        }
+    }
+
+    if(quantized == false) {
+        return;
+    }
+
+    int boundsMinLoc = GetShaderUniformLocation(shader, "boundsMin");
+    if(boundsMinLoc == -1) {
+        return;
+    }
+
+    Vector3 boundsSize = mesh->bounds.max - mesh->bounds.min;
+
+    glUniform3fv(boundsMinLoc, 1, (const float*) &mesh->bounds.min);
+    glUniform3fv(GetShaderUniformLocation(shader, "boundsSize"), 1, (const float*) &boundsSize);
+
+    Vector4 uvBounds = {mesh->uvMin.x, mesh->uvMin.y, mesh->uvSize.x, mesh->uvSize.y};
+    glUniform4fv(GetShaderUniformLocation(shader, "uvBounds"), 1, (const float*) &uvBounds);
+}
+
+// @NOTE: all VAO binds go through BindVertexArray, ImGui restores the binding after rendering
+static GLuint CurrentVertexArray;
+
+void BindVertexArray(GLuint vao) {
+    if(CurrentVertexArray != vao) {
+        glBindVertexArray(vao);
+        CurrentVertexArray = vao;
+    }
+}
+
+void DeleteVertexArray(GLuint* vao) {
+    // Deleted VAO is unbound by GL, and its name can be reused
+    if(CurrentVertexArray == *vao) {
+        CurrentVertexArray = 0;
+    }
+
+    glDeleteVertexArrays(1, vao);
+    *vao = 0;
+}
+
+void DrawMeshLod(SRWindow* window, Mesh* mesh, int lod) {
+    assert(lod >= 0 && lod < mesh->lodCount);
+
+    MeshLod range = mesh->lods[lod];
+
+    if(mesh->heap) {
+        size_t offset = (size_t) (mesh->firstIndex + range.firstIndex) * GetGLTypeSize(mesh->indexType);
+
+        BindVertexArray(mesh->heap->VAO);
+        glDrawElementsBaseVertex(GL_TRIANGLES, (GLsizei) range.indexCount, mesh->indexType, (void*) offset, mesh->baseVertex);
+        return;
+    }
+
+    size_t offset = (size_t) range.firstIndex * GetGLTypeSize(mesh->indexType);
+
+    BindVertexArray(mesh->VAO);
+    glDrawElements(GL_TRIANGLES, (GLsizei) range.indexCount, mesh->indexType, (void*) offset);
+}
+
+void SetModelMatrix(SRWindow* window, Matrix model) {
+    Shader* shader = &window->currentShader;
+
+    int modelLoc = GetShaderUniformLocation(shader, "model");
+    if(modelLoc != -1)
+        glUniformMatrix4fv(modelLoc, 1, false, (const float *)(&model));
+
+    // @NOTE: built-in shaders use the frame data, custom ones can still have their own MVP
+    int mvpLoc = GetShaderUniformLocation(shader, "MVP");
+    if(mvpLoc != -1) {
+        Matrix mvp = window->frameUniforms.viewProjection * model;
+        glUniformMatrix4fv(mvpLoc, 1, false, (const float *)(&mvp));
+    }
+}
+
 void DrawMesh(SRWindow* window, Mesh mesh, Matrix transform) {
-    uint32_t shaderId = window->currentShader.id;
-    uint32_t mvpLoc = glGetUniformLocation(shaderId, "MVP");
-    if(mvpLoc != -1)
-        glUniformMatrix4fv(mvpLoc, 1, false, (const float *)(&transform));
+    // Frame camera is identity whenever it's not valid
+    if(window->frameCameraValid) {
+        UploadFrameCamera(window, MatrixIdentity(), MatrixIdentity(), {});
+        window->frameCameraValid = false;
+    }
 
-    glBindVertexArray(mesh.VAO);
-    glDrawElements(GL_TRIANGLES, (GLsizei) mesh.triangles.length, GL_UNSIGNED_INT, 0);
+    SetMeshUniforms(window, &mesh);
+    SetModelMatrix(window, transform);
+
+    DrawMeshLod(window, &mesh, 0);
 }
 
 void DrawMesh(SRWindow* window, Mesh mesh, Camera camera, Matrix transform) {
-    Matrix projection = GetProjection(&camera);
-    Matrix view = GetView(&camera);
-    Matrix mvp = projection * view * transform;
+    SetFrameCamera(window, &camera);
 
-    uint32_t shaderId = window->currentShader.id;
-    uint32_t mvpLoc = glGetUniformLocation(shaderId, "MVP");
-    if(mvpLoc != -1)
-        glUniformMatrix4fv(mvpLoc, 1, false, (const float *)(&mvp));
+    Frustum frustum = ExtractFrustum(window->frameUniforms.viewProjection);
+    BoundingSphere sphere = TransformBoundingSphere(mesh.boundingSphere, transform);
+    if(IsSphereInFrustum(&frustum, sphere.center, sphere.radius) == false) {
+        return;
+    }
 
-    glBindVertexArray(mesh.VAO);
-    glDrawElements(GL_TRIANGLES, (GLsizei) mesh.triangles.length, GL_UNSIGNED_INT, 0);
+    SetMeshUniforms(window, &mesh);
+    SetModelMatrix(window, transform);
+
+    DrawMeshLod(window, &mesh, SelectMeshLod(window, &mesh, &camera, transform));
 }
 
 //========================================
@@ -976,7 +2477,7 @@ void RenderBatch(SRWindow* window, BatchBuffer* batch) {
         return;
     }
 
-    glBindVertexArray(batch->VAO);
+    BindVertexArray(batch->VAO);
     glBindBuffer(GL_ARRAY_BUFFER, batch->VBO);
     glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(BatchVertex) * batch->currentSize, batch->vertices);
 
@@ -1007,9 +2508,6 @@ ScreenSpaceContext BeginScreenSpace(SRWindow* window) {
 
     SetBlendingAlphaBlend(window);
 
-    glUniform1i(glGetUniformLocation(ScreenSpaceShader.id, "framebufferWidth"), window->width);
-    glUniform1i(glGetUniformLocation(ScreenSpaceShader.id, "framebufferHeight"), window->height);
-
     return ret;
 }
 
@@ -1105,36 +2603,180 @@ void DrawTextureFragment(SRWindow* window, Texture texture, Rect source, Rect de
 // Material
 //========================================
 
+// Material buffer bound to MATERIAL_DATA_BINDING
+static GLuint BoundMaterialBuffer;
+
+static GLuint GetMaterialBlockIndex(Shader* shader) {
+    if(shader->isValid == false) {
+        return GL_INVALID_INDEX;
+    }
+
+    return glGetProgramResourceIndex(shader->id, GL_UNIFORM_BLOCK, "MaterialData");
+}
+
+// Offset of the uniform in the MaterialData block, -1 if it's not a member of the block
+static int32_t GetMaterialUniformOffset(Shader* shader, const char* name) {
+    GLuint blockIndex = GetMaterialBlockIndex(shader);
+    if(blockIndex == GL_INVALID_INDEX) {
+        return -1;
+    }
+
+    GLuint index = glGetProgramResourceIndex(shader->id, GL_UNIFORM, name);
+    if(index == GL_INVALID_INDEX) {
+        return -1;
+    }
+
+    GLenum properties[] = {GL_BLOCK_INDEX, GL_OFFSET};
+    GLint values[2] = {-1, -1};
+    glGetProgramResourceiv(shader->id, GL_UNIFORM, index, 2, properties, 2, NULL, values);
+
+    return values[0] == (GLint) blockIndex ? values[1] : -1;
+}
+
+// Bytes written at the reflected offset, std140 alignment is already in the offsets
+static uint32_t GetUniformDataSize(UniformType type) {
+    switch(type) {
+        case UniformType::Float:
+        case UniformType::Int:
+        case UniformType::UInt:
+        case UniformType::Bool:  return 4;
+
+        case UniformType::Vec2:
+        case UniformType::IVec2:
+        case UniformType::UVec2:
+        case UniformType::BVec2: return 8;
+
+        case UniformType::Vec3:
+        case UniformType::IVec3:
+        case UniformType::UVec3:
+        case UniformType::BVec3: return 12;
+
+        case UniformType::Vec4:
+        case UniformType::IVec4:
+        case UniformType::UVec4:
+        case UniformType::BVec4: return 16;
+
+        case UniformType::Mat4:  return sizeof(Matrix);
+
+        case UniformType::Texture2D: return 0;
+    }
+
+    return 0;
+}
+
+static void WriteMaterialData(Material* material, Uniform* uniform) {
+    if(uniform->offset == -1) {
+        return;
+    }
+
+    uint32_t size = GetUniformDataSize(uniform->type);
+    assert(uniform->offset + size <= material->dataSize);
+
+    memcpy(material->data + uniform->offset, &uniform->value, size);
+    material->dirty = true;
+}
+
 Material CreateMaterial(Shader shader) {
     Material result = {};
     result.shader = shader;
 
+    GLuint blockIndex = GetMaterialBlockIndex(&shader);
+    if(blockIndex != GL_INVALID_INDEX) {
+        GLenum properties[] = {GL_BUFFER_DATA_SIZE};
+        GLint size = 0;
+        glGetProgramResourceiv(shader.id, GL_UNIFORM_BLOCK, blockIndex, 1, properties, 1, NULL, &size);
+
+        assert(size <= MATERIAL_MAX_DATA_SIZE);
+        result.dataSize = (uint32_t) size;
+        result.dirty = true;
+
+        glCreateBuffers(1, &result.buffer);
+        glNamedBufferStorage(result.buffer, result.dataSize, NULL, GL_DYNAMIC_STORAGE_BIT);
+
+        // Block binding is program state, so shaders don't have to declare it
+        glUniformBlockBinding(shader.id, blockIndex, MATERIAL_DATA_BINDING);
+    }
+
+    return result;
+}
+
+Material CopyMaterial(Material* material) {
+    Material result = *material;
+
+    if(result.dataSize > 0) {
+        glCreateBuffers(1, &result.buffer);
+        glNamedBufferStorage(result.buffer, result.dataSize, NULL, GL_DYNAMIC_STORAGE_BIT);
+        result.dirty = true;
+    }
+
     return result;
 }
 
+void DestroyMaterial(Material* material) {
+    if(material->buffer != 0) {
+        if(BoundMaterialBuffer == material->buffer) {
+            BoundMaterialBuffer = 0;
+        }
+
+        glDeleteBuffers(1, &material->buffer);
+    }
+
+    material->buffer = 0;
+}
+
 void AddUniform(Material* material, Str8 name, UniformType type, UniformValue value) {
+    assert(material->uniformsCount < (int) (sizeof(material->uniforms) / sizeof(material->uniforms[0])));
+
     // @TODO: shader validation
     Uniform uniform = {};
     uniform.name    = name;
     uniform.type    = type;
     uniform.value   = value;
 
-    uniform.location = glGetUniformLocation(material->shader.id, name.str);
+    uniform.offset   = GetMaterialUniformOffset(&material->shader, name.str);
+    uniform.location = uniform.offset == -1 ? GetShaderUniformLocation(&material->shader, name.str) : -1;
 
-    if(uniform.location == -1) {
+    if(uniform.offset == -1 && uniform.location == -1) {
         fprintf(stderr, "[Error:Materials] Couldn't find uniform location with name %s\n", name.str);
     }
 
+    // Units are assigned to the samplers by ReflectShaderUniforms
+    if(type == UniformType::Texture2D && uniform.location != -1) {
+        glGetUniformiv(material->shader.id, uniform.location, &uniform.textureUnit);
+    }
+
     material->uniforms[material->uniformsCount] = uniform;
     material->uniformsCount += 1;
+
+    WriteMaterialData(material, material->uniforms + material->uniformsCount - 1);
 }
 
 void UseMaterial(SRWindow* window, Material* material) {
-    UseShader(window, material->shader);
+    // Materials of the same shader only switch their buffers and textures
+    if(window->currentShader.id != material->shader.id) {
+        UseShader(window, material->shader);
+    }
+
+    if(material->dataSize > 0) {
+        if(material->dirty) {
+            glNamedBufferSubData(material->buffer, 0, material->dataSize, material->data);
+            material->dirty = false;
+        }
+
+        if(BoundMaterialBuffer != material->buffer) {
+            glBindBufferRange(GL_UNIFORM_BUFFER, MATERIAL_DATA_BINDING, material->buffer, 0, material->dataSize);
+            BoundMaterialBuffer = material->buffer;
+        }
+    }
 
-    int currentTextureUnit = 0;
     for(int i = 0; i < material->uniformsCount; i++) {
         Uniform* uniform = material->uniforms + i;
+
+        // Already in the material buffer
+        if(uniform->offset != -1) {
+            continue;
+        }
+
         switch(uniform->type) {
             case UniformType::Float: glUniform1fv(uniform->location, 1, (const GLfloat*) &uniform->value);  break;
             case UniformType::Vec2:  glUniform2fv(uniform->location, 1, (const GLfloat*) &uniform->value);  break;
@@ -1159,11 +2801,7 @@ void UseMaterial(SRWindow* window, Material* material) {
             case UniformType::Mat4:  glUniformMatrix4fv(uniform->location, 1, false, (const GLfloat*) &uniform->value);  break;
 
             case UniformType::Texture2D: {
-                glUniform1i(uniform->location, currentTextureUnit);
-                glActiveTexture(GL_TEXTURE0 + currentTextureUnit);
-                glBindTexture(GL_TEXTURE_2D, uniform->value.texture);
-
-                currentTextureUnit += 1;
+                BindTextureUnit(uniform->textureUnit, uniform->value.texture);
             }
             break;
         }
@@ -1203,6 +2841,7 @@ void SetUniformValue(Material* material, Str8 name, UniformValue value) {
     for(int i = 0; i < material->uniformsCount; i++) {
         if(StringEqual(name, material->uniforms[i].name)) {
             material->uniforms[i].value = value;
+            WriteMaterialData(material, material->uniforms + i);
             return;
         }
     }
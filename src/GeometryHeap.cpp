@@ -0,0 +1,201 @@
+#include "SimpleRenderer.h"
+
+#include <string.h>
+
+//========================================
+// Geometry heap
+//========================================
+
+// @NOTE: ranges are allocated first fit from the sorted free list and merged with
+// neighbours when freed. Static meshes are rarely removed, so fragmentation is low
+// and the list stays short.
+
+static void InitGeometryAllocator(GeometryAllocator* allocator, uint32_t capacity, MemoryArena* arena) {
+    allocator->capacity        = capacity;
+    allocator->maxFreeRanges   = GEOMETRY_HEAP_MAX_FREE_RANGES;
+    allocator->freeRanges      = (GeometryRange*) PushArena(arena, GEOMETRY_HEAP_MAX_FREE_RANGES * sizeof(GeometryRange));
+    allocator->freeRanges[0]   = {0, capacity};
+    allocator->freeRangesCount = 1;
+    allocator->arena           = arena;
+}
+
+static bool AllocateGeometryRange(GeometryAllocator* allocator, uint32_t size, uint32_t* offset) {
+    for(int i = 0; i < allocator->freeRangesCount; i++) {
+        GeometryRange* range = allocator->freeRanges + i;
+        if(range->size < size) {
+            continue;
+        }
+
+        *offset = range->offset;
+        range->offset += size;
+        range->size   -= size;
+
+        if(range->size == 0) {
+            memmove(range, range + 1, (allocator->freeRangesCount - i - 1) * sizeof(GeometryRange));
+            allocator->freeRangesCount--;
+        }
+
+        return true;
+    }
+
+    return false;
+}
+
+static void FreeGeometryRange(GeometryAllocator* allocator, uint32_t offset, uint32_t size) {
+    if(size == 0) {
+        return;
+    }
+
+    // First free range after the freed one
+    int next = 0;
+    while(next < allocator->freeRangesCount && allocator->freeRanges[next].offset < offset) {
+        next++;
+    }
+
+    GeometryRange* ranges = allocator->freeRanges;
+
+    bool mergePrevious = next > 0 && ranges[next - 1].offset + ranges[next - 1].size == offset;
+    bool mergeNext     = next < allocator->freeRangesCount && offset + size == ranges[next].offset;
+
+    if(mergePrevious && mergeNext) {
+        ranges[next - 1].size += size + ranges[next].size;
+
+        memmove(ranges + next, ranges + next + 1, (allocator->freeRangesCount - next - 1) * sizeof(GeometryRange));
+        allocator->freeRangesCount--;
+    }
+    else if(mergePrevious) {
+        ranges[next - 1].size += size;
+    }
+    else if(mergeNext) {
+        ranges[next].offset = offset;
+        ranges[next].size  += size;
+    }
+    else {
+        if(allocator->freeRangesCount == allocator->maxFreeRanges) {
+            // @NOTE: the old list stays in the arena, growing is rare enough to not matter
+            int newMax = allocator->maxFreeRanges * 2;
+            GeometryRange* newRanges = (GeometryRange*) PushArena(allocator->arena, newMax * sizeof(GeometryRange));
+            memcpy(newRanges, ranges, allocator->freeRangesCount * sizeof(GeometryRange));
+
+            allocator->freeRanges    = newRanges;
+            allocator->maxFreeRanges = newMax;
+            ranges = newRanges;
+        }
+
+        memmove(ranges + next + 1, ranges + next, (allocator->freeRangesCount - next) * sizeof(GeometryRange));
+        ranges[next] = {offset, size};
+        allocator->freeRangesCount++;
+    }
+}
+
+GeometryHeap CreateGeometryHeap(VertexLayout layout, uint32_t vertexCapacity, uint32_t indexBufferSize, MemoryArena* arena) {
+    assert(layout != VertexLayout::Split);
+    assert(arena);
+
+    GeometryHeap heap = {};
+
+    // @NOTE: skinning attributes aren't stored, they would make every vertex bigger
+    uint32_t staticAttributes = (1 << VertexJointsIndex) - 1;
+    heap.format = GetVertexFormat(staticAttributes, layout);
+
+    // Index ranges are kept 4 bytes aligned, so both index types can share the buffer
+    indexBufferSize &= ~3u;
+
+    InitGeometryAllocator(&heap.vertices, vertexCapacity, arena);
+    InitGeometryAllocator(&heap.indices, indexBufferSize, arena);
+
+    glCreateBuffers(1, &heap.VBO);
+    glNamedBufferStorage(heap.VBO, (uint64_t) vertexCapacity * heap.format.stride, NULL, GL_DYNAMIC_STORAGE_BIT);
+
+    glCreateBuffers(1, &heap.EBO);
+    glNamedBufferStorage(heap.EBO, indexBufferSize, NULL, GL_DYNAMIC_STORAGE_BIT);
+
+    glCreateVertexArrays(1, &heap.VAO);
+    glVertexArrayVertexBuffer(heap.VAO, 0, heap.VBO, 0, heap.format.stride);
+    glVertexArrayElementBuffer(heap.VAO, heap.EBO);
+
+    SetVertexArrayFormat(heap.VAO, heap.format);
+
+    return heap;
+}
+
+// @NOTE: meshes using the heap have to be removed before, their ranges become invalid
+void DestroyGeometryHeap(GeometryHeap* heap) {
+    DeleteVertexArray(&heap->VAO);
+    glDeleteBuffers(1, &heap->VBO);
+    glDeleteBuffers(1, &heap->EBO);
+
+    *heap = {};
+}
+
+bool AddMeshToHeap(GeometryHeap* heap, Mesh* mesh) {
+    assert(heap && mesh);
+    assert(mesh->vertices.length > 0 && mesh->triangles.length > 0);
+
+    if(mesh->VAO != 0 || mesh->heap) {
+        DeleteMesh(mesh);
+    }
+
+    SetMeshMetadata(mesh, heap->format.layout);
+
+    int indexSize = GetGLTypeSize(mesh->indexType);
+    int indexCount = (int) (mesh->triangles.length + mesh->lodTriangles.length);
+
+    uint32_t vertexCount = (uint32_t) mesh->vertices.length;
+    uint32_t indexDataSize = ((uint32_t) (indexCount * indexSize) + 3) & ~3u;
+
+    uint32_t baseVertex = 0;
+    uint32_t indexOffset = 0;
+
+    if(AllocateGeometryRange(&heap->vertices, vertexCount, &baseVertex) == false) {
+        return false;
+    }
+
+    if(AllocateGeometryRange(&heap->indices, indexDataSize, &indexOffset) == false) {
+        FreeGeometryRange(&heap->vertices, baseVertex, vertexCount);
+        return false;
+    }
+
+    // Data is packed once and copied to the heap buffers
+    uint64_t vertexDataSize = (uint64_t) vertexCount * heap->format.stride;
+    uint8_t* data = (uint8_t*) malloc(vertexDataSize + indexDataSize);
+    assert(data);
+
+    uint8_t* indexData = data + vertexDataSize;
+    PackVertices(mesh, heap->format, data);
+    PackIndices(mesh->triangles, mesh->indexType, indexData);
+    PackIndices(mesh->lodTriangles, mesh->indexType, indexData + mesh->triangles.length * indexSize);
+
+    glNamedBufferSubData(heap->VBO, (uint64_t) baseVertex * heap->format.stride, vertexDataSize, data);
+    glNamedBufferSubData(heap->EBO, indexOffset, (uint64_t) indexCount * indexSize, indexData);
+
+    free(data);
+
+    mesh->heap            = heap;
+    mesh->baseVertex      = (int32_t) baseVertex;
+    mesh->firstIndex      = (int32_t) (indexOffset / indexSize);
+    mesh->heapVertexCount = vertexCount;
+    mesh->heapIndexSize   = indexDataSize;
+
+    return true;
+}
+
+void RemoveMeshFromHeap(Mesh* mesh) {
+    assert(mesh);
+
+    GeometryHeap* heap = mesh->heap;
+    if(heap == NULL) {
+        return;
+    }
+
+    int indexSize = GetGLTypeSize(mesh->indexType);
+
+    FreeGeometryRange(&heap->vertices, (uint32_t) mesh->baseVertex, mesh->heapVertexCount);
+    FreeGeometryRange(&heap->indices, (uint32_t) mesh->firstIndex * indexSize, mesh->heapIndexSize);
+
+    mesh->heap            = NULL;
+    mesh->baseVertex      = 0;
+    mesh->firstIndex      = 0;
+    mesh->heapVertexCount = 0;
+    mesh->heapIndexSize   = 0;
+}
@@ -43,6 +43,19 @@ void ClearArena(MemoryArena* arena) {
     arena->allocatedOffset = 0;
 }
 
+uint64_t GetArenaPos(MemoryArena* arena) {
+    return arena->allocatedOffset;
+}
+
+void PopArenaTo(MemoryArena* arena, uint64_t pos) {
+    assert(pos <= arena->allocatedOffset);
+
+    // @win32
+    // @NOTE: keep the same guarantee as ClearArena, pushed memory is zeroed
+    ZeroMemory((char*) arena->baseAddres + pos, arena->allocatedOffset - pos);
+    arena->allocatedOffset = pos;
+}
+
 void DestroyArena(MemoryArena* arena) {
     // @Win32
     VirtualFree(arena->baseAddres, 0, MEM_RELEASE);
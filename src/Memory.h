@@ -30,6 +30,11 @@ void* PushArena(MemoryArena* arena, uint64_t size);
 void ClearArena(MemoryArena* arena);
 void DestroyArena(MemoryArena* arena);
 
+// @NOTE: used for scratch allocations: save position, push temporary data,
+// and pop back to saved position when it is no longer needed
+uint64_t GetArenaPos(MemoryArena* arena);
+void PopArenaTo(MemoryArena* arena, uint64_t pos);
+
 // ======================================
 // Slice 
 // ======================================
@@ -0,0 +1,254 @@
+#include "SimpleRenderer.h"
+
+#include <stdio.h>
+#include <string.h>
+
+//========================================
+// Mesh cache
+//========================================
+
+// Binary file layout:
+//   MeshCacheHeader
+//   vertex data - packed exactly like the GPU vertex buffer (interleaved or quantized layout)
+//   index data  - packed exactly like the GPU index buffer, LOD 0 followed by other LODs
+// Both data blocks are aligned to MESH_CACHE_ALIGNMENT from the start of the file,
+// so they can be uploaded straight from the memory mapped file.
+
+#define MESH_CACHE_MAGIC     0x4853454D // "MESH"
+#define MESH_CACHE_VERSION   3
+#define MESH_CACHE_ALIGNMENT 64
+
+struct MeshCacheHeader {
+    uint32_t magic;
+    uint32_t version;
+
+    // Hash of the source asset, cache is rebuilt when it changes
+    uint64_t sourceHash;
+
+    uint32_t layout;
+    uint32_t attributes;
+    uint32_t vertexStride;
+    uint32_t indexType;
+
+    uint32_t vertexCount;
+    uint32_t indexCount;
+
+    uint64_t vertexDataOffset;
+    uint64_t indexDataOffset;
+
+    BoundingBox bounds;
+    BoundingSphere boundingSphere;
+    Vector2 uvMin;
+    Vector2 uvSize;
+
+    int32_t lodCount;
+    MeshLod lods[MESH_MAX_LODS];
+};
+
+static uint64_t AlignCacheOffset(uint64_t offset) {
+    return (offset + MESH_CACHE_ALIGNMENT - 1) & ~(uint64_t) (MESH_CACHE_ALIGNMENT - 1);
+}
+
+// 64 bit FNV-1a, 8 bytes at a time
+uint64_t HashBytes(void* data, uint64_t size) {
+    uint64_t hash = 14695981039346656037ull;
+    uint8_t* bytes = (uint8_t*) data;
+
+    uint64_t i = 0;
+    for(; i + 8 <= size; i += 8) {
+        uint64_t word;
+        memcpy(&word, bytes + i, 8);
+        hash = (hash ^ word) * 1099511628211ull;
+    }
+
+    for(; i < size; i++) {
+        hash = (hash ^ bytes[i]) * 1099511628211ull;
+    }
+
+    return hash;
+}
+
+bool SaveMeshCache(char* path, Mesh* mesh, VertexLayout layout, uint64_t sourceHash) {
+    assert(path && mesh);
+    assert(layout != VertexLayout::Split);
+
+    SetMeshMetadata(mesh, layout);
+
+    VertexFormat format = GetVertexFormat(mesh, layout);
+    int indexSize = GetGLTypeSize(mesh->indexType);
+
+    MeshCacheHeader header = {};
+    header.magic        = MESH_CACHE_MAGIC;
+    header.version      = MESH_CACHE_VERSION;
+    header.sourceHash   = sourceHash;
+    header.layout       = (uint32_t) layout;
+    header.attributes   = GetMeshAttributes(mesh);
+    header.vertexStride = format.stride;
+    header.indexType    = mesh->indexType;
+    header.vertexCount  = (uint32_t) mesh->vertices.length;
+    header.indexCount   = (uint32_t) (mesh->triangles.length + mesh->lodTriangles.length);
+    header.bounds       = mesh->bounds;
+    header.boundingSphere = mesh->boundingSphere;
+    header.uvMin        = mesh->uvMin;
+    header.uvSize       = mesh->uvSize;
+    header.lodCount     = mesh->lodCount;
+    memcpy(header.lods, mesh->lods, sizeof(header.lods));
+
+    uint64_t vertexDataSize = (uint64_t) header.vertexCount * header.vertexStride;
+    uint64_t indexDataSize  = (uint64_t) header.indexCount * indexSize;
+
+    header.vertexDataOffset = AlignCacheOffset(sizeof(MeshCacheHeader));
+    header.indexDataOffset  = AlignCacheOffset(header.vertexDataOffset + vertexDataSize);
+
+    // Whole file is built in memory and written at once
+    uint64_t fileSize = header.indexDataOffset + indexDataSize;
+    uint8_t* fileData = (uint8_t*) calloc(1, fileSize);
+    assert(fileData);
+
+    memcpy(fileData, &header, sizeof(header));
+    PackVertices(mesh, format, fileData + header.vertexDataOffset);
+
+    uint8_t* indexData = fileData + header.indexDataOffset;
+    PackIndices(mesh->triangles, mesh->indexType, indexData);
+    PackIndices(mesh->lodTriangles, mesh->indexType, indexData + mesh->triangles.length * indexSize);
+
+    bool ret = false;
+
+    FILE* file;
+    errno_t err = fopen_s(&file, path, "wb");
+    if(err == 0) {
+        ret = fwrite(fileData, 1, fileSize, file) == fileSize;
+        fclose(file);
+    }
+
+    if(ret == false) {
+        fprintf(stderr, "[Error] Can't write mesh cache at path: %s\n", path);
+    }
+
+    free(fileData);
+    return ret;
+}
+
+bool LoadMeshCache(char* path, Mesh* mesh, VertexLayout layout, uint64_t sourceHash) {
+    assert(path && mesh);
+
+    MappedFile file = Win32_MapFile(path);
+    if(file.data == NULL) {
+        return false;
+    }
+
+    uint8_t* data = (uint8_t*) file.data;
+
+    MeshCacheHeader header = {};
+    if(file.size >= sizeof(MeshCacheHeader)) {
+        memcpy(&header, data, sizeof(MeshCacheHeader));
+    }
+
+    bool valid = header.magic == MESH_CACHE_MAGIC &&
+                 header.version == MESH_CACHE_VERSION &&
+                 header.sourceHash == sourceHash &&
+                 header.layout == (uint32_t) layout &&
+                 (header.indexType == GL_UNSIGNED_SHORT || header.indexType == GL_UNSIGNED_INT) &&
+                 header.lodCount >= 1 && header.lodCount <= MESH_MAX_LODS;
+
+    VertexFormat format = {};
+    uint64_t vertexDataSize = 0;
+    uint64_t indexDataSize  = 0;
+
+    if(valid) {
+        format = GetVertexFormat(header.attributes, layout);
+
+        vertexDataSize = (uint64_t) header.vertexCount * header.vertexStride;
+        indexDataSize  = (uint64_t) header.indexCount * GetGLTypeSize(header.indexType);
+
+        valid = header.vertexStride == (uint32_t) format.stride &&
+                header.vertexDataOffset + vertexDataSize <= file.size &&
+                header.indexDataOffset + indexDataSize <= file.size;
+    }
+
+    for(int i = 0; valid && i < header.lodCount; i++) {
+        MeshLod lod = header.lods[i];
+        valid = lod.firstIndex >= 0 && lod.indexCount >= 0 &&
+                (uint64_t) lod.firstIndex + lod.indexCount <= header.indexCount;
+    }
+
+    if(valid == false) {
+        Win32_UnmapFile(&file);
+        return false;
+    }
+
+    if(mesh->VAO != 0 || mesh->heap) {
+        DeleteMesh(mesh);
+    }
+
+    // @NOTE: there is no CPU side data, mesh can only be drawn
+    *mesh = {};
+    mesh->layout    = layout;
+    mesh->bounds    = header.bounds;
+    mesh->boundingSphere = header.boundingSphere;
+    mesh->uvMin     = header.uvMin;
+    mesh->uvSize    = header.uvSize;
+    mesh->indexType = header.indexType;
+    mesh->lodCount  = header.lodCount;
+    memcpy(mesh->lods, header.lods, sizeof(mesh->lods));
+
+    // Buffers are filled straight from the mapping, without intermediate copies
+    CreateMeshBuffers(mesh, format, data + header.vertexDataOffset, vertexDataSize,
+                      data + header.indexDataOffset, indexDataSize);
+
+    Win32_UnmapFile(&file);
+    return true;
+}
+
+Mesh LoadMeshCached(char* sourcePath, char* cachePath, VertexLayout layout, int lodCount,
+                    MemoryArena* arena, MemoryArena* tempArena)
+{
+    assert(sourcePath && cachePath && arena && tempArena);
+    assert(layout != VertexLayout::Split);
+
+    Mesh mesh = {};
+
+    MappedFile source = Win32_MapFile(sourcePath);
+    if(source.data == NULL) {
+        fprintf(stderr, "[Error] Can't find mesh at path: %s\n", sourcePath);
+        return mesh;
+    }
+
+    uint64_t sourceHash = HashBytes(source.data, source.size);
+    Win32_UnmapFile(&source);
+
+    if(LoadMeshCache(cachePath, &mesh, layout, sourceHash)) {
+        return mesh;
+    }
+
+    // Cache is missing or outdated, CPU data is needed only to build it
+    uint64_t arenaPos = GetArenaPos(arena);
+
+    Mesh imported = ImportMeshAtPath(sourcePath, arena, tempArena);
+    if(imported.triangles.length != 0) {
+        OptimizeMesh(&imported, tempArena);
+        if(lodCount > 1) {
+            GenerateLods(&imported, lodCount, arena);
+        }
+
+        if(SaveMeshCache(cachePath, &imported, layout, sourceHash) == false ||
+           LoadMeshCache(cachePath, &mesh, layout, sourceHash) == false)
+        {
+            // Cache can't be used, but the mesh is still valid
+            ApplyMesh(&imported, layout);
+
+            mesh = imported;
+            mesh.vertices = {};
+            mesh.normals = {};
+            mesh.uv = {};
+            mesh.colors = {};
+            mesh.joints = {};
+            mesh.weights = {};
+            mesh.triangles = {};
+            mesh.lodTriangles = {};
+        }
+    }
+
+    PopArenaTo(arena, arenaPos);
+    return mesh;
+}
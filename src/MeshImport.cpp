@@ -0,0 +1,1177 @@
+#include "SimpleRenderer.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+
+//========================================
+// Mesh import
+//========================================
+
+// @NOTE: Importers only fill CPU side mesh data, so meshes can be optimized
+// before ApplyMesh. Mesh data is pushed to the arena, everything pushed to
+// tempArena is popped before return. Files are memory mapped and parsed in place.
+
+// @NOTE: arena and tempArena can be the same, mesh slices are then pushed above the scratch
+// memory and popping would zero them. They are moved down to the saved position instead.
+static void PopImportScratch(Mesh* mesh, MemoryArena* arena, MemoryArena* tempArena, uint64_t tempPos) {
+    if(arena != tempArena) {
+        PopArenaTo(tempArena, tempPos);
+        return;
+    }
+
+    struct MovedSlice {
+        void** data;
+        uint64_t size;
+    };
+
+    MovedSlice slices[4] = {
+        {(void**) &mesh->vertices.data,  mesh->vertices.length * sizeof(Vector3)},
+        {(void**) &mesh->normals.data,   mesh->normals.length * sizeof(Vector3)},
+        {(void**) &mesh->uv.data,        mesh->uv.length * sizeof(Vector2)},
+        {(void**) &mesh->triangles.data, mesh->triangles.length * sizeof(int32_t)},
+    };
+
+    // Moved in address order, so every slice only moves down over already moved ones
+    for(int i = 1; i < 4; i++) {
+        for(int j = i; j > 0 && (char*) *slices[j].data < (char*) *slices[j - 1].data; j--) {
+            MovedSlice temp = slices[j];
+            slices[j] = slices[j - 1];
+            slices[j - 1] = temp;
+        }
+    }
+
+    uint64_t pos = tempPos;
+    for(int i = 0; i < 4; i++) {
+        if(slices[i].size == 0) {
+            continue;
+        }
+
+        char* destination = (char*) arena->baseAddres + pos;
+        memmove(destination, *slices[i].data, slices[i].size);
+        *slices[i].data = destination;
+
+        pos += slices[i].size;
+    }
+
+    PopArenaTo(arena, pos);
+}
+
+static bool IsDigit(char c) {
+    return c >= '0' && c <= '9';
+}
+
+static bool IsSpace(char c) {
+    return c == ' ' || c == '\t' || c == '\r';
+}
+
+static char* SkipSpaces(char* at, char* end) {
+    while(at < end && IsSpace(*at)) {
+        at++;
+    }
+
+    return at;
+}
+
+static char* SkipLine(char* at, char* end) {
+    while(at < end && *at != '\n') {
+        at++;
+    }
+
+    return at < end ? at + 1 : end;
+}
+
+static double Pow10(int exponent) {
+    static const double table[] = {
+        1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+        1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22,
+    };
+
+    if(exponent >= 0 && exponent <= 22) {
+        return table[exponent];
+    }
+    if(exponent < 0 && exponent >= -22) {
+        return 1.0 / table[-exponent];
+    }
+
+    return pow(10.0, exponent);
+}
+
+// Parses decimal number with optional fraction and exponent, returns NULL if there is no number
+static char* ParseNumber(char* at, char* end, double* result) {
+    at = SkipSpaces(at, end);
+
+    bool negative = false;
+    if(at < end && (*at == '-' || *at == '+')) {
+        negative = *at == '-';
+        at++;
+    }
+
+    uint64_t mantissa = 0;
+    int exponent = 0;
+    int digits = 0;
+
+    // @NOTE: digits past 19th don't fit into the mantissa and only change the exponent
+    for(; at < end && IsDigit(*at); at++, digits++) {
+        if(digits < 19) mantissa = mantissa * 10 + (*at - '0');
+        else            exponent++;
+    }
+
+    if(at < end && *at == '.') {
+        for(at++; at < end && IsDigit(*at); at++, digits++) {
+            if(digits < 19) {
+                mantissa = mantissa * 10 + (*at - '0');
+                exponent--;
+            }
+        }
+    }
+
+    if(digits == 0) {
+        return NULL;
+    }
+
+    if(at < end && (*at == 'e' || *at == 'E')) {
+        at++;
+
+        bool negativeExponent = false;
+        if(at < end && (*at == '-' || *at == '+')) {
+            negativeExponent = *at == '-';
+            at++;
+        }
+
+        int value = 0;
+        for(; at < end && IsDigit(*at); at++) {
+            if(value < 10000) value = value * 10 + (*at - '0');
+        }
+
+        exponent += negativeExponent ? -value : value;
+    }
+
+    double value = (double) mantissa * Pow10(exponent);
+    *result = negative ? -value : value;
+
+    return at;
+}
+
+static char* ParseFloats(char* at, char* end, float* result, int count) {
+    for(int i = 0; i < count; i++) {
+        double value = 0;
+        at = ParseNumber(at, end, &value);
+        if(at == NULL) {
+            return NULL;
+        }
+
+        result[i] = (float) value;
+    }
+
+    return at;
+}
+
+static char* ParseInt(char* at, char* end, int32_t* result) {
+    bool negative = false;
+    if(at < end && *at == '-') {
+        negative = true;
+        at++;
+    }
+
+    if(at == end || IsDigit(*at) == false) {
+        return NULL;
+    }
+
+    int64_t value = 0;
+    for(; at < end && IsDigit(*at); at++) {
+        if(value < INT32_MAX) value = value * 10 + (*at - '0');
+    }
+
+    *result = (int32_t) (negative ? -value : value);
+    return at;
+}
+
+//========================================
+// OBJ
+//========================================
+
+#define OBJ_MIN_CHUNK_SIZE Kilobytes(256)
+#define OBJ_MAX_CHUNKS 256
+
+struct ObjCorner {
+    int32_t position;
+    int32_t texcoord;
+    int32_t normal;
+};
+
+struct ObjChunk {
+    char* start;
+    char* end;
+
+    // Counted in the first pass
+    int positionsCount;
+    int texcoordsCount;
+    int normalsCount;
+    int cornersCount;
+
+    // Where the chunk writes in the second pass
+    int positionsOffset;
+    int texcoordsOffset;
+    int normalsOffset;
+    int cornersOffset;
+
+    bool failed;
+};
+
+struct ObjParseJob {
+    ObjChunk* chunks;
+
+    Vector3* positions;
+    Vector2* texcoords;
+    Vector3* normals;
+    ObjCorner* corners;
+
+    int positionsCount;
+    int texcoordsCount;
+    int normalsCount;
+
+    // Only counts elements when false
+    bool fill;
+};
+
+// Converts OBJ index (1 based or negative relative) to 0 based index, -1 if it's invalid
+static int32_t ResolveObjIndex(int32_t index, int countSoFar, int totalCount) {
+    int32_t ret = index > 0 ? index - 1 : countSoFar + index;
+    return (index != 0 && ret >= 0 && ret < totalCount) ? ret : -1;
+}
+
+// Parses "v", "v/vt", "v//vn" or "v/vt/vn"
+static char* ParseObjCorner(char* at, char* end, int32_t indices[3]) {
+    indices[0] = indices[1] = indices[2] = 0;
+
+    at = ParseInt(at, end, indices + 0);
+    if(at == NULL) {
+        return NULL;
+    }
+
+    for(int i = 1; i < 3 && at < end && *at == '/'; i++) {
+        at++;
+        if(at < end && (IsDigit(*at) || *at == '-')) {
+            at = ParseInt(at, end, indices + i);
+            if(at == NULL) {
+                return NULL;
+            }
+        }
+    }
+
+    return at;
+}
+
+static void ParseObjChunk(ObjParseJob* job, ObjChunk* chunk) {
+    int positions = 0;
+    int texcoords = 0;
+    int normals   = 0;
+    int corners   = 0;
+
+    char* end = chunk->end;
+    for(char* at = chunk->start; at < end; at = SkipLine(at, end)) {
+        at = SkipSpaces(at, end);
+        if(at + 1 >= end) {
+            continue;
+        }
+
+        if(at[0] == 'v' && IsSpace(at[1])) {
+            if(job->fill) {
+                if(ParseFloats(at + 1, end, &job->positions[chunk->positionsOffset + positions].x, 3) == NULL) {
+                    chunk->failed = true;
+                }
+            }
+
+            positions++;
+        }
+        else if(at[0] == 'v' && at[1] == 't') {
+            if(job->fill) {
+                Vector2* texcoord = job->texcoords + chunk->texcoordsOffset + texcoords;
+                if(ParseFloats(at + 2, end, &texcoord->x, 2) == NULL) {
+                    chunk->failed = true;
+                }
+
+                // @NOTE: OBJ has origin in the bottom left, textures are loaded with origin in the top left
+                texcoord->y = 1.0f - texcoord->y;
+            }
+
+            texcoords++;
+        }
+        else if(at[0] == 'v' && at[1] == 'n') {
+            if(job->fill) {
+                if(ParseFloats(at + 2, end, &job->normals[chunk->normalsOffset + normals].x, 3) == NULL) {
+                    chunk->failed = true;
+                }
+            }
+
+            normals++;
+        }
+        else if(at[0] == 'f' && IsSpace(at[1])) {
+            // Polygons are triangulated as a fan
+            ObjCorner first = {};
+            ObjCorner previous = {};
+            int faceCorners = 0;
+
+            at++;
+            while(true) {
+                at = SkipSpaces(at, end);
+                if(at == end || *at == '\n' || *at == '#') {
+                    break;
+                }
+
+                int32_t indices[3];
+                at = ParseObjCorner(at, end, indices);
+                if(at == NULL) {
+                    chunk->failed = true;
+                    break;
+                }
+
+                ObjCorner corner = {};
+                if(job->fill) {
+                    corner.position = ResolveObjIndex(indices[0], chunk->positionsOffset + positions, job->positionsCount);
+                    corner.texcoord = indices[1] ? ResolveObjIndex(indices[1], chunk->texcoordsOffset + texcoords, job->texcoordsCount) : -1;
+                    corner.normal   = indices[2] ? ResolveObjIndex(indices[2], chunk->normalsOffset + normals, job->normalsCount) : -1;
+
+                    if(corner.position < 0 || (indices[1] && corner.texcoord < 0) || (indices[2] && corner.normal < 0)) {
+                        chunk->failed = true;
+                    }
+                }
+
+                if(faceCorners >= 2) {
+                    if(job->fill) {
+                        ObjCorner* destination = job->corners + chunk->cornersOffset + corners;
+                        destination[0] = first;
+                        destination[1] = previous;
+                        destination[2] = corner;
+                    }
+
+                    corners += 3;
+                }
+
+                if(faceCorners == 0) {
+                    first = corner;
+                }
+
+                previous = corner;
+                faceCorners++;
+            }
+        }
+
+        if(at == NULL) {
+            break;
+        }
+    }
+
+    chunk->positionsCount = positions;
+    chunk->texcoordsCount = texcoords;
+    chunk->normalsCount   = normals;
+    chunk->cornersCount   = corners;
+}
+
+static void ObjParseFunction(void* data, int start, int end) {
+    ObjParseJob* job = (ObjParseJob*) data;
+    for(int i = start; i < end; i++) {
+        ParseObjChunk(job, job->chunks + i);
+    }
+}
+
+static uint32_t HashObjCorner(ObjCorner corner) {
+    uint32_t hash = 2166136261u;
+    hash = (hash ^ (uint32_t) corner.position) * 16777619u;
+    hash = (hash ^ (uint32_t) corner.texcoord) * 16777619u;
+    hash = (hash ^ (uint32_t) corner.normal)   * 16777619u;
+
+    return hash ^ (hash >> 15);
+}
+
+Mesh ImportObj(char* data, uint64_t size, MemoryArena* arena, MemoryArena* tempArena) {
+    assert(data && arena && tempArena);
+
+    Mesh mesh = {};
+    uint64_t tempPos = GetArenaPos(tempArena);
+
+    // Chunks start at the beginning of the line, so every line is parsed by exactly one chunk
+    int chunksCount = (int) (size / OBJ_MIN_CHUNK_SIZE);
+    if(chunksCount < 1) chunksCount = 1;
+    if(chunksCount > OBJ_MAX_CHUNKS) chunksCount = OBJ_MAX_CHUNKS;
+
+    ObjChunk* chunks = (ObjChunk*) PushArena(tempArena, chunksCount * sizeof(ObjChunk));
+
+    char* end = data + size;
+    for(int i = 0; i < chunksCount; i++) {
+        chunks[i].start = i == 0 ? data : SkipLine(data + size * i / chunksCount - 1, end);
+    }
+    for(int i = 0; i < chunksCount; i++) {
+        chunks[i].end = i == chunksCount - 1 ? end : chunks[i + 1].start;
+    }
+
+    ObjParseJob job = {};
+    job.chunks = chunks;
+
+    ParallelFor(chunksCount, 1, ObjParseFunction, &job);
+
+    int cornersCount = 0;
+    for(int i = 0; i < chunksCount; i++) {
+        chunks[i].positionsOffset = job.positionsCount;
+        chunks[i].texcoordsOffset = job.texcoordsCount;
+        chunks[i].normalsOffset   = job.normalsCount;
+        chunks[i].cornersOffset   = cornersCount;
+
+        job.positionsCount += chunks[i].positionsCount;
+        job.texcoordsCount += chunks[i].texcoordsCount;
+        job.normalsCount   += chunks[i].normalsCount;
+        cornersCount       += chunks[i].cornersCount;
+    }
+
+    if(cornersCount == 0) {
+        PopArenaTo(tempArena, tempPos);
+        return mesh;
+    }
+
+    job.positions = (Vector3*)   PushArena(tempArena, job.positionsCount * sizeof(Vector3));
+    job.texcoords = (Vector2*)   PushArena(tempArena, job.texcoordsCount * sizeof(Vector2));
+    job.normals   = (Vector3*)   PushArena(tempArena, job.normalsCount * sizeof(Vector3));
+    job.corners   = (ObjCorner*) PushArena(tempArena, cornersCount * sizeof(ObjCorner));
+    job.fill = true;
+
+    ParallelFor(chunksCount, 1, ObjParseFunction, &job);
+
+    for(int i = 0; i < chunksCount; i++) {
+        if(chunks[i].failed) {
+            PopArenaTo(tempArena, tempPos);
+            return mesh;
+        }
+    }
+
+    // Vertices with the same position, texcoord and normal indices are merged
+    uint32_t tableSize = 1;
+    while(tableSize < (uint32_t) cornersCount * 2) {
+        tableSize <<= 1;
+    }
+
+    int32_t* table = (int32_t*) PushArena(tempArena, tableSize * sizeof(int32_t));
+    memset(table, 0xFF, tableSize * sizeof(int32_t));
+
+    ObjCorner* uniqueCorners = (ObjCorner*) PushArena(tempArena, cornersCount * sizeof(ObjCorner));
+    int verticesCount = 0;
+
+    bool hasTexcoords = true;
+    bool hasNormals = true;
+
+    mesh.triangles = PushSliceToArena<int32_t>(arena, cornersCount);
+    for(int i = 0; i < cornersCount; i++) {
+        ObjCorner corner = job.corners[i];
+
+        uint32_t slot = HashObjCorner(corner) & (tableSize - 1);
+        while(table[slot] >= 0) {
+            ObjCorner other = uniqueCorners[table[slot]];
+            if(other.position == corner.position && other.texcoord == corner.texcoord && other.normal == corner.normal) {
+                break;
+            }
+
+            slot = (slot + 1) & (tableSize - 1);
+        }
+
+        if(table[slot] < 0) {
+            table[slot] = verticesCount;
+            uniqueCorners[verticesCount++] = corner;
+
+            hasTexcoords = hasTexcoords && corner.texcoord >= 0;
+            hasNormals   = hasNormals && corner.normal >= 0;
+        }
+
+        mesh.triangles.data[i] = table[slot];
+    }
+
+    mesh.vertices = PushSliceToArena<Vector3>(arena, verticesCount);
+    mesh.normals  = PushSliceToArena<Vector3>(arena, verticesCount);
+    if(hasTexcoords) {
+        mesh.uv = PushSliceToArena<Vector2>(arena, verticesCount);
+    }
+
+    for(int i = 0; i < verticesCount; i++) {
+        ObjCorner corner = uniqueCorners[i];
+
+        mesh.vertices.data[i] = job.positions[corner.position];
+        if(hasTexcoords) mesh.uv.data[i]      = job.texcoords[corner.texcoord];
+        if(hasNormals)   mesh.normals.data[i] = job.normals[corner.normal];
+    }
+
+    PopImportScratch(&mesh, arena, tempArena, tempPos);
+
+    if(hasNormals == false) {
+        CalculateNormalsParallel(&mesh, tempArena);
+    }
+
+    return mesh;
+}
+
+//========================================
+// JSON
+//========================================
+
+// Minimal JSON parser, just enough for the glTF header.
+// @NOTE: string escapes are kept as they are, glTF names we look up don't use them.
+
+enum class JsonType {
+    Null,
+    Bool,
+    Number,
+    String,
+    Array,
+    Object,
+};
+
+struct JsonValue {
+    JsonType type;
+
+    // Set for object members
+    Str8 key;
+
+    Str8 string;
+    double number;
+
+    // Children of the arrays and objects
+    JsonValue** items;
+    int count;
+};
+
+struct JsonParser {
+    char* at;
+    char* end;
+
+    MemoryArena* arena;
+    bool failed;
+};
+
+static bool ParseJsonString(JsonParser* parser, Str8* result) {
+    if(parser->at == parser->end || *parser->at != '"') {
+        return false;
+    }
+
+    char* start = ++parser->at;
+    while(parser->at < parser->end && *parser->at != '"') {
+        parser->at += *parser->at == '\\' ? 2 : 1;
+    }
+
+    if(parser->at >= parser->end) {
+        return false;
+    }
+
+    *result = Str8{start, (uint64_t) (parser->at - start)};
+    parser->at++;
+
+    return true;
+}
+
+static void SkipJsonWhitespace(JsonParser* parser) {
+    while(parser->at < parser->end && (IsSpace(*parser->at) || *parser->at == '\n')) {
+        parser->at++;
+    }
+}
+
+static JsonValue* ParseJsonValue(JsonParser* parser, int depth);
+
+// Parses array or object items, which are stored in a temporary list first
+static void ParseJsonItems(JsonParser* parser, JsonValue* value, char close, int depth) {
+    struct JsonItemNode {
+        JsonValue* value;
+        JsonItemNode* next;
+    };
+
+    JsonItemNode* first = NULL;
+    JsonItemNode* last = NULL;
+
+    parser->at++;
+    SkipJsonWhitespace(parser);
+
+    while(parser->failed == false && parser->at < parser->end && *parser->at != close) {
+        Str8 key = {};
+        if(value->type == JsonType::Object) {
+            if(ParseJsonString(parser, &key) == false) {
+                parser->failed = true;
+                return;
+            }
+
+            SkipJsonWhitespace(parser);
+            if(parser->at == parser->end || *parser->at != ':') {
+                parser->failed = true;
+                return;
+            }
+            parser->at++;
+        }
+
+        JsonValue* item = ParseJsonValue(parser, depth + 1);
+        if(item == NULL) {
+            parser->failed = true;
+            return;
+        }
+
+        item->key = key;
+
+        JsonItemNode* node = (JsonItemNode*) PushArena(parser->arena, sizeof(JsonItemNode));
+        node->value = item;
+        if(last) last->next = node;
+        else     first = node;
+        last = node;
+
+        value->count++;
+
+        SkipJsonWhitespace(parser);
+        if(parser->at < parser->end && *parser->at == ',') {
+            parser->at++;
+            SkipJsonWhitespace(parser);
+        }
+    }
+
+    if(parser->at == parser->end) {
+        parser->failed = true;
+        return;
+    }
+
+    parser->at++;
+
+    // Items are kept in the array, so they can be indexed directly
+    value->items = (JsonValue**) PushArena(parser->arena, value->count * sizeof(JsonValue*));
+    int index = 0;
+    for(JsonItemNode* node = first; node; node = node->next) {
+        value->items[index++] = node->value;
+    }
+}
+
+static JsonValue* ParseJsonValue(JsonParser* parser, int depth) {
+    SkipJsonWhitespace(parser);
+    if(parser->at == parser->end || depth > 64) {
+        return NULL;
+    }
+
+    JsonValue* value = (JsonValue*) PushArena(parser->arena, sizeof(JsonValue));
+    char c = *parser->at;
+
+    if(c == '{' || c == '[') {
+        value->type = c == '{' ? JsonType::Object : JsonType::Array;
+        ParseJsonItems(parser, value, c == '{' ? '}' : ']', depth);
+    }
+    else if(c == '"') {
+        value->type = JsonType::String;
+        parser->failed = ParseJsonString(parser, &value->string) == false;
+    }
+    else if(c == 't' || c == 'f' || c == 'n') {
+        int length = c == 'f' ? 5 : 4;
+        if(parser->end - parser->at < length) {
+            return NULL;
+        }
+
+        value->type = c == 'n' ? JsonType::Null : JsonType::Bool;
+        value->number = c == 't' ? 1 : 0;
+        parser->at += length;
+    }
+    else {
+        value->type = JsonType::Number;
+        parser->at = ParseNumber(parser->at, parser->end, &value->number);
+        if(parser->at == NULL) {
+            return NULL;
+        }
+    }
+
+    return parser->failed ? NULL : value;
+}
+
+static JsonValue* JsonGet(JsonValue* object, const char* key) {
+    if(object == NULL || object->type != JsonType::Object) {
+        return NULL;
+    }
+
+    size_t length = strlen(key);
+    for(int i = 0; i < object->count; i++) {
+        Str8 itemKey = object->items[i]->key;
+        if(itemKey.length == length && memcmp(itemKey.str, key, length) == 0) {
+            return object->items[i];
+        }
+    }
+
+    return NULL;
+}
+
+static JsonValue* JsonIndex(JsonValue* array, int index) {
+    if(array == NULL || array->type != JsonType::Array || index < 0 || index >= array->count) {
+        return NULL;
+    }
+
+    return array->items[index];
+}
+
+static double JsonNumber(JsonValue* value, double defaultValue) {
+    return (value && value->type == JsonType::Number) ? value->number : defaultValue;
+}
+
+static bool JsonStringEquals(JsonValue* value, const char* string) {
+    size_t length = strlen(string);
+    return value && value->type == JsonType::String &&
+           value->string.length == length && memcmp(value->string.str, string, length) == 0;
+}
+
+//========================================
+// glTF
+//========================================
+
+#define GLB_MAGIC      0x46546C67 // "glTF"
+#define GLB_CHUNK_JSON 0x4E4F534A // "JSON"
+#define GLB_CHUNK_BIN  0x004E4942 // "BIN\0"
+
+#define GLTF_BYTE           5120
+#define GLTF_UNSIGNED_BYTE  5121
+#define GLTF_SHORT          5122
+#define GLTF_UNSIGNED_SHORT 5123
+#define GLTF_UNSIGNED_INT   5125
+#define GLTF_FLOAT          5126
+
+#define GLTF_TRIANGLES 4
+
+struct GltfAccessor {
+    uint8_t* data;
+    int count;
+    int stride;
+
+    int componentType;
+    int components;
+    bool normalized;
+};
+
+enum class GltfTarget {
+    Positions,
+    Normals,
+    Texcoords,
+    Indices,
+};
+
+struct GltfAccessorJob {
+    GltfAccessor accessor;
+    GltfTarget target;
+
+    // Vertex or index offset in the mesh
+    int offset;
+    // Added to every index
+    int baseVertex;
+};
+
+struct GltfImportJob {
+    Mesh* mesh;
+    GltfAccessorJob* jobs;
+};
+
+static int GetGltfComponentSize(int componentType) {
+    switch(componentType) {
+        case GLTF_BYTE:
+        case GLTF_UNSIGNED_BYTE:  return 1;
+        case GLTF_SHORT:
+        case GLTF_UNSIGNED_SHORT: return 2;
+        case GLTF_UNSIGNED_INT:
+        case GLTF_FLOAT:          return 4;
+    }
+
+    return 0;
+}
+
+static int GetGltfComponentsCount(JsonValue* type) {
+    if(JsonStringEquals(type, "SCALAR")) return 1;
+    if(JsonStringEquals(type, "VEC2"))   return 2;
+    if(JsonStringEquals(type, "VEC3"))   return 3;
+    if(JsonStringEquals(type, "VEC4"))   return 4;
+
+    return 0;
+}
+
+static bool GetGltfAccessor(JsonValue* root, int index, uint8_t* bin, uint64_t binSize, GltfAccessor* result) {
+    JsonValue* accessor = JsonIndex(JsonGet(root, "accessors"), index);
+    if(accessor == NULL || JsonGet(accessor, "sparse")) {
+        return false;
+    }
+
+    JsonValue* bufferView = JsonIndex(JsonGet(root, "bufferViews"), (int) JsonNumber(JsonGet(accessor, "bufferView"), -1));
+    if(bufferView == NULL || JsonNumber(JsonGet(bufferView, "buffer"), 0) != 0) {
+        return false;
+    }
+
+    result->componentType = (int) JsonNumber(JsonGet(accessor, "componentType"), 0);
+    result->components    = GetGltfComponentsCount(JsonGet(accessor, "type"));
+    result->count         = (int) JsonNumber(JsonGet(accessor, "count"), 0);
+    result->normalized    = JsonNumber(JsonGet(accessor, "normalized"), 0) != 0;
+
+    int elementSize = GetGltfComponentSize(result->componentType) * result->components;
+    if(elementSize == 0 || result->count <= 0) {
+        return false;
+    }
+
+    uint64_t viewOffset = (uint64_t) JsonNumber(JsonGet(bufferView, "byteOffset"), 0);
+    uint64_t viewLength = (uint64_t) JsonNumber(JsonGet(bufferView, "byteLength"), 0);
+    uint64_t offset     = (uint64_t) JsonNumber(JsonGet(accessor, "byteOffset"), 0);
+
+    result->stride = (int) JsonNumber(JsonGet(bufferView, "byteStride"), elementSize);
+
+    uint64_t accessorSize = offset + (uint64_t) result->stride * (result->count - 1) + elementSize;
+    if(viewOffset + viewLength > binSize || accessorSize > viewLength) {
+        return false;
+    }
+
+    result->data = bin + viewOffset + offset;
+    return true;
+}
+
+static float ReadGltfComponent(GltfAccessor* accessor, int element, int component) {
+    uint8_t* data = accessor->data + (uint64_t) element * accessor->stride;
+
+    switch(accessor->componentType) {
+        case GLTF_FLOAT: {
+            float value;
+            memcpy(&value, data + component * 4, 4);
+            return value;
+        }
+        case GLTF_UNSIGNED_BYTE: {
+            uint8_t value = data[component];
+            return accessor->normalized ? value / 255.0f : value;
+        }
+        case GLTF_BYTE: {
+            int8_t value = (int8_t) data[component];
+            return accessor->normalized ? fmaxf(value / 127.0f, -1.0f) : value;
+        }
+        case GLTF_UNSIGNED_SHORT: {
+            uint16_t value;
+            memcpy(&value, data + component * 2, 2);
+            return accessor->normalized ? value / 65535.0f : value;
+        }
+        case GLTF_SHORT: {
+            int16_t value;
+            memcpy(&value, data + component * 2, 2);
+            return accessor->normalized ? fmaxf(value / 32767.0f, -1.0f) : value;
+        }
+        case GLTF_UNSIGNED_INT: {
+            uint32_t value;
+            memcpy(&value, data + component * 4, 4);
+            return (float) value;
+        }
+    }
+
+    return 0;
+}
+
+static uint32_t ReadGltfIndex(GltfAccessor* accessor, int element) {
+    uint8_t* data = accessor->data + (uint64_t) element * accessor->stride;
+
+    switch(accessor->componentType) {
+        case GLTF_UNSIGNED_BYTE:  return data[0];
+        case GLTF_UNSIGNED_SHORT: { uint16_t value; memcpy(&value, data, 2); return value; }
+        case GLTF_UNSIGNED_INT:   { uint32_t value; memcpy(&value, data, 4); return value; }
+    }
+
+    return 0;
+}
+
+static void GltfAccessorFunction(void* data, int start, int end) {
+    GltfImportJob* importJob = (GltfImportJob*) data;
+    Mesh* mesh = importJob->mesh;
+
+    for(int i = start; i < end; i++) {
+        GltfAccessorJob* job = importJob->jobs + i;
+        GltfAccessor* accessor = &job->accessor;
+
+        switch(job->target) {
+            case GltfTarget::Positions:
+            case GltfTarget::Normals: {
+                Vector3* destination = (job->target == GltfTarget::Positions ? mesh->vertices.data : mesh->normals.data) + job->offset;
+                for(int e = 0; e < accessor->count; e++) {
+                    destination[e] = {
+                        ReadGltfComponent(accessor, e, 0),
+                        ReadGltfComponent(accessor, e, 1),
+                        ReadGltfComponent(accessor, e, 2),
+                    };
+                }
+                break;
+            }
+            case GltfTarget::Texcoords: {
+                Vector2* destination = mesh->uv.data + job->offset;
+                for(int e = 0; e < accessor->count; e++) {
+                    destination[e] = {ReadGltfComponent(accessor, e, 0), ReadGltfComponent(accessor, e, 1)};
+                }
+                break;
+            }
+            case GltfTarget::Indices: {
+                int32_t* destination = mesh->triangles.data + job->offset;
+                for(int e = 0; e < accessor->count; e++) {
+                    destination[e] = job->baseVertex + (int32_t) ReadGltfIndex(accessor, e);
+                }
+                break;
+            }
+        }
+    }
+}
+
+// @NOTE: All triangle primitives of all meshes are merged into one mesh. Node transforms,
+// materials, sparse accessors and external buffers are not supported.
+Mesh ImportGlb(void* data, uint64_t size, MemoryArena* arena, MemoryArena* tempArena) {
+    assert(data && arena && tempArena);
+
+    Mesh mesh = {};
+
+    uint8_t* bytes = (uint8_t*) data;
+    if(size < 20) {
+        fprintf(stderr, "[Error] Invalid GLB header\n");
+        return mesh;
+    }
+
+    // magic, version, length, JSON chunk length, JSON chunk type
+    uint32_t header[5];
+    memcpy(header, bytes, sizeof(header));
+
+    if(header[0] != GLB_MAGIC || header[1] != 2 || header[4] != GLB_CHUNK_JSON) {
+        fprintf(stderr, "[Error] Invalid GLB header\n");
+        return mesh;
+    }
+
+    uint64_t jsonSize = header[3];
+    if(20 + jsonSize > size) {
+        fprintf(stderr, "[Error] Invalid GLB JSON chunk\n");
+        return mesh;
+    }
+
+    uint8_t* bin = NULL;
+    uint64_t binSize = 0;
+
+    uint64_t binChunk = 20 + jsonSize;
+    if(binChunk + 8 <= size) {
+        uint32_t chunkHeader[2];
+        memcpy(chunkHeader, bytes + binChunk, 8);
+
+        if(chunkHeader[1] == GLB_CHUNK_BIN && binChunk + 8 + chunkHeader[0] <= size) {
+            bin = bytes + binChunk + 8;
+            binSize = chunkHeader[0];
+        }
+    }
+
+    uint64_t tempPos = GetArenaPos(tempArena);
+
+    JsonParser parser = {};
+    parser.at    = (char*) bytes + 20;
+    parser.end   = parser.at + jsonSize;
+    parser.arena = tempArena;
+
+    JsonValue* root = ParseJsonValue(&parser, 0);
+    if(root == NULL || bin == NULL) {
+        fprintf(stderr, "[Error] Invalid GLB content\n");
+        PopArenaTo(tempArena, tempPos);
+        return mesh;
+    }
+
+    // Every accessor is a separate job, first pass only validates and counts them
+    JsonValue* meshes = JsonGet(root, "meshes");
+
+    int primitivesCount = 0;
+    for(int m = 0; meshes && m < meshes->count; m++) {
+        JsonValue* primitives = JsonGet(meshes->items[m], "primitives");
+        primitivesCount += primitives ? primitives->count : 0;
+    }
+
+    GltfAccessorJob* jobs = (GltfAccessorJob*) PushArena(tempArena, primitivesCount * 4 * sizeof(GltfAccessorJob));
+    int jobsCount = 0;
+
+    int verticesCount = 0;
+    int indicesCount = 0;
+    bool hasNormals = true;
+    bool hasTexcoords = false;
+
+    for(int m = 0; meshes && m < meshes->count; m++) {
+        JsonValue* primitives = JsonGet(meshes->items[m], "primitives");
+
+        for(int p = 0; primitives && p < primitives->count; p++) {
+            JsonValue* primitive = primitives->items[p];
+            JsonValue* attributes = JsonGet(primitive, "attributes");
+
+            if(JsonNumber(JsonGet(primitive, "mode"), GLTF_TRIANGLES) != GLTF_TRIANGLES) {
+                fprintf(stderr, "[Warning] Skipping non triangle GLB primitive\n");
+                continue;
+            }
+
+            GltfAccessorJob position = {};
+            position.target = GltfTarget::Positions;
+            position.offset = verticesCount;
+
+            if(GetGltfAccessor(root, (int) JsonNumber(JsonGet(attributes, "POSITION"), -1), bin, binSize, &position.accessor) == false ||
+               position.accessor.componentType != GLTF_FLOAT || position.accessor.components != 3)
+            {
+                fprintf(stderr, "[Error] Invalid GLB positions\n");
+                PopArenaTo(tempArena, tempPos);
+                return mesh;
+            }
+
+            int primitiveVertices = position.accessor.count;
+            jobs[jobsCount++] = position;
+
+            GltfAccessorJob normal = {};
+            normal.target = GltfTarget::Normals;
+            normal.offset = verticesCount;
+
+            JsonValue* normalIndex = JsonGet(attributes, "NORMAL");
+            if(normalIndex && GetGltfAccessor(root, (int) JsonNumber(normalIndex, -1), bin, binSize, &normal.accessor) &&
+               normal.accessor.components == 3 && normal.accessor.count == primitiveVertices)
+            {
+                jobs[jobsCount++] = normal;
+            }
+            else {
+                hasNormals = false;
+            }
+
+            GltfAccessorJob texcoord = {};
+            texcoord.target = GltfTarget::Texcoords;
+            texcoord.offset = verticesCount;
+
+            JsonValue* texcoordIndex = JsonGet(attributes, "TEXCOORD_0");
+            if(texcoordIndex && GetGltfAccessor(root, (int) JsonNumber(texcoordIndex, -1), bin, binSize, &texcoord.accessor) &&
+               texcoord.accessor.components == 2 && texcoord.accessor.count == primitiveVertices)
+            {
+                jobs[jobsCount++] = texcoord;
+                hasTexcoords = true;
+            }
+
+            GltfAccessorJob indices = {};
+            indices.target = GltfTarget::Indices;
+            indices.offset = indicesCount;
+            indices.baseVertex = verticesCount;
+
+            JsonValue* indicesIndex = JsonGet(primitive, "indices");
+            if(indicesIndex) {
+                if(GetGltfAccessor(root, (int) JsonNumber(indicesIndex, -1), bin, binSize, &indices.accessor) == false ||
+                   indices.accessor.components != 1 || indices.accessor.count % 3 != 0 ||
+                   (indices.accessor.componentType != GLTF_UNSIGNED_BYTE &&
+                    indices.accessor.componentType != GLTF_UNSIGNED_SHORT &&
+                    indices.accessor.componentType != GLTF_UNSIGNED_INT))
+                {
+                    fprintf(stderr, "[Error] Invalid GLB indices\n");
+                    PopArenaTo(tempArena, tempPos);
+                    return mesh;
+                }
+
+                jobs[jobsCount++] = indices;
+                indicesCount += indices.accessor.count;
+            }
+            else {
+                // Non indexed primitive, indices are generated after the import
+                indices.accessor.count = primitiveVertices - primitiveVertices % 3;
+                indices.accessor.data = NULL;
+                jobs[jobsCount++] = indices;
+                indicesCount += indices.accessor.count;
+            }
+
+            verticesCount += primitiveVertices;
+        }
+    }
+
+    if(indicesCount == 0) {
+        fprintf(stderr, "[Error] GLB doesn't contain any triangles\n");
+        PopArenaTo(tempArena, tempPos);
+        return mesh;
+    }
+
+    mesh.vertices  = PushSliceToArena<Vector3>(arena, verticesCount);
+    mesh.normals   = PushSliceToArena<Vector3>(arena, verticesCount);
+    mesh.triangles = PushSliceToArena<int32_t>(arena, indicesCount);
+    if(hasTexcoords) {
+        mesh.uv = PushSliceToArena<Vector2>(arena, verticesCount);
+    }
+
+    // Generated indices don't read the buffer
+    for(int i = 0; i < jobsCount; i++) {
+        if(jobs[i].target == GltfTarget::Indices && jobs[i].accessor.data == NULL) {
+            for(int e = 0; e < jobs[i].accessor.count; e++) {
+                mesh.triangles.data[jobs[i].offset + e] = jobs[i].baseVertex + e;
+            }
+
+            jobs[i] = jobs[--jobsCount];
+            i--;
+        }
+    }
+
+    GltfImportJob importJob = {};
+    importJob.mesh = &mesh;
+    importJob.jobs = jobs;
+
+    ParallelFor(jobsCount, 1, GltfAccessorFunction, &importJob);
+
+    PopImportScratch(&mesh, arena, tempArena, tempPos);
+
+    for(int i = 0; i < indicesCount; i++) {
+        if(mesh.triangles.data[i] < 0 || mesh.triangles.data[i] >= verticesCount) {
+            fprintf(stderr, "[Error] GLB index out of range\n");
+            return Mesh{};
+        }
+    }
+
+    if(hasNormals == false) {
+        CalculateNormalsParallel(&mesh, tempArena);
+    }
+
+    return mesh;
+}
+
+//========================================
+// Files
+//========================================
+
+static bool HasExtension(char* path, const char* extension) {
+    size_t pathLength = strlen(path);
+    size_t extensionLength = strlen(extension);
+    if(pathLength < extensionLength) {
+        return false;
+    }
+
+    char* pathExtension = path + pathLength - extensionLength;
+    for(size_t i = 0; i < extensionLength; i++) {
+        char c = pathExtension[i];
+        if(c >= 'A' && c <= 'Z') c += 'a' - 'A';
+
+        if(c != extension[i]) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+Mesh ImportMeshAtPath(char* path, MemoryArena* arena, MemoryArena* tempArena) {
+    assert(path);
+
+    Mesh mesh = {};
+
+    bool isObj = HasExtension(path, ".obj");
+    bool isGlb = HasExtension(path, ".glb");
+    if(isObj == false && isGlb == false) {
+        fprintf(stderr, "[Error] Unsupported mesh format: %s\n", path);
+        return mesh;
+    }
+
+    MappedFile file = Win32_MapFile(path);
+    if(file.data == NULL) {
+        fprintf(stderr, "[Error] Can't find mesh at path: %s\n", path);
+        return mesh;
+    }
+
+    if(isObj) mesh = ImportObj((char*) file.data, file.size, arena, tempArena);
+    else      mesh = ImportGlb(file.data, file.size, arena, tempArena);
+
+    Win32_UnmapFile(&file);
+
+    if(mesh.triangles.length == 0) {
+        fprintf(stderr, "[Error] Can't import mesh at path: %s\n", path);
+    }
+
+    return mesh;
+}
+
+Mesh LoadMeshAtPath(char* path, MemoryArena* arena, MemoryArena* tempArena) {
+    Mesh mesh = ImportMeshAtPath(path, arena, tempArena);
+    if(mesh.triangles.length != 0) {
+        ApplyMesh(&mesh);
+    }
+
+    return mesh;
+}
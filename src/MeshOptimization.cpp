@@ -0,0 +1,527 @@
+#include "SimpleRenderer.h"
+
+#include <stdlib.h> // qsort
+#include <math.h>
+
+//========================================
+// Mesh optimization
+//========================================
+
+// @NOTE: All functions here work on CPU side mesh data, so they should be
+// called before ApplyMesh (or mesh has to be applied again afterwards).
+// Arena is used only for scratch memory, everything pushed is popped before return.
+
+//========================================
+// Statistics
+//========================================
+
+VertexCacheStats AnalyzeVertexCache(Slice<int32_t> triangles, int vertexCount, int cacheSize, MemoryArena* arena) {
+    assert(triangles.length % 3 == 0);
+    assert(cacheSize > 0);
+
+    VertexCacheStats ret = {};
+    if(triangles.length == 0 || vertexCount == 0) {
+        return ret;
+    }
+
+    uint64_t arenaPos = GetArenaPos(arena);
+
+    // FIFO cache simulation: vertex is in the cache if less than cacheSize
+    // vertices were transformed since it was last transformed
+    int32_t* cacheTimestamps = (int32_t*) PushArena(arena, vertexCount * sizeof(int32_t));
+    int32_t timestamp = cacheSize + 1;
+
+    for(int i = 0; i < triangles.length; i++) {
+        int32_t v = triangles.data[i];
+        assert(v >= 0 && v < vertexCount);
+
+        if(timestamp - cacheTimestamps[v] > cacheSize) {
+            cacheTimestamps[v] = timestamp++;
+            ret.transformedVertices += 1;
+        }
+    }
+
+    ret.acmr = (float) ret.transformedVertices / (triangles.length / 3);
+    ret.atvr = (float) ret.transformedVertices / vertexCount;
+
+    PopArenaTo(arena, arenaPos);
+    return ret;
+}
+
+VertexFetchStats AnalyzeVertexFetch(Slice<int32_t> triangles, int vertexCount, int vertexSize, MemoryArena* arena) {
+    assert(triangles.length % 3 == 0);
+    assert(vertexSize > 0);
+
+    VertexFetchStats ret = {};
+    if(triangles.length == 0 || vertexCount == 0) {
+        return ret;
+    }
+
+    uint64_t arenaPos = GetArenaPos(arena);
+
+    // Simple direct mapped cache model, good enough to compare vertex orders
+    const int cacheLine  = 64;
+    const int cacheLines = 64 * 1024 / cacheLine;
+
+    int64_t* cache   = (int64_t*) PushArena(arena, cacheLines * sizeof(int64_t));
+    bool* referenced = (bool*) PushArena(arena, vertexCount * sizeof(bool));
+
+    for(int i = 0; i < cacheLines; i++) {
+        cache[i] = -1;
+    }
+
+    int uniqueVertices = 0;
+    for(int i = 0; i < triangles.length; i++) {
+        int32_t v = triangles.data[i];
+        assert(v >= 0 && v < vertexCount);
+
+        if(referenced[v] == false) {
+            referenced[v] = true;
+            uniqueVertices += 1;
+        }
+
+        int64_t start = (int64_t) v * vertexSize / cacheLine;
+        int64_t end   = ((int64_t) v * vertexSize + vertexSize - 1) / cacheLine;
+
+        for(int64_t line = start; line <= end; line++) {
+            int64_t* slot = cache + (line % cacheLines);
+            if(*slot != line) {
+                *slot = line;
+                ret.bytesFetched += cacheLine;
+            }
+        }
+    }
+
+    ret.overfetch = (float) ret.bytesFetched / ((int64_t) uniqueVertices * vertexSize);
+
+    PopArenaTo(arena, arenaPos);
+    return ret;
+}
+
+//========================================
+// Vertex cache optimization
+//========================================
+
+// Based on Tom Forsyth's "Linear-Speed Vertex Cache Optimisation"
+
+#define FORSYTH_CACHE_SIZE 32
+
+static float ForsythVertexScore(int cachePosition, int liveTriangles) {
+    if(liveTriangles == 0) {
+        // No triangles need this vertex
+        return -1.0f;
+    }
+
+    float score = 0;
+    if(cachePosition >= 0) {
+        if(cachePosition < 3) {
+            // Vertex was used in the last triangle, fixed score so the
+            // algorithm doesn't prefer any of the three
+            score = 0.75f;
+        }
+        else {
+            const float scaler = 1.0f / (FORSYTH_CACHE_SIZE - 3);
+            score = 1.0f - (cachePosition - 3) * scaler;
+            score = powf(score, 1.5f);
+        }
+    }
+
+    // Boost vertices with low valence, so lone triangles are not left behind
+    score += 2.0f * powf((float) liveTriangles, -0.5f);
+
+    return score;
+}
+
+void OptimizeVertexCache(Slice<int32_t> triangles, int vertexCount, MemoryArena* arena) {
+    assert(triangles.length % 3 == 0);
+
+    int triangleCount = (int) triangles.length / 3;
+    if(triangleCount == 0) {
+        return;
+    }
+
+    uint64_t arenaPos = GetArenaPos(arena);
+
+    int32_t* indices = (int32_t*) PushArena(arena, triangles.length * sizeof(int32_t));
+    memcpy(indices, triangles.data, triangles.length * sizeof(int32_t));
+
+    // Vertex -> triangles adjacency
+    int32_t* liveTriangles    = (int32_t*) PushArena(arena, vertexCount * sizeof(int32_t));
+    int32_t* adjacencyOffsets = (int32_t*) PushArena(arena, (vertexCount + 1) * sizeof(int32_t));
+    int32_t* adjacency        = (int32_t*) PushArena(arena, triangles.length * sizeof(int32_t));
+
+    for(int i = 0; i < triangles.length; i++) {
+        liveTriangles[indices[i]] += 1;
+    }
+
+    for(int v = 0; v < vertexCount; v++) {
+        adjacencyOffsets[v + 1] = adjacencyOffsets[v] + liveTriangles[v];
+    }
+
+    int32_t* fill = (int32_t*) PushArena(arena, vertexCount * sizeof(int32_t));
+    for(int i = 0; i < triangles.length; i++) {
+        int32_t v = indices[i];
+        adjacency[adjacencyOffsets[v] + fill[v]] = i / 3;
+        fill[v] += 1;
+    }
+
+    float* vertexScores = (float*) PushArena(arena, vertexCount * sizeof(float));
+    for(int v = 0; v < vertexCount; v++) {
+        vertexScores[v] = ForsythVertexScore(-1, liveTriangles[v]);
+    }
+
+    bool* emitted = (bool*) PushArena(arena, triangleCount * sizeof(bool));
+
+    // Start with the best scored triangle, later only triangles of cached vertices are checked
+    int bestTriangle = 0;
+    float bestScore = -FLOAT_MAX;
+
+    for(int t = 0; t < triangleCount; t++) {
+        float score = vertexScores[indices[t * 3 + 0]] +
+                      vertexScores[indices[t * 3 + 1]] +
+                      vertexScores[indices[t * 3 + 2]];
+
+        if(score > bestScore) {
+            bestScore = score;
+            bestTriangle = t;
+        }
+    }
+
+    // Cache is 3 entries bigger, so new triangle can be added before removing old vertices
+    int32_t cache[FORSYTH_CACHE_SIZE + 3];
+    int32_t newCache[FORSYTH_CACHE_SIZE + 3];
+    int cacheCount = 0;
+
+    int fallbackCursor = 0;
+
+    for(int output = 0; output < triangleCount; output++) {
+        if(bestTriangle == -1) {
+            // Nothing in cache has live triangles, pick next not emitted one
+            while(emitted[fallbackCursor]) {
+                fallbackCursor++;
+            }
+
+            bestTriangle = fallbackCursor;
+        }
+
+        int32_t* tri = indices + bestTriangle * 3;
+
+        triangles.data[output * 3 + 0] = tri[0];
+        triangles.data[output * 3 + 1] = tri[1];
+        triangles.data[output * 3 + 2] = tri[2];
+
+        emitted[bestTriangle] = true;
+
+        // Remove triangle from adjacency of its vertices
+        for(int k = 0; k < 3; k++) {
+            int32_t v = tri[k];
+
+            int32_t* list = adjacency + adjacencyOffsets[v];
+            int count = liveTriangles[v];
+
+            for(int i = 0; i < count; i++) {
+                if(list[i] == bestTriangle) {
+                    list[i] = list[count - 1];
+                    break;
+                }
+            }
+
+            liveTriangles[v] -= 1;
+        }
+
+        // New cache: emitted vertices at the front, followed by old entries
+        int newCacheCount = 0;
+        for(int k = 0; k < 3; k++) {
+            newCache[newCacheCount++] = tri[k];
+        }
+
+        for(int i = 0; i < cacheCount; i++) {
+            int32_t v = cache[i];
+            if(v != tri[0] && v != tri[1] && v != tri[2]) {
+                newCache[newCacheCount++] = v;
+            }
+        }
+
+        // Vertices pushed out of the cache lose their position score
+        for(int i = FORSYTH_CACHE_SIZE; i < newCacheCount; i++) {
+            int32_t v = newCache[i];
+            vertexScores[v] = ForsythVertexScore(-1, liveTriangles[v]);
+        }
+
+        cacheCount = newCacheCount < FORSYTH_CACHE_SIZE ? newCacheCount : FORSYTH_CACHE_SIZE;
+        memcpy(cache, newCache, cacheCount * sizeof(int32_t));
+
+        // Update scores of cached vertices and find next best triangle among their triangles
+        bestScore = -FLOAT_MAX;
+        bestTriangle = -1;
+
+        for(int i = 0; i < cacheCount; i++) {
+            int32_t v = cache[i];
+            vertexScores[v] = ForsythVertexScore(i, liveTriangles[v]);
+        }
+
+        for(int i = 0; i < cacheCount; i++) {
+            int32_t v = cache[i];
+
+            int32_t* list = adjacency + adjacencyOffsets[v];
+            for(int j = 0; j < liveTriangles[v]; j++) {
+                int32_t t = list[j];
+
+                float score = vertexScores[indices[t * 3 + 0]] +
+                              vertexScores[indices[t * 3 + 1]] +
+                              vertexScores[indices[t * 3 + 2]];
+
+                if(score > bestScore) {
+                    bestScore = score;
+                    bestTriangle = t;
+                }
+            }
+        }
+    }
+
+    PopArenaTo(arena, arenaPos);
+}
+
+//========================================
+// Overdraw optimization
+//========================================
+
+// Based on "Triangle Order Optimization for Graphics Hardware Computation Culling"
+// (Nehab, Barczak, Sander) as implemented in meshoptimizer. Vertex cache optimized
+// triangles are split into clusters at the points where cache is "restarted", and
+// clusters are sorted so the ones facing away from mesh center are drawn first.
+
+struct OverdrawCluster {
+    int start;
+    int count;
+    float sortKey;
+};
+
+static int CompareOverdrawClusters(const void* a, const void* b) {
+    const OverdrawCluster* ca = (const OverdrawCluster*) a;
+    const OverdrawCluster* cb = (const OverdrawCluster*) b;
+
+    // Descending order, ties broken by original order so result is deterministic
+    if(ca->sortKey != cb->sortKey) {
+        return ca->sortKey < cb->sortKey ? 1 : -1;
+    }
+
+    return ca->start - cb->start;
+}
+
+void OptimizeOverdraw(Slice<int32_t> triangles, Slice<Vector3> vertices, float threshold, MemoryArena* arena) {
+    assert(triangles.length % 3 == 0);
+
+    int triangleCount = (int) triangles.length / 3;
+    int vertexCount = (int) vertices.length;
+    if(triangleCount == 0) {
+        return;
+    }
+
+    uint64_t arenaPos = GetArenaPos(arena);
+
+    // Simulate cache to find cluster boundaries
+    const int cacheSize = 16;
+
+    int32_t* cacheTimestamps = (int32_t*) PushArena(arena, vertexCount * sizeof(int32_t));
+    int32_t timestamp = cacheSize + 1;
+
+    int32_t* misses = (int32_t*) PushArena(arena, triangleCount * sizeof(int32_t));
+    for(int t = 0; t < triangleCount; t++) {
+        for(int k = 0; k < 3; k++) {
+            int32_t v = triangles.data[t * 3 + k];
+            if(timestamp - cacheTimestamps[v] > cacheSize) {
+                cacheTimestamps[v] = timestamp++;
+                misses[t] += 1;
+            }
+        }
+    }
+
+    OverdrawCluster* clusters = (OverdrawCluster*) PushArena(arena, triangleCount * sizeof(OverdrawCluster));
+    int clusterCount = 0;
+
+    // Hard boundaries: triangle with all vertices missing the cache starts new cluster.
+    // Soft boundaries: inside hard cluster split when local ACMR is within threshold of cluster ACMR.
+    for(int t = 0; t < triangleCount;) {
+        int end = t + 1;
+        int clusterMisses = misses[t];
+        while(end < triangleCount && misses[end] != 3) {
+            clusterMisses += misses[end];
+            end++;
+        }
+
+        float clusterACMR = (float) clusterMisses / (end - t);
+
+        // Every soft cluster starts with empty cache, so splitting is allowed only after
+        // cluster amortized the cold start. Bumping timestamp invalidates all cache entries.
+        timestamp += cacheSize + 1;
+
+        int start = t;
+        int localMisses = 0;
+        for(int i = t; i < end; i++) {
+            for(int k = 0; k < 3; k++) {
+                int32_t v = triangles.data[i * 3 + k];
+                if(timestamp - cacheTimestamps[v] > cacheSize) {
+                    cacheTimestamps[v] = timestamp++;
+                    localMisses += 1;
+                }
+            }
+
+            float localACMR = (float) localMisses / (i - start + 1);
+            bool split = i + 1 < end && localACMR <= clusterACMR * threshold;
+
+            if(split || i + 1 == end) {
+                clusters[clusterCount++] = {start, i - start + 1, 0};
+
+                start = i + 1;
+                localMisses = 0;
+                timestamp += cacheSize + 1;
+            }
+        }
+
+        t = end;
+    }
+
+    // Mesh centroid
+    Vector3 meshCenter = {};
+    float meshArea = 0;
+
+    for(int t = 0; t < triangleCount; t++) {
+        Vector3 a = vertices.data[triangles.data[t * 3 + 0]];
+        Vector3 b = vertices.data[triangles.data[t * 3 + 1]];
+        Vector3 c = vertices.data[triangles.data[t * 3 + 2]];
+
+        float area = Vector3Length(Vector3CrossProduct(b - a, c - a));
+
+        meshCenter += (a + b + c) * (area / 3.0f);
+        meshArea += area;
+    }
+
+    if(meshArea > 0) {
+        meshCenter = meshCenter / meshArea;
+    }
+
+    // Cluster sort key: how much cluster faces away from the mesh center
+    for(int i = 0; i < clusterCount; i++) {
+        OverdrawCluster* cluster = clusters + i;
+
+        Vector3 center = {};
+        Vector3 normal = {};
+        float area = 0;
+
+        for(int t = cluster->start; t < cluster->start + cluster->count; t++) {
+            Vector3 a = vertices.data[triangles.data[t * 3 + 0]];
+            Vector3 b = vertices.data[triangles.data[t * 3 + 1]];
+            Vector3 c = vertices.data[triangles.data[t * 3 + 2]];
+
+            Vector3 n = Vector3CrossProduct(b - a, c - a);
+            float triArea = Vector3Length(n);
+
+            center += (a + b + c) * (triArea / 3.0f);
+            normal += n;
+            area += triArea;
+        }
+
+        if(area > 0) {
+            center = center / area;
+        }
+
+        cluster->sortKey = Vector3DotProduct(center - meshCenter, Vector3Normalize(normal));
+    }
+
+    qsort(clusters, clusterCount, sizeof(OverdrawCluster), CompareOverdrawClusters);
+
+    int32_t* source = (int32_t*) PushArena(arena, triangles.length * sizeof(int32_t));
+    memcpy(source, triangles.data, triangles.length * sizeof(int32_t));
+
+    int index = 0;
+    for(int i = 0; i < clusterCount; i++) {
+        int start = clusters[i].start * 3;
+        int count = clusters[i].count * 3;
+
+        memcpy(triangles.data + index, source + start, count * sizeof(int32_t));
+        index += count;
+    }
+
+    PopArenaTo(arena, arenaPos);
+}
+
+//========================================
+// Vertex fetch optimization
+//========================================
+
+template <typename T>
+void RemapVertexAttribute(Slice<T>* attribute, int32_t* remap, int newVertexCount, MemoryArena* arena) {
+    if(attribute->length == 0) {
+        return;
+    }
+
+    uint64_t arenaPos = GetArenaPos(arena);
+
+    T* source = (T*) PushArena(arena, attribute->length * sizeof(T));
+    memcpy(source, attribute->data, attribute->length * sizeof(T));
+
+    for(int i = 0; i < attribute->length; i++) {
+        if(remap[i] != -1) {
+            attribute->data[remap[i]] = source[i];
+        }
+    }
+
+    attribute->length = newVertexCount;
+
+    PopArenaTo(arena, arenaPos);
+}
+
+int OptimizeVertexFetch(Mesh* mesh, MemoryArena* arena) {
+    int vertexCount = (int) mesh->vertices.length;
+
+    uint64_t arenaPos = GetArenaPos(arena);
+
+    // Vertices are renumbered in order of first use, unused vertices are removed
+    int32_t* remap = (int32_t*) PushArena(arena, vertexCount * sizeof(int32_t));
+    for(int i = 0; i < vertexCount; i++) {
+        remap[i] = -1;
+    }
+
+    int newVertexCount = 0;
+    for(int i = 0; i < mesh->triangles.length; i++) {
+        int32_t v = mesh->triangles.data[i];
+        if(remap[v] == -1) {
+            remap[v] = newVertexCount++;
+        }
+
+        mesh->triangles.data[i] = remap[v];
+    }
+
+    // LODs from GenerateLods index the same vertices
+    for(int i = 0; i < mesh->lodTriangles.length; i++) {
+        int32_t v = mesh->lodTriangles.data[i];
+        if(remap[v] == -1) {
+            remap[v] = newVertexCount++;
+        }
+
+        mesh->lodTriangles.data[i] = remap[v];
+    }
+
+    RemapVertexAttribute(&mesh->vertices, remap, newVertexCount, arena);
+    RemapVertexAttribute(&mesh->normals,  remap, newVertexCount, arena);
+    RemapVertexAttribute(&mesh->uv,       remap, newVertexCount, arena);
+    RemapVertexAttribute(&mesh->colors,   remap, newVertexCount, arena);
+    RemapVertexAttribute(&mesh->joints,   remap, newVertexCount, arena);
+    RemapVertexAttribute(&mesh->weights,  remap, newVertexCount, arena);
+
+    PopArenaTo(arena, arenaPos);
+    return newVertexCount;
+}
+
+//========================================
+
+void OptimizeMesh(Mesh* mesh, MemoryArena* arena, float overdrawThreshold) {
+    OptimizeVertexCache(mesh->triangles, (int) mesh->vertices.length, arena);
+
+    if(overdrawThreshold > 0) {
+        OptimizeOverdraw(mesh->triangles, mesh->vertices, overdrawThreshold, arena);
+    }
+
+    OptimizeVertexFetch(mesh, arena);
+}
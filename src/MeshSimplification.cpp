@@ -0,0 +1,494 @@
+#include "SimpleRenderer.h"
+
+#include <stdlib.h> // qsort
+#include <math.h>
+
+//========================================
+// Mesh simplification
+//========================================
+
+// Edge collapse simplification driven by quadric error metrics (Garland, Heckbert).
+// Collapses always move vertex onto one of the existing vertices, so simplified
+// index buffers can reuse vertex buffer of the source mesh (that's how LODs work).
+//
+// To keep attributes intact:
+//  - vertices on open borders and attribute seams (same position, different vertex) are locked,
+//  - collapse cost is increased by the difference of normals, uvs and colors.
+
+// Weight of attribute difference compared to squared geometric error (relative to mesh size)
+#ifndef SIMPLIFY_ATTRIBUTE_WEIGHT
+#define SIMPLIFY_ATTRIBUTE_WEIGHT 0.001f
+#endif
+
+struct Quadric {
+    float a00, a11, a22;
+    float a01, a02, a12;
+    float b0, b1, b2;
+    float c;
+};
+
+struct EdgeCollapse {
+    int32_t from;
+    int32_t to;
+    float cost;
+};
+
+Quadric QuadricFromPlane(Vector3 n, float d, float weight) {
+    Quadric q;
+
+    q.a00 = n.x * n.x * weight;
+    q.a11 = n.y * n.y * weight;
+    q.a22 = n.z * n.z * weight;
+    q.a01 = n.x * n.y * weight;
+    q.a02 = n.x * n.z * weight;
+    q.a12 = n.y * n.z * weight;
+    q.b0  = n.x * d * weight;
+    q.b1  = n.y * d * weight;
+    q.b2  = n.z * d * weight;
+    q.c   = d * d * weight;
+
+    return q;
+}
+
+void QuadricAdd(Quadric* q, Quadric* other) {
+    q->a00 += other->a00;
+    q->a11 += other->a11;
+    q->a22 += other->a22;
+    q->a01 += other->a01;
+    q->a02 += other->a02;
+    q->a12 += other->a12;
+    q->b0  += other->b0;
+    q->b1  += other->b1;
+    q->b2  += other->b2;
+    q->c   += other->c;
+}
+
+// Squared distance to planes accumulated in quadric
+float QuadricError(Quadric* q, Vector3 p) {
+    float rx = q->a00 * p.x + q->a01 * p.y + q->a02 * p.z + q->b0;
+    float ry = q->a01 * p.x + q->a11 * p.y + q->a12 * p.z + q->b1;
+    float rz = q->a02 * p.x + q->a12 * p.y + q->a22 * p.z + q->b2;
+
+    float error = p.x * rx + p.y * ry + p.z * rz;
+    error += q->b0 * p.x + q->b1 * p.y + q->b2 * p.z + q->c;
+
+    return fabsf(error);
+}
+
+int CompareEdgeCollapses(const void* a, const void* b) {
+    const EdgeCollapse* ca = (const EdgeCollapse*) a;
+    const EdgeCollapse* cb = (const EdgeCollapse*) b;
+
+    if(ca->cost != cb->cost) {
+        return ca->cost < cb->cost ? -1 : 1;
+    }
+
+    // Deterministic order for equal costs
+    if(ca->from != cb->from) {
+        return ca->from - cb->from;
+    }
+
+    return ca->to - cb->to;
+}
+
+int CompareUInt64(const void* a, const void* b) {
+    uint64_t va = *(const uint64_t*) a;
+    uint64_t vb = *(const uint64_t*) b;
+
+    return va < vb ? -1 : (va > vb ? 1 : 0);
+}
+
+Vector3* SortPositionsContext; // @NOTE: qsort doesn't take user data
+
+int ComparePositionIndices(const void* a, const void* b) {
+    Vector3 pa = SortPositionsContext[*(const int32_t*) a];
+    Vector3 pb = SortPositionsContext[*(const int32_t*) b];
+
+    if(pa.x != pb.x) return pa.x < pb.x ? -1 : 1;
+    if(pa.y != pb.y) return pa.y < pb.y ? -1 : 1;
+    if(pa.z != pb.z) return pa.z < pb.z ? -1 : 1;
+
+    return 0;
+}
+
+void LockBorderAndSeamVertices(Slice<int32_t> triangles, Slice<Vector3> positions, bool* locked, MemoryArena* arena) {
+    uint64_t arenaPos = GetArenaPos(arena);
+
+    // Open border: edge used by only one triangle
+    uint64_t* edges = (uint64_t*) PushArena(arena, triangles.length * sizeof(uint64_t));
+    for(int t = 0; t < triangles.length; t += 3) {
+        for(int k = 0; k < 3; k++) {
+            uint32_t a = (uint32_t) triangles.data[t + k];
+            uint32_t b = (uint32_t) triangles.data[t + (k + 1) % 3];
+
+            uint32_t lo = a < b ? a : b;
+            uint32_t hi = a < b ? b : a;
+            edges[t + k] = ((uint64_t) lo << 32) | hi;
+        }
+    }
+
+    qsort(edges, triangles.length, sizeof(uint64_t), CompareUInt64);
+
+    for(int i = 0; i < triangles.length;) {
+        int count = 1;
+        while(i + count < triangles.length && edges[i + count] == edges[i]) {
+            count++;
+        }
+
+        if(count == 1) {
+            locked[edges[i] >> 32] = true;
+            locked[edges[i] & 0xFFFFFFFF] = true;
+        }
+
+        i += count;
+    }
+
+    // Attribute seams: several vertices with exactly the same position
+    int32_t* order = (int32_t*) PushArena(arena, positions.length * sizeof(int32_t));
+    for(int i = 0; i < positions.length; i++) {
+        order[i] = i;
+    }
+
+    SortPositionsContext = positions.data;
+    qsort(order, positions.length, sizeof(int32_t), ComparePositionIndices);
+
+    for(int i = 1; i < positions.length; i++) {
+        if(ComparePositionIndices(order + i - 1, order + i) == 0) {
+            locked[order[i - 1]] = true;
+            locked[order[i]] = true;
+        }
+    }
+
+    PopArenaTo(arena, arenaPos);
+}
+
+float AttributeDistance(Mesh* mesh, int32_t a, int32_t b) {
+    float ret = 0;
+
+    if(mesh->normals.length != 0) {
+        ret += Vector3DistanceSqr(mesh->normals.data[a], mesh->normals.data[b]);
+    }
+
+    if(mesh->uv.length != 0) {
+        ret += Vector2DistanceSqr(mesh->uv.data[a], mesh->uv.data[b]);
+    }
+
+    if(mesh->colors.length != 0) {
+        Vector4 d = mesh->colors.data[a] - mesh->colors.data[b];
+        ret += d.x * d.x + d.y * d.y + d.z * d.z + d.w * d.w;
+    }
+
+    // @NOTE: only weights are compared, vertices with different joints usually have different weights too
+    if(mesh->weights.length != 0) {
+        Vector4 d = mesh->weights.data[a] - mesh->weights.data[b];
+        ret += d.x * d.x + d.y * d.y + d.z * d.z + d.w * d.w;
+    }
+
+    return ret;
+}
+
+// Returns true if collapsing 'from' onto 'to' flips any triangle around 'from'
+bool CollapseFlipsTriangle(int32_t from, int32_t to, int32_t* indices, int32_t* adjacencyOffsets, int32_t* adjacency, Vector3* positions) {
+    Vector3 target = positions[to];
+
+    for(int i = adjacencyOffsets[from]; i < adjacencyOffsets[from + 1]; i++) {
+        int32_t* tri = indices + adjacency[i] * 3;
+
+        if(tri[0] == to || tri[1] == to || tri[2] == to) {
+            // Triangle will be removed
+            continue;
+        }
+
+        Vector3 p[3];
+        Vector3 q[3];
+        for(int k = 0; k < 3; k++) {
+            p[k] = positions[tri[k]];
+            q[k] = tri[k] == from ? target : p[k];
+        }
+
+        Vector3 before = Vector3CrossProduct(p[1] - p[0], p[2] - p[0]);
+        Vector3 after  = Vector3CrossProduct(q[1] - q[0], q[2] - q[0]);
+
+        if(Vector3DotProduct(before, after) <= 0) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+int SimplifyIndices(int32_t* destination, Slice<int32_t> triangles, Mesh* mesh, int targetIndexCount, float targetError, float* resultError, MemoryArena* arena) {
+    assert(triangles.length % 3 == 0);
+
+    int vertexCount = (int) mesh->vertices.length;
+    int indexCount = (int) triangles.length;
+
+    memcpy(destination, triangles.data, indexCount * sizeof(int32_t));
+
+    float maxError = 0;
+    if(resultError) {
+        *resultError = 0;
+    }
+
+    if(indexCount <= targetIndexCount) {
+        return indexCount;
+    }
+
+    uint64_t arenaPos = GetArenaPos(arena);
+
+    // Positions are normalized so errors are relative to mesh size
+    BoundingBox bounds = CalculateBounds(mesh->vertices);
+    Vector3 size = bounds.max - bounds.min;
+    float extent = fmaxf(size.x, fmaxf(size.y, size.z));
+    float invExtent = extent > 0 ? 1.0f / extent : 0;
+
+    Vector3* positions = (Vector3*) PushArena(arena, vertexCount * sizeof(Vector3));
+    for(int i = 0; i < vertexCount; i++) {
+        positions[i] = (mesh->vertices.data[i] - bounds.min) * invExtent;
+    }
+
+    bool* locked = (bool*) PushArena(arena, vertexCount * sizeof(bool));
+    LockBorderAndSeamVertices(triangles, mesh->vertices, locked, arena);
+
+    Quadric* quadrics = (Quadric*) PushArena(arena, vertexCount * sizeof(Quadric));
+    for(int t = 0; t < indexCount; t += 3) {
+        Vector3 a = positions[destination[t + 0]];
+        Vector3 b = positions[destination[t + 1]];
+        Vector3 c = positions[destination[t + 2]];
+
+        Vector3 normal = Vector3CrossProduct(b - a, c - a);
+        float area = Vector3Length(normal);
+        if(area == 0) {
+            continue;
+        }
+
+        normal = normal / area;
+
+        Quadric q = QuadricFromPlane(normal, -Vector3DotProduct(normal, a), area);
+        for(int k = 0; k < 3; k++) {
+            QuadricAdd(quadrics + destination[t + k], &q);
+        }
+    }
+
+    float maxCost = targetError * targetError;
+
+    EdgeCollapse* collapses   = (EdgeCollapse*) PushArena(arena, indexCount * sizeof(EdgeCollapse));
+    bool* touched             = (bool*) PushArena(arena, vertexCount * sizeof(bool));
+    int32_t* collapseTarget   = (int32_t*) PushArena(arena, vertexCount * sizeof(int32_t));
+    int32_t* adjacencyOffsets = (int32_t*) PushArena(arena, (vertexCount + 1) * sizeof(int32_t));
+    int32_t* adjacency        = (int32_t*) PushArena(arena, indexCount * sizeof(int32_t));
+    int32_t* fill             = (int32_t*) PushArena(arena, vertexCount * sizeof(int32_t));
+
+    while(indexCount > targetIndexCount) {
+        // Vertex -> triangles adjacency for flip checks
+        memset(adjacencyOffsets, 0, (vertexCount + 1) * sizeof(int32_t));
+        memset(fill, 0, vertexCount * sizeof(int32_t));
+
+        for(int i = 0; i < indexCount; i++) {
+            adjacencyOffsets[destination[i] + 1] += 1;
+        }
+
+        for(int v = 0; v < vertexCount; v++) {
+            adjacencyOffsets[v + 1] += adjacencyOffsets[v];
+        }
+
+        for(int i = 0; i < indexCount; i++) {
+            int32_t v = destination[i];
+            adjacency[adjacencyOffsets[v] + fill[v]] = i / 3;
+            fill[v] += 1;
+        }
+
+        // Collapse candidates, cheaper direction of every edge
+        int collapsesCount = 0;
+        for(int t = 0; t < indexCount; t += 3) {
+            for(int k = 0; k < 3; k++) {
+                int32_t a = destination[t + k];
+                int32_t b = destination[t + (k + 1) % 3];
+
+                if(locked[a] && locked[b]) {
+                    continue;
+                }
+
+                Quadric q = quadrics[a];
+                QuadricAdd(&q, quadrics + b);
+
+                float attributeCost = SIMPLIFY_ATTRIBUTE_WEIGHT * AttributeDistance(mesh, a, b);
+
+                float costAB = locked[a] ? FLOAT_MAX : QuadricError(&q, positions[b]) + attributeCost;
+                float costBA = locked[b] ? FLOAT_MAX : QuadricError(&q, positions[a]) + attributeCost;
+
+                if(costAB <= costBA) {
+                    collapses[collapsesCount++] = {a, b, costAB};
+                }
+                else {
+                    collapses[collapsesCount++] = {b, a, costBA};
+                }
+            }
+        }
+
+        qsort(collapses, collapsesCount, sizeof(EdgeCollapse), CompareEdgeCollapses);
+
+        // Every collapse removes ~2 triangles
+        int collapsesLimit = (indexCount - targetIndexCount) / 6;
+        if(collapsesLimit < 1) {
+            collapsesLimit = 1;
+        }
+
+        memset(touched, 0, vertexCount * sizeof(bool));
+        for(int v = 0; v < vertexCount; v++) {
+            collapseTarget[v] = v;
+        }
+
+        int performed = 0;
+        for(int i = 0; i < collapsesCount && performed < collapsesLimit; i++) {
+            EdgeCollapse collapse = collapses[i];
+            if(collapse.cost > maxCost) {
+                break;
+            }
+
+            if(touched[collapse.from] || touched[collapse.to]) {
+                continue;
+            }
+
+            if(CollapseFlipsTriangle(collapse.from, collapse.to, destination, adjacencyOffsets, adjacency, positions)) {
+                continue;
+            }
+
+            collapseTarget[collapse.from] = collapse.to;
+            QuadricAdd(quadrics + collapse.to, quadrics + collapse.from);
+
+            // Flip checks assume neighbourhood doesn't move, so it is frozen until next pass
+            for(int j = adjacencyOffsets[collapse.from]; j < adjacencyOffsets[collapse.from + 1]; j++) {
+                int32_t* tri = destination + adjacency[j] * 3;
+
+                touched[tri[0]] = true;
+                touched[tri[1]] = true;
+                touched[tri[2]] = true;
+            }
+
+            maxError = fmaxf(maxError, collapse.cost);
+            performed += 1;
+        }
+
+        if(performed == 0) {
+            break;
+        }
+
+        // Apply collapses and remove degenerate triangles
+        int newIndexCount = 0;
+        for(int t = 0; t < indexCount; t += 3) {
+            int32_t a = collapseTarget[destination[t + 0]];
+            int32_t b = collapseTarget[destination[t + 1]];
+            int32_t c = collapseTarget[destination[t + 2]];
+
+            if(a != b && b != c && a != c) {
+                destination[newIndexCount++] = a;
+                destination[newIndexCount++] = b;
+                destination[newIndexCount++] = c;
+            }
+        }
+
+        indexCount = newIndexCount;
+    }
+
+    if(resultError) {
+        *resultError = sqrtf(maxError);
+    }
+
+    PopArenaTo(arena, arenaPos);
+    return indexCount;
+}
+
+int GenerateLods(Mesh* mesh, int lodCount, MemoryArena* arena) {
+    assert(lodCount >= 1 && lodCount <= MESH_MAX_LODS);
+
+    int indexCount = (int) mesh->triangles.length;
+
+    mesh->lods[0] = {0, indexCount, 0};
+    mesh->lodCount = 1;
+
+    // @NOTE: LOD indices are stored after LOD0 in the index buffer. Every accepted LOD
+    // is at most half of the previous one, so their sum never exceeds LOD0.
+    mesh->lodTriangles = PushSliceToArena<int32_t>(arena, indexCount);
+
+    uint64_t arenaPos = GetArenaPos(arena);
+    int32_t* scratch = (int32_t*) PushArena(arena, indexCount * sizeof(int32_t));
+
+    Slice<int32_t> source = mesh->triangles;
+    int written = 0;
+
+    for(int i = 1; i < lodCount; i++) {
+        int target = (int) (source.length / 2) / 3 * 3;
+
+        float error = 0;
+        int count = SimplifyIndices(scratch, source, mesh, target, FLOAT_MAX, &error, arena);
+
+        if(count > target || count == 0 || written + count > indexCount) {
+            break;
+        }
+
+        int32_t* lodIndices = mesh->lodTriangles.data + written;
+        memcpy(lodIndices, scratch, count * sizeof(int32_t));
+
+        // Errors accumulate, because LOD is simplified from the previous one
+        float previousError = mesh->lods[i - 1].error;
+        mesh->lods[i] = {indexCount + written, count, previousError + error};
+        mesh->lodCount += 1;
+
+        source = MakeSlice(lodIndices, 0, count);
+        written += count;
+    }
+
+    mesh->lodTriangles.length = written;
+
+    PopArenaTo(arena, arenaPos);
+    return mesh->lodCount;
+}
+
+//========================================
+// LOD selection
+//========================================
+
+int SelectMeshLod(SRWindow* window, Mesh* mesh, Camera* camera, Matrix transform) {
+    if(mesh->lodCount <= 1) {
+        return 0;
+    }
+
+    Vector3 size = mesh->bounds.max - mesh->bounds.min;
+    float extent = fmaxf(size.x, fmaxf(size.y, size.z));
+
+    // Uniform scale approximation: largest axis scale of the transform
+    float scaleX = Vector3Length({transform.m00, transform.m01, transform.m02});
+    float scaleY = Vector3Length({transform.m10, transform.m11, transform.m12});
+    float scaleZ = Vector3Length({transform.m20, transform.m21, transform.m22});
+    float scale = fmaxf(scaleX, fmaxf(scaleY, scaleZ));
+
+    // World size of one pixel at mesh distance
+    float pixelSize = 0;
+    if(camera->cameraType == CameraType::Perspective) {
+        Vector3 center = transform * ((mesh->bounds.min + mesh->bounds.max) * 0.5f);
+        float radius = Vector3Length(size) * 0.5f * scale;
+        float distance = Vector3Distance(center, camera->position) - radius;
+
+        if(distance <= camera->nearPlane) {
+            return 0;
+        }
+
+        pixelSize = 2.0f * distance * tanf(camera->fov * 0.5f) / window->height;
+    }
+    else {
+        pixelSize = 2.0f * camera->ortographicSize / window->height;
+    }
+
+    int ret = 0;
+    for(int i = 1; i < mesh->lodCount; i++) {
+        float screenError = mesh->lods[i].error * extent * scale / pixelSize;
+        if(screenError > LOD_SCREEN_ERROR_THRESHOLD) {
+            break;
+        }
+
+        ret = i;
+    }
+
+    return ret;
+}
@@ -0,0 +1,262 @@
+#include "SimpleRenderer.h"
+
+#include <string.h>
+
+//========================================
+// Meshlets
+//========================================
+
+// Triangles are grouped in their current order, so meshlets are contiguous ranges of the
+// index buffer and can be drawn with the mesh buffers. OptimizeMesh before building improves
+// vertex locality, so meshlets get more triangles and tighter bounds.
+
+static void SetMeshletBounds(Meshlet* meshlet, Mesh* mesh) {
+    int32_t* triangles = mesh->triangles.data + meshlet->firstIndex;
+
+    Vector3 boundsMin = mesh->vertices[triangles[0]];
+    Vector3 boundsMax = boundsMin;
+
+    for(uint32_t i = 1; i < meshlet->indexCount; i++) {
+        Vector3 v = mesh->vertices[triangles[i]];
+        boundsMin = Vector3Min(boundsMin, v);
+        boundsMax = Vector3Max(boundsMax, v);
+    }
+
+    Vector3 center = (boundsMin + boundsMax) * 0.5f;
+    float radiusSq = 0;
+
+    for(uint32_t i = 0; i < meshlet->indexCount; i++) {
+        radiusSq = fmaxf(radiusSq, Vector3DistanceSqr(mesh->vertices[triangles[i]], center));
+    }
+
+    meshlet->sphere = {center, sqrtf(radiusSq)};
+
+    // Normal cone from the face normals, degenerate triangles are skipped
+    Vector3 normals[MESHLET_MAX_TRIANGLES];
+    int normalsCount = 0;
+    Vector3 normalsSum = {};
+
+    for(uint32_t i = 0; i < meshlet->indexCount; i += 3) {
+        Vector3 a = mesh->vertices[triangles[i + 0]];
+        Vector3 b = mesh->vertices[triangles[i + 1]];
+        Vector3 c = mesh->vertices[triangles[i + 2]];
+
+        Vector3 normal = Vector3CrossProduct(b - a, c - a);
+        float length = Vector3Length(normal);
+        if(length == 0) {
+            continue;
+        }
+
+        normal = normal * (1.0f / length);
+        normals[normalsCount++] = normal;
+        normalsSum = normalsSum + normal;
+    }
+
+    meshlet->coneAxis = {};
+    meshlet->coneCutoff = 1;
+
+    float axisLength = Vector3Length(normalsSum);
+    if(normalsCount == 0 || axisLength == 0) {
+        return;
+    }
+
+    Vector3 axis = normalsSum * (1.0f / axisLength);
+
+    float minDot = 1;
+    for(int i = 0; i < normalsCount; i++) {
+        minDot = fminf(minDot, Vector3DotProduct(axis, normals[i]));
+    }
+
+    // @NOTE: wide cones almost never pass the test, keep them always visible
+    if(minDot <= 0.1f) {
+        return;
+    }
+
+    meshlet->coneAxis = axis;
+    meshlet->coneCutoff = sqrtf(1 - minDot * minDot);
+}
+
+// Greedy grouping of consecutive triangles, meshlets can be NULL to only count them.
+// vertexMeshlet has to be filled with -1.
+static int GroupMeshlets(Mesh* mesh, int32_t* vertexMeshlet, Meshlet* meshlets) {
+    int trianglesCount = (int) (mesh->triangles.length / 3);
+
+    Meshlet current = {};
+    int32_t currentIndex = 0;
+
+    for(int t = 0; t < trianglesCount; t++) {
+        int32_t* triangle = mesh->triangles.data + t * 3;
+
+        uint32_t newVertices = 0;
+        for(int i = 0; i < 3; i++) {
+            bool repeated = (i > 0 && triangle[i] == triangle[0]) || (i > 1 && triangle[i] == triangle[1]);
+            newVertices += vertexMeshlet[triangle[i]] != currentIndex && !repeated;
+        }
+
+        bool full = current.verticesCount + newVertices > MESHLET_MAX_VERTICES ||
+                    current.indexCount / 3 + 1 > MESHLET_MAX_TRIANGLES;
+
+        if(full) {
+            if(meshlets) {
+                meshlets[currentIndex] = current;
+            }
+
+            currentIndex++;
+
+            current = {};
+            current.firstIndex = t * 3;
+
+            newVertices = 3 - (triangle[1] == triangle[0]) - (triangle[2] == triangle[0] || triangle[2] == triangle[1]);
+        }
+
+        for(int i = 0; i < 3; i++) {
+            vertexMeshlet[triangle[i]] = currentIndex;
+        }
+
+        current.verticesCount += newVertices;
+        current.indexCount += 3;
+    }
+
+    if(meshlets) {
+        meshlets[currentIndex] = current;
+    }
+
+    return currentIndex + 1;
+}
+
+MeshletData* BuildMeshlets(Mesh* mesh, MemoryArena* arena, MemoryArena* tempArena) {
+    assert(mesh->vertices.length > 0 && mesh->triangles.length > 0);
+
+    // Meshlet which used the vertex last
+    uint64_t vertexMeshletSize = mesh->vertices.length * sizeof(int32_t);
+
+    // @NOTE: meshlets are counted first, so the results can be pushed before the scratch
+    // memory. Arena can be the same as tempArena then.
+    uint64_t tempPos = GetArenaPos(tempArena);
+    int32_t* vertexMeshlet = (int32_t*) PushArena(tempArena, vertexMeshletSize);
+    memset(vertexMeshlet, 0xFF, vertexMeshletSize);
+
+    int meshletsCount = GroupMeshlets(mesh, vertexMeshlet, NULL);
+    PopArenaTo(tempArena, tempPos);
+
+    MeshletData* data = (MeshletData*) PushArena(arena, sizeof(MeshletData));
+    data->meshletsCount = meshletsCount;
+    data->meshlets = (Meshlet*) PushArena(arena, meshletsCount * sizeof(Meshlet));
+    data->commands = (DrawElementsIndirectCommand*) PushArena(arena, meshletsCount * sizeof(DrawElementsIndirectCommand));
+
+    tempPos = GetArenaPos(tempArena);
+    vertexMeshlet = (int32_t*) PushArena(tempArena, vertexMeshletSize);
+    memset(vertexMeshlet, 0xFF, vertexMeshletSize);
+
+    GroupMeshlets(mesh, vertexMeshlet, data->meshlets);
+    PopArenaTo(tempArena, tempPos);
+
+    for(int i = 0; i < meshletsCount; i++) {
+        SetMeshletBounds(data->meshlets + i, mesh);
+    }
+
+    mesh->meshlets = data;
+    return data;
+}
+
+// @NOTE: assumes uniform scale, normals would need the inverse transpose otherwise
+static Vector3 TransformMeshletAxis(Matrix m, Vector3 v) {
+    Vector3 ret = {
+        m.m00 * v.x + m.m10 * v.y + m.m20 * v.z,
+        m.m01 * v.x + m.m11 * v.y + m.m21 * v.z,
+        m.m02 * v.x + m.m12 * v.y + m.m22 * v.z,
+    };
+
+    return Vector3Normalize(ret);
+}
+
+int CullMeshlets(MeshletData* data, Mesh* mesh, Matrix transform, Camera* camera) {
+    Frustum frustum = GetCameraFrustum(camera);
+
+    bool orthographic = camera->cameraType == CameraType::Orthographic;
+    Vector3 forward = GetCameraForward(camera);
+
+    int commandsCount = 0;
+    data->visibleCount = 0;
+
+    for(int i = 0; i < data->meshletsCount; i++) {
+        Meshlet* meshlet = data->meshlets + i;
+
+        BoundingSphere sphere = TransformBoundingSphere(meshlet->sphere, transform);
+        if(IsSphereInFrustum(&frustum, sphere.center, sphere.radius) == false) {
+            continue;
+        }
+
+        // Backface cone, culled when every triangle faces away from the camera
+        if(meshlet->coneCutoff < 1) {
+            Vector3 axis = TransformMeshletAxis(transform, meshlet->coneAxis);
+
+            if(orthographic) {
+                if(Vector3DotProduct(forward, axis) >= meshlet->coneCutoff) {
+                    continue;
+                }
+            }
+            else {
+                Vector3 toCenter = sphere.center - camera->position;
+                if(Vector3DotProduct(toCenter, axis) >= meshlet->coneCutoff * Vector3Length(toCenter) + sphere.radius) {
+                    continue;
+                }
+            }
+        }
+
+        data->visibleCount++;
+
+        // Neighbouring visible meshlets are merged into one command
+        DrawElementsIndirectCommand* last = commandsCount > 0 ? data->commands + commandsCount - 1 : NULL;
+        uint32_t firstIndex = (uint32_t) mesh->firstIndex + meshlet->firstIndex;
+
+        if(last && last->firstIndex + last->count == firstIndex) {
+            last->count += meshlet->indexCount;
+            continue;
+        }
+
+        DrawElementsIndirectCommand* command = data->commands + commandsCount++;
+        command->count         = meshlet->indexCount;
+        command->instanceCount = 1;
+        command->firstIndex    = firstIndex;
+        command->baseVertex    = mesh->baseVertex;
+        command->baseInstance  = 0;
+    }
+
+    data->commandsCount = commandsCount;
+    return commandsCount;
+}
+
+void DrawMeshlets(SRWindow* window, Mesh* mesh, Camera camera, Matrix transform) {
+    MeshletData* data = mesh->meshlets;
+    assert(data);
+
+    if(CullMeshlets(data, mesh, transform, &camera) == 0) {
+        return;
+    }
+
+    if(data->commandBuffer == 0) {
+        glCreateBuffers(1, &data->commandBuffer);
+        glNamedBufferStorage(data->commandBuffer, data->meshletsCount * sizeof(DrawElementsIndirectCommand), NULL, GL_DYNAMIC_STORAGE_BIT);
+    }
+
+    glNamedBufferSubData(data->commandBuffer, 0, data->commandsCount * sizeof(DrawElementsIndirectCommand), data->commands);
+
+    SetFrameCamera(window, &camera);
+
+    SetMeshUniforms(window, mesh);
+    SetModelMatrix(window, transform);
+
+    BindVertexArray(mesh->heap ? mesh->heap->VAO : mesh->VAO);
+
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, data->commandBuffer);
+    glMultiDrawElementsIndirect(GL_TRIANGLES, mesh->indexType, NULL, data->commandsCount, 0);
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+}
+
+void DestroyMeshlets(Mesh* mesh) {
+    if(mesh->meshlets) {
+        glDeleteBuffers(1, &mesh->meshlets->commandBuffer);
+        mesh->meshlets = NULL;
+    }
+}
@@ -0,0 +1,185 @@
+#include "SimpleRenderer.h"
+
+#include <stdlib.h> // qsort
+
+//========================================
+// Multi draw
+//========================================
+
+// Sort key layout: VAO (31 bits) | 32 bit indices flag (1 bit) | draw index (32 bits)
+#define DRAW_KEY_INDEX_MASK 0xFFFFFFFFull
+
+static int CompareDrawKeys(const void* a, const void* b) {
+    uint64_t ka = *(const uint64_t*) a;
+    uint64_t kb = *(const uint64_t*) b;
+    return (ka > kb) - (ka < kb);
+}
+
+static void SetDrawData(DrawData* data, Mesh* mesh, Matrix transform, Vector4 color) {
+    data->model = transform;
+    data->color = color;
+
+    if(mesh->layout == VertexLayout::Quantized) {
+        Vector3 boundsSize = mesh->bounds.max - mesh->bounds.min;
+
+        data->boundsMin  = {mesh->bounds.min.x, mesh->bounds.min.y, mesh->bounds.min.z, 1};
+        data->boundsSize = {boundsSize.x, boundsSize.y, boundsSize.z, 0};
+        data->uvBounds   = {mesh->uvMin.x, mesh->uvMin.y, mesh->uvSize.x, mesh->uvSize.y};
+    }
+    else {
+        data->boundsMin  = {};
+        data->boundsSize = {};
+        data->uvBounds   = {};
+    }
+}
+
+static void SetViewProjection(SRWindow* window, Camera* camera) {
+    SetFrameCamera(window, camera);
+
+    // @NOTE: built-in shaders use the frame data, custom ones can still have their own VP
+    int vpLoc = GetShaderUniformLocation(&window->currentShader, "VP");
+    if(vpLoc != -1)
+        glUniformMatrix4fv(vpLoc, 1, false, (const float *)(&window->frameUniforms.viewProjection));
+}
+
+DrawList CreateDrawList(int capacity, MemoryArena* arena) {
+    assert(capacity > 0);
+    assert(arena);
+
+    DrawList list = {};
+    list.capacity = capacity;
+
+    list.keys           = (uint64_t*) PushArena(arena, capacity * sizeof(uint64_t));
+    list.commands       = (DrawElementsIndirectCommand*) PushArena(arena, capacity * sizeof(DrawElementsIndirectCommand));
+    list.drawData       = (DrawData*) PushArena(arena, capacity * sizeof(DrawData));
+    list.sortedCommands = (DrawElementsIndirectCommand*) PushArena(arena, capacity * sizeof(DrawElementsIndirectCommand));
+    list.sortedDrawData = (DrawData*) PushArena(arena, capacity * sizeof(DrawData));
+
+    glCreateBuffers(1, &list.commandBuffer);
+    glNamedBufferStorage(list.commandBuffer, capacity * sizeof(DrawElementsIndirectCommand), NULL, GL_DYNAMIC_STORAGE_BIT);
+
+    glCreateBuffers(1, &list.drawDataBuffer);
+    glNamedBufferStorage(list.drawDataBuffer, capacity * sizeof(DrawData), NULL, GL_DYNAMIC_STORAGE_BIT);
+
+    return list;
+}
+
+void DestroyDrawList(DrawList* list) {
+    glDeleteBuffers(1, &list->commandBuffer);
+    glDeleteBuffers(1, &list->drawDataBuffer);
+
+    *list = {};
+}
+
+void PushDraw(DrawList* list, Mesh* mesh, Matrix transform, int lod, Vector4 color) {
+    assert(list->count < list->capacity);
+    assert(lod >= 0 && lod < mesh->lodCount);
+
+    GLuint vao = mesh->heap ? mesh->heap->VAO : mesh->VAO;
+    assert(vao != 0 && vao < (1u << 31));
+
+    int index = list->count++;
+    MeshLod range = mesh->lods[lod];
+
+    uint64_t wideIndices = mesh->indexType == GL_UNSIGNED_INT;
+    list->keys[index] = ((uint64_t) vao << 33) | (wideIndices << 32) | (uint64_t) index;
+
+    DrawElementsIndirectCommand* command = list->commands + index;
+    command->count         = (uint32_t) range.indexCount;
+    command->instanceCount = 1;
+    command->firstIndex    = (uint32_t) (mesh->firstIndex + range.firstIndex);
+    command->baseVertex    = mesh->baseVertex;
+    command->baseInstance  = 0; // Set in SubmitDrawList
+
+    SetDrawData(list->drawData + index, mesh, transform, color);
+}
+
+void SubmitDrawList(SRWindow* window, DrawList* list, Camera camera) {
+    if(list->count == 0) {
+        return;
+    }
+
+    // Draws with the same VAO and index type end up next to each other, in push order
+    qsort(list->keys, list->count, sizeof(uint64_t), CompareDrawKeys);
+
+    for(int i = 0; i < list->count; i++) {
+        int index = (int) (list->keys[i] & DRAW_KEY_INDEX_MASK);
+
+        list->sortedCommands[i] = list->commands[index];
+        list->sortedCommands[i].baseInstance = i;
+        list->sortedDrawData[i] = list->drawData[index];
+    }
+
+    glNamedBufferSubData(list->commandBuffer, 0, list->count * sizeof(DrawElementsIndirectCommand), list->sortedCommands);
+    glNamedBufferSubData(list->drawDataBuffer, 0, list->count * sizeof(DrawData), list->sortedDrawData);
+
+    SetViewProjection(window, &camera);
+
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, list->commandBuffer);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, DRAW_DATA_BINDING, list->drawDataBuffer);
+
+    int bucketStart = 0;
+    while(bucketStart < list->count) {
+        uint64_t bucketKey = list->keys[bucketStart] >> 32;
+
+        int bucketEnd = bucketStart + 1;
+        while(bucketEnd < list->count && (list->keys[bucketEnd] >> 32) == bucketKey) {
+            bucketEnd++;
+        }
+
+        GLuint vao = (GLuint) (bucketKey >> 1);
+        GLenum indexType = (bucketKey & 1) ? GL_UNSIGNED_INT : GL_UNSIGNED_SHORT;
+
+        size_t offset = bucketStart * sizeof(DrawElementsIndirectCommand);
+
+        BindVertexArray(vao);
+        glMultiDrawElementsIndirect(GL_TRIANGLES, indexType, (void*) offset, bucketEnd - bucketStart, 0);
+
+        bucketStart = bucketEnd;
+    }
+
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+
+    list->count = 0;
+}
+
+//========================================
+// Instancing
+//========================================
+
+void DrawMeshInstanced(SRWindow* window, Mesh mesh, Camera camera, Slice<Matrix> transforms, Slice<Vector4> colors) {
+    assert(colors.length == 0 || colors.length == transforms.length);
+
+    if(transforms.length == 0) {
+        return;
+    }
+
+    MemoryArena* arena = &window->tempArena;
+    uint64_t arenaPos = GetArenaPos(arena);
+
+    DrawData* data = (DrawData*) PushArena(arena, transforms.length * sizeof(DrawData));
+    for(int i = 0; i < transforms.length; i++) {
+        Vector4 color = colors.length ? colors[i] : Vector4{1, 1, 1, 1};
+        SetDrawData(data + i, &mesh, transforms[i], color);
+    }
+
+    if(window->instanceBuffer == 0) {
+        glCreateBuffers(1, &window->instanceBuffer);
+    }
+
+    // @NOTE: buffer is respecified every call, so the driver can orphan the storage
+    // still used by previous draws instead of waiting for them
+    glNamedBufferData(window->instanceBuffer, transforms.length * sizeof(DrawData), data, GL_STREAM_DRAW);
+
+    PopArenaTo(arena, arenaPos);
+
+    SetViewProjection(window, &camera);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, DRAW_DATA_BINDING, window->instanceBuffer);
+
+    MeshLod range = mesh.lods[0];
+    size_t offset = (size_t) (mesh.firstIndex + range.firstIndex) * GetGLTypeSize(mesh.indexType);
+
+    BindVertexArray(mesh.heap ? mesh.heap->VAO : mesh.VAO);
+    glDrawElementsInstancedBaseVertexBaseInstance(GL_TRIANGLES, (GLsizei) range.indexCount, mesh.indexType, (void*) offset,
+                                                  (GLsizei) transforms.length, mesh.baseVertex, 0);
+}
@@ -0,0 +1,400 @@
+#include "SimpleRenderer.h"
+
+#include <float.h>
+#include <string.h>
+#include <emmintrin.h> // SSE2
+
+//========================================
+// Occlusion culling
+//========================================
+
+// Depth buffer keeps NDC depth (z / w), cleared to the far plane. Occluders only ever lower
+// the depth, occludees are visible when their nearest point is in front of the stored depth.
+
+#define OCCLUSION_NEAR_W 1e-4f
+
+struct OcclusionTriangle {
+    // Edge functions: A * x + B * y + C >= 0 inside the triangle
+    float edgeA[3];
+    float edgeB[3];
+    float edgeC[3];
+
+    // Depth plane: z = zA * x + zB * y + zC
+    float zA;
+    float zB;
+    float zC;
+
+    // Pixel bounds, inclusive
+    int minX, minY;
+    int maxX, maxY;
+};
+
+OcclusionBuffer CreateOcclusionBuffer(int width, int height, int maxTriangles, MemoryArena* arena) {
+    assert(width > 0 && width % OCCLUSION_TILE_WIDTH == 0);
+    assert(height > 0 && height % OCCLUSION_TILE_HEIGHT == 0);
+
+    OcclusionBuffer buffer = {};
+    buffer.width  = width;
+    buffer.height = height;
+
+    buffer.depth         = (float*) PushArena(arena, width * height * sizeof(float));
+    buffer.blockMaxDepth = (float*) PushArena(arena, (width / OCCLUSION_BLOCK_SIZE) * (height / OCCLUSION_BLOCK_SIZE) * sizeof(float));
+
+    buffer.maxTriangles = maxTriangles;
+    buffer.triangles    = (OcclusionTriangle*) PushArena(arena, maxTriangles * sizeof(OcclusionTriangle));
+
+    // Nothing is occluded until the first RasterizeOccluders
+    int pixelsCount = width * height;
+    int blocksCount = (width / OCCLUSION_BLOCK_SIZE) * (height / OCCLUSION_BLOCK_SIZE);
+
+    for(int i = 0; i < pixelsCount; i++) {
+        buffer.depth[i] = 1.0f;
+    }
+
+    for(int i = 0; i < blocksCount; i++) {
+        buffer.blockMaxDepth[i] = 1.0f;
+    }
+
+    return buffer;
+}
+
+void BeginOcclusion(OcclusionBuffer* buffer, Matrix vp) {
+    buffer->vp = vp;
+    buffer->trianglesCount = 0;
+}
+
+static Vector4 TransformClip(Matrix m, Vector3 v) {
+    Vector4 ret;
+    ret.x = m.m00 * v.x + m.m10 * v.y + m.m20 * v.z + m.m30;
+    ret.y = m.m01 * v.x + m.m11 * v.y + m.m21 * v.z + m.m31;
+    ret.z = m.m02 * v.x + m.m12 * v.y + m.m22 * v.z + m.m32;
+    ret.w = m.m03 * v.x + m.m13 * v.y + m.m23 * v.z + m.m33;
+    return ret;
+}
+
+// Sutherland-Hodgman against the near plane (z >= -w), triangle becomes a quad at most.
+// Order of the vertices, and so the winding, is kept.
+static int ClipTriangleNear(Vector4 in[3], Vector4 out[4]) {
+    int count = 0;
+
+    for(int i = 0; i < 3; i++) {
+        Vector4 a = in[i];
+        Vector4 b = in[(i + 1) % 3];
+
+        float distanceA = a.z + a.w;
+        float distanceB = b.z + b.w;
+
+        if(distanceA >= 0) {
+            out[count++] = a;
+        }
+
+        if((distanceA >= 0) != (distanceB >= 0)) {
+            float t = distanceA / (distanceA - distanceB);
+            out[count++] = {a.x + (b.x - a.x) * t,
+                            a.y + (b.y - a.y) * t,
+                            a.z + (b.z - a.z) * t,
+                            a.w + (b.w - a.w) * t};
+        }
+    }
+
+    return count;
+}
+
+// Returns false when the buffer is full
+static bool AddOccluderTriangle(OcclusionBuffer* buffer, Vector4 clip[3]) {
+    float width  = (float) buffer->width;
+    float height = (float) buffer->height;
+
+    Vector3 screen[3];
+    for(int v = 0; v < 3; v++) {
+        // Only possible for orthographic projections with the near plane behind the camera
+        if(clip[v].w < OCCLUSION_NEAR_W) {
+            return true;
+        }
+
+        float inverseW = 1.0f / clip[v].w;
+        screen[v].x = (clip[v].x * inverseW * 0.5f + 0.5f) * width;
+        screen[v].y = (clip[v].y * inverseW * 0.5f + 0.5f) * height;
+        screen[v].z = clip[v].z * inverseW;
+    }
+
+    // Back faces and degenerate triangles are skipped, front faces are counter clockwise
+    Vector3 d1 = screen[1] - screen[0];
+    Vector3 d2 = screen[2] - screen[0];
+    float area = d1.x * d2.y - d1.y * d2.x;
+    if(area <= 0) {
+        return true;
+    }
+
+    float minX = fminf(screen[0].x, fminf(screen[1].x, screen[2].x));
+    float minY = fminf(screen[0].y, fminf(screen[1].y, screen[2].y));
+    float maxX = fmaxf(screen[0].x, fmaxf(screen[1].x, screen[2].x));
+    float maxY = fmaxf(screen[0].y, fmaxf(screen[1].y, screen[2].y));
+
+    OcclusionTriangle triangle = {};
+    triangle.minX = (int) fmaxf(floorf(minX), 0);
+    triangle.minY = (int) fmaxf(floorf(minY), 0);
+    triangle.maxX = (int) fminf(ceilf(maxX), width - 1);
+    triangle.maxY = (int) fminf(ceilf(maxY), height - 1);
+
+    if(triangle.minX > triangle.maxX || triangle.minY > triangle.maxY) {
+        return true;
+    }
+
+    for(int e = 0; e < 3; e++) {
+        Vector3 a = screen[e];
+        Vector3 b = screen[(e + 1) % 3];
+
+        triangle.edgeA[e] = a.y - b.y;
+        triangle.edgeB[e] = b.x - a.x;
+        triangle.edgeC[e] = a.x * b.y - a.y * b.x;
+    }
+
+    Vector3 normal = Vector3CrossProduct(d1, d2);
+    triangle.zA = -normal.x / normal.z;
+    triangle.zB = -normal.y / normal.z;
+    triangle.zC = screen[0].z - triangle.zA * screen[0].x - triangle.zB * screen[0].y;
+
+    assert(buffer->trianglesCount < buffer->maxTriangles);
+    if(buffer->trianglesCount == buffer->maxTriangles) {
+        return false;
+    }
+
+    buffer->triangles[buffer->trianglesCount++] = triangle;
+    return true;
+}
+
+void AddOccluder(OcclusionBuffer* buffer, Mesh* mesh, Matrix transform) {
+    assert(mesh->vertices.length > 0);
+
+    Matrix mvp = buffer->vp * transform;
+
+    for(int i = 0; i + 2 < mesh->triangles.length; i += 3) {
+        Vector4 clip[3];
+        bool crossesNear = false;
+
+        for(int v = 0; v < 3; v++) {
+            clip[v] = TransformClip(mvp, mesh->vertices[mesh->triangles[i + v]]);
+            crossesNear |= clip[v].z + clip[v].w < 0;
+        }
+
+        if(crossesNear == false) {
+            if(AddOccluderTriangle(buffer, clip) == false) {
+                return;
+            }
+
+            continue;
+        }
+
+        // Big occluders, like floors and walls next to the camera, cross the near plane
+        Vector4 clipped[4];
+        int clippedCount = ClipTriangleNear(clip, clipped);
+
+        for(int v = 1; v + 1 < clippedCount; v++) {
+            Vector4 fan[3] = {clipped[0], clipped[v], clipped[v + 1]};
+            if(AddOccluderTriangle(buffer, fan) == false) {
+                return;
+            }
+        }
+    }
+}
+
+static void RasterizeTriangleInTile(OcclusionBuffer* buffer, OcclusionTriangle* triangle,
+                                    int tileMinX, int tileMinY, int tileMaxX, int tileMaxY)
+{
+    int minX = triangle->minX > tileMinX ? triangle->minX : tileMinX;
+    int minY = triangle->minY > tileMinY ? triangle->minY : tileMinY;
+    int maxX = triangle->maxX < tileMaxX ? triangle->maxX : tileMaxX;
+    int maxY = triangle->maxY < tileMaxY ? triangle->maxY : tileMaxY;
+
+    if(minX > maxX || minY > maxY) {
+        return;
+    }
+
+    // 4 pixels at a time, tiles are aligned to 4 pixels
+    minX &= ~3;
+
+    __m128 zero = _mm_setzero_ps();
+    __m128 laneOffsets = _mm_setr_ps(0.5f, 1.5f, 2.5f, 3.5f);
+
+    __m128 edgeA[3], edgeB[3], edgeC[3];
+    for(int e = 0; e < 3; e++) {
+        edgeA[e] = _mm_set1_ps(triangle->edgeA[e]);
+        edgeB[e] = _mm_set1_ps(triangle->edgeB[e]);
+        edgeC[e] = _mm_set1_ps(triangle->edgeC[e]);
+    }
+
+    __m128 zA = _mm_set1_ps(triangle->zA);
+    __m128 zB = _mm_set1_ps(triangle->zB);
+    __m128 zC = _mm_set1_ps(triangle->zC);
+
+    for(int y = minY; y <= maxY; y++) {
+        __m128 py = _mm_set1_ps(y + 0.5f);
+        float* row = buffer->depth + y * buffer->width;
+
+        // Edge and depth values at the start of the row, stepped by 4 pixels
+        __m128 px = _mm_add_ps(_mm_set1_ps((float) minX), laneOffsets);
+
+        __m128 edge0 = _mm_add_ps(_mm_add_ps(_mm_mul_ps(edgeA[0], px), _mm_mul_ps(edgeB[0], py)), edgeC[0]);
+        __m128 edge1 = _mm_add_ps(_mm_add_ps(_mm_mul_ps(edgeA[1], px), _mm_mul_ps(edgeB[1], py)), edgeC[1]);
+        __m128 edge2 = _mm_add_ps(_mm_add_ps(_mm_mul_ps(edgeA[2], px), _mm_mul_ps(edgeB[2], py)), edgeC[2]);
+        __m128 depth = _mm_add_ps(_mm_add_ps(_mm_mul_ps(zA, px), _mm_mul_ps(zB, py)), zC);
+
+        __m128 edgeStep0 = _mm_mul_ps(edgeA[0], _mm_set1_ps(4));
+        __m128 edgeStep1 = _mm_mul_ps(edgeA[1], _mm_set1_ps(4));
+        __m128 edgeStep2 = _mm_mul_ps(edgeA[2], _mm_set1_ps(4));
+        __m128 depthStep = _mm_mul_ps(zA, _mm_set1_ps(4));
+
+        for(int x = minX; x <= maxX; x += 4) {
+            __m128 inside = _mm_and_ps(_mm_and_ps(_mm_cmpge_ps(edge0, zero), _mm_cmpge_ps(edge1, zero)),
+                                       _mm_cmpge_ps(edge2, zero));
+
+            if(_mm_movemask_ps(inside)) {
+                __m128 old = _mm_loadu_ps(row + x);
+                __m128 closer = _mm_min_ps(old, depth);
+                _mm_storeu_ps(row + x, _mm_or_ps(_mm_and_ps(inside, closer), _mm_andnot_ps(inside, old)));
+            }
+
+            edge0 = _mm_add_ps(edge0, edgeStep0);
+            edge1 = _mm_add_ps(edge1, edgeStep1);
+            edge2 = _mm_add_ps(edge2, edgeStep2);
+            depth = _mm_add_ps(depth, depthStep);
+        }
+    }
+}
+
+static void RasterizeTilesJob(void* data, int start, int end) {
+    OcclusionBuffer* buffer = (OcclusionBuffer*) data;
+    int tilesX = buffer->width / OCCLUSION_TILE_WIDTH;
+
+    for(int tile = start; tile < end; tile++) {
+        int tileMinX = (tile % tilesX) * OCCLUSION_TILE_WIDTH;
+        int tileMinY = (tile / tilesX) * OCCLUSION_TILE_HEIGHT;
+        int tileMaxX = tileMinX + OCCLUSION_TILE_WIDTH - 1;
+        int tileMaxY = tileMinY + OCCLUSION_TILE_HEIGHT - 1;
+
+        for(int y = tileMinY; y <= tileMaxY; y++) {
+            float* row = buffer->depth + y * buffer->width + tileMinX;
+            for(int x = 0; x < OCCLUSION_TILE_WIDTH; x++) {
+                row[x] = 1.0f;
+            }
+        }
+
+        // Every tile walks all triangles, bounds rejection is cheap compared to rasterization
+        for(int i = 0; i < buffer->trianglesCount; i++) {
+            RasterizeTriangleInTile(buffer, buffer->triangles + i, tileMinX, tileMinY, tileMaxX, tileMaxY);
+        }
+
+        // Hierarchical depth, the farthest depth of every block
+        int blocksX = buffer->width / OCCLUSION_BLOCK_SIZE;
+        for(int by = tileMinY / OCCLUSION_BLOCK_SIZE; by <= tileMaxY / OCCLUSION_BLOCK_SIZE; by++)
+        for(int bx = tileMinX / OCCLUSION_BLOCK_SIZE; bx <= tileMaxX / OCCLUSION_BLOCK_SIZE; bx++) {
+            __m128 blockMax = _mm_set1_ps(-FLT_MAX);
+
+            for(int y = 0; y < OCCLUSION_BLOCK_SIZE; y++) {
+                float* row = buffer->depth + (by * OCCLUSION_BLOCK_SIZE + y) * buffer->width + bx * OCCLUSION_BLOCK_SIZE;
+                for(int x = 0; x < OCCLUSION_BLOCK_SIZE; x += 4) {
+                    blockMax = _mm_max_ps(blockMax, _mm_loadu_ps(row + x));
+                }
+            }
+
+            float lanes[4];
+            _mm_storeu_ps(lanes, blockMax);
+            buffer->blockMaxDepth[by * blocksX + bx] = fmaxf(fmaxf(lanes[0], lanes[1]), fmaxf(lanes[2], lanes[3]));
+        }
+    }
+}
+
+void RasterizeOccluders(SRWindow* window, OcclusionBuffer* buffer) {
+    double start = glfwGetTime();
+
+    int tilesCount = (buffer->width / OCCLUSION_TILE_WIDTH) * (buffer->height / OCCLUSION_TILE_HEIGHT);
+    ParallelFor(tilesCount, 1, RasterizeTilesJob, buffer);
+
+    OcclusionStats* stats = &window->frameTimeData.occlusion;
+    stats->occluderTriangles += buffer->trianglesCount;
+    stats->rasterizeTime += (float) (glfwGetTime() - start);
+}
+
+bool IsBoxVisible(OcclusionBuffer* buffer, BoundingBox box, Matrix transform) {
+    Matrix mvp = buffer->vp * transform;
+
+    float minX = FLT_MAX, minY = FLT_MAX, minZ = FLT_MAX;
+    float maxX = -FLT_MAX, maxY = -FLT_MAX;
+
+    for(int i = 0; i < 8; i++) {
+        Vector3 corner = {i & 1 ? box.max.x : box.min.x,
+                          i & 2 ? box.max.y : box.min.y,
+                          i & 4 ? box.max.z : box.min.z};
+
+        Vector4 clip = TransformClip(mvp, corner);
+
+        // Box crosses the near plane, it can't be occluded
+        if(clip.w < OCCLUSION_NEAR_W) {
+            return true;
+        }
+
+        float inverseW = 1.0f / clip.w;
+        float x = (clip.x * inverseW * 0.5f + 0.5f) * buffer->width;
+        float y = (clip.y * inverseW * 0.5f + 0.5f) * buffer->height;
+
+        minX = fminf(minX, x);
+        minY = fminf(minY, y);
+        maxX = fmaxf(maxX, x);
+        maxY = fmaxf(maxY, y);
+        minZ = fminf(minZ, clip.z * inverseW);
+    }
+
+    // Outside of the screen, frustum culling should have removed it already
+    if(maxX < 0 || maxY < 0 || minX >= buffer->width || minY >= buffer->height) {
+        return false;
+    }
+
+    int x0 = (int) fmaxf(floorf(minX), 0);
+    int y0 = (int) fmaxf(floorf(minY), 0);
+    int x1 = (int) fminf(ceilf(maxX), buffer->width - 1.0f);
+    int y1 = (int) fminf(ceilf(maxY), buffer->height - 1.0f);
+
+    int blocksX = buffer->width / OCCLUSION_BLOCK_SIZE;
+
+    for(int by = y0 / OCCLUSION_BLOCK_SIZE; by <= y1 / OCCLUSION_BLOCK_SIZE; by++)
+    for(int bx = x0 / OCCLUSION_BLOCK_SIZE; bx <= x1 / OCCLUSION_BLOCK_SIZE; bx++) {
+        if(minZ > buffer->blockMaxDepth[by * blocksX + bx]) {
+            // Whole block is in front of the box
+            continue;
+        }
+
+        int startX = bx * OCCLUSION_BLOCK_SIZE > x0 ? bx * OCCLUSION_BLOCK_SIZE : x0;
+        int startY = by * OCCLUSION_BLOCK_SIZE > y0 ? by * OCCLUSION_BLOCK_SIZE : y0;
+        int endX = (bx + 1) * OCCLUSION_BLOCK_SIZE - 1 < x1 ? (bx + 1) * OCCLUSION_BLOCK_SIZE - 1 : x1;
+        int endY = (by + 1) * OCCLUSION_BLOCK_SIZE - 1 < y1 ? (by + 1) * OCCLUSION_BLOCK_SIZE - 1 : y1;
+
+        for(int y = startY; y <= endY; y++)
+        for(int x = startX; x <= endX; x++) {
+            if(minZ <= buffer->depth[y * buffer->width + x]) {
+                return true;
+            }
+        }
+    }
+
+    return false;
+}
+
+int CullOccluded(SRWindow* window, OcclusionBuffer* buffer, Slice<BoundingBox> worldBounds, int32_t* indices, int count) {
+    double start = glfwGetTime();
+
+    int visibleCount = 0;
+    for(int i = 0; i < count; i++) {
+        int32_t index = indices[i];
+        if(IsBoxVisible(buffer, worldBounds[index], MatrixIdentity())) {
+            indices[visibleCount++] = index;
+        }
+    }
+
+    OcclusionStats* stats = &window->frameTimeData.occlusion;
+    stats->tested += count;
+    stats->culled += count - visibleCount;
+    stats->testTime += (float) (glfwGetTime() - start);
+
+    return visibleCount;
+}
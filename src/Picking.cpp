@@ -0,0 +1,256 @@
+#include "SimpleRenderer.h"
+
+#include <float.h>
+#include <xmmintrin.h> // SSE
+
+//========================================
+// Picking
+//========================================
+
+#define PICKING_EPSILON 1e-8f
+
+static Vector4 TransformPoint4(Matrix m, Vector4 v) {
+    Vector4 ret;
+    ret.x = m.m00 * v.x + m.m10 * v.y + m.m20 * v.z + m.m30 * v.w;
+    ret.y = m.m01 * v.x + m.m11 * v.y + m.m21 * v.z + m.m31 * v.w;
+    ret.z = m.m02 * v.x + m.m12 * v.y + m.m22 * v.z + m.m32 * v.w;
+    ret.w = m.m03 * v.x + m.m13 * v.y + m.m23 * v.z + m.m33 * v.w;
+    return ret;
+}
+
+static Vector3 TransformDirection(Matrix m, Vector3 v) {
+    return {m.m00 * v.x + m.m10 * v.y + m.m20 * v.z,
+            m.m01 * v.x + m.m11 * v.y + m.m21 * v.z,
+            m.m02 * v.x + m.m12 * v.y + m.m22 * v.z};
+}
+
+Ray GetScreenRay(Camera* camera, Vector2 screenPosition) {
+    Matrix inverseVP = MatrixInvert(GetVPMatrix(camera));
+
+    float x = screenPosition.x * 2.0f - 1.0f;
+    float y = 1.0f - screenPosition.y * 2.0f;
+
+    Vector4 nearPoint = TransformPoint4(inverseVP, {x, y, -1, 1});
+    Vector4 farPoint  = TransformPoint4(inverseVP, {x, y,  1, 1});
+
+    Vector3 origin = Vector3{nearPoint.x, nearPoint.y, nearPoint.z} * (1.0f / nearPoint.w);
+    Vector3 target = Vector3{farPoint.x, farPoint.y, farPoint.z} * (1.0f / farPoint.w);
+
+    Ray ray = {};
+    ray.origin = origin;
+    ray.direction = Vector3Normalize(target - origin);
+    return ray;
+}
+
+Ray GetMouseRay(SRWindow* window, Camera* camera) {
+    return GetScreenRay(camera, window->mousePos);
+}
+
+static float IntersectRayNode(BoundingBox box, Vector3 origin, Vector3 inverseDirection, float maxDistance) {
+    Vector3 t1 = Vector3Multiply(box.min - origin, inverseDirection);
+    Vector3 t2 = Vector3Multiply(box.max - origin, inverseDirection);
+
+    float tmin = fmaxf(fmaxf(fminf(t1.x, t2.x), fminf(t1.y, t2.y)), fminf(t1.z, t2.z));
+    float tmax = fminf(fminf(fmaxf(t1.x, t2.x), fmaxf(t1.y, t2.y)), fmaxf(t1.z, t2.z));
+
+    if(tmax < fmaxf(tmin, 0) || tmin > maxDistance) {
+        return FLT_MAX;
+    }
+
+    return fmaxf(tmin, 0);
+}
+
+MeshPickData* BuildMeshPickData(Mesh* mesh, MemoryArena* arena, MemoryArena* tempArena) {
+    assert(mesh->vertices.length > 0 && mesh->triangles.length > 0);
+
+    int trianglesCount = (int) (mesh->triangles.length / 3);
+    uint64_t tempPos = GetArenaPos(tempArena);
+
+    Slice<BoundingBox> bounds = PushSliceToArena<BoundingBox>(tempArena, trianglesCount);
+    for(int t = 0; t < trianglesCount; t++) {
+        Vector3 a = mesh->vertices[mesh->triangles[t * 3 + 0]];
+        Vector3 b = mesh->vertices[mesh->triangles[t * 3 + 1]];
+        Vector3 c = mesh->vertices[mesh->triangles[t * 3 + 2]];
+
+        bounds[t] = {Vector3Min(a, Vector3Min(b, c)), Vector3Max(a, Vector3Max(b, c))};
+    }
+
+    MeshPickData* data = (MeshPickData*) PushArena(arena, sizeof(MeshPickData));
+    data->bvh = BuildBvh(bounds, arena, tempArena);
+
+    // @NOTE: with a single arena the results are above the bounds, popping would zero them.
+    // Bounds stay in the arena then.
+    if(arena != tempArena) {
+        PopArenaTo(tempArena, tempPos);
+    }
+
+    // Groups of 4 can start at any triangle, so 3 padding triangles are added.
+    // They are zeroed by the arena, degenerate and never hit.
+    int paddedCount = trianglesCount + 3;
+    for(int i = 0; i < 3; i++) {
+        data->vertex[i] = (float*) PushArena(arena, paddedCount * sizeof(float));
+        data->edge1[i]  = (float*) PushArena(arena, paddedCount * sizeof(float));
+        data->edge2[i]  = (float*) PushArena(arena, paddedCount * sizeof(float));
+    }
+
+    for(int i = 0; i < trianglesCount; i++) {
+        int t = data->bvh.objectIndices[i];
+
+        Vector3 a = mesh->vertices[mesh->triangles[t * 3 + 0]];
+        Vector3 e1 = mesh->vertices[mesh->triangles[t * 3 + 1]] - a;
+        Vector3 e2 = mesh->vertices[mesh->triangles[t * 3 + 2]] - a;
+
+        data->vertex[0][i] = a.x;  data->vertex[1][i] = a.y;  data->vertex[2][i] = a.z;
+        data->edge1[0][i]  = e1.x; data->edge1[1][i]  = e1.y; data->edge1[2][i]  = e1.z;
+        data->edge2[0][i]  = e2.x; data->edge2[1][i]  = e2.y; data->edge2[2][i]  = e2.z;
+    }
+
+    return data;
+}
+
+// Moller-Trumbore for 4 triangles starting at index, both sides are hit.
+// Returns lane mask of hits closer than closest.
+static int IntersectRayTriangles4(MeshPickData* data, int index, __m128 origin[3], __m128 direction[3],
+                                  float closest, __m128* t, __m128* u, __m128* v)
+{
+    __m128 e1x = _mm_loadu_ps(data->edge1[0] + index);
+    __m128 e1y = _mm_loadu_ps(data->edge1[1] + index);
+    __m128 e1z = _mm_loadu_ps(data->edge1[2] + index);
+    __m128 e2x = _mm_loadu_ps(data->edge2[0] + index);
+    __m128 e2y = _mm_loadu_ps(data->edge2[1] + index);
+    __m128 e2z = _mm_loadu_ps(data->edge2[2] + index);
+
+    // p = direction x e2
+    __m128 px = _mm_sub_ps(_mm_mul_ps(direction[1], e2z), _mm_mul_ps(direction[2], e2y));
+    __m128 py = _mm_sub_ps(_mm_mul_ps(direction[2], e2x), _mm_mul_ps(direction[0], e2z));
+    __m128 pz = _mm_sub_ps(_mm_mul_ps(direction[0], e2y), _mm_mul_ps(direction[1], e2x));
+
+    __m128 det = _mm_add_ps(_mm_add_ps(_mm_mul_ps(e1x, px), _mm_mul_ps(e1y, py)), _mm_mul_ps(e1z, pz));
+    __m128 absDet = _mm_andnot_ps(_mm_set1_ps(-0.0f), det);
+    __m128 valid = _mm_cmpgt_ps(absDet, _mm_set1_ps(PICKING_EPSILON));
+
+    __m128 inverseDet = _mm_div_ps(_mm_set1_ps(1.0f), det);
+
+    // s = origin - vertex
+    __m128 sx = _mm_sub_ps(origin[0], _mm_loadu_ps(data->vertex[0] + index));
+    __m128 sy = _mm_sub_ps(origin[1], _mm_loadu_ps(data->vertex[1] + index));
+    __m128 sz = _mm_sub_ps(origin[2], _mm_loadu_ps(data->vertex[2] + index));
+
+    *u = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(sx, px), _mm_mul_ps(sy, py)), _mm_mul_ps(sz, pz)), inverseDet);
+
+    // q = s x e1
+    __m128 qx = _mm_sub_ps(_mm_mul_ps(sy, e1z), _mm_mul_ps(sz, e1y));
+    __m128 qy = _mm_sub_ps(_mm_mul_ps(sz, e1x), _mm_mul_ps(sx, e1z));
+    __m128 qz = _mm_sub_ps(_mm_mul_ps(sx, e1y), _mm_mul_ps(sy, e1x));
+
+    *v = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(direction[0], qx), _mm_mul_ps(direction[1], qy)), _mm_mul_ps(direction[2], qz)), inverseDet);
+    *t = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(e2x, qx), _mm_mul_ps(e2y, qy)), _mm_mul_ps(e2z, qz)), inverseDet);
+
+    __m128 zero = _mm_setzero_ps();
+    valid = _mm_and_ps(valid, _mm_cmpge_ps(*u, zero));
+    valid = _mm_and_ps(valid, _mm_cmpge_ps(*v, zero));
+    valid = _mm_and_ps(valid, _mm_cmple_ps(_mm_add_ps(*u, *v), _mm_set1_ps(1.0f)));
+    valid = _mm_and_ps(valid, _mm_cmpge_ps(*t, zero));
+    valid = _mm_and_ps(valid, _mm_cmplt_ps(*t, _mm_set1_ps(closest)));
+
+    return _mm_movemask_ps(valid);
+}
+
+bool PickMesh(Mesh* mesh, Matrix transform, Ray ray, MemoryArena* arena, MemoryArena* tempArena, MeshHit* hit) {
+    assert(hit);
+
+    if(mesh->pickData == NULL) {
+        // Meshes without CPU data (loaded from the cache) can't be picked
+        if(mesh->vertices.length == 0 || mesh->triangles.length == 0) {
+            return false;
+        }
+
+        mesh->pickData = BuildMeshPickData(mesh, arena, tempArena);
+    }
+
+    MeshPickData* data = mesh->pickData;
+    Bvh* bvh = &data->bvh;
+
+    // Ray is moved to the mesh space. Direction isn't normalized again,
+    // so hit distance is the same in both spaces.
+    Matrix inverse = MatrixInvert(transform);
+    Vector4 localOrigin = TransformPoint4(inverse, {ray.origin.x, ray.origin.y, ray.origin.z, 1});
+    Vector3 origin = {localOrigin.x, localOrigin.y, localOrigin.z};
+    Vector3 direction = TransformDirection(inverse, ray.direction);
+    Vector3 inverseDirection = GetRayInverseDirection(direction);
+
+    __m128 originSimd[3]    = {_mm_set1_ps(origin.x), _mm_set1_ps(origin.y), _mm_set1_ps(origin.z)};
+    __m128 directionSimd[3] = {_mm_set1_ps(direction.x), _mm_set1_ps(direction.y), _mm_set1_ps(direction.z)};
+
+    int stack[BVH_STACK_SIZE];
+    int stackSize = 0;
+    stack[stackSize++] = 0;
+
+    float closest = FLT_MAX;
+    int closestIndex = -1;
+    float closestU = 0;
+    float closestV = 0;
+
+    while(stackSize > 0) {
+        BvhNode* node = bvh->nodes + stack[--stackSize];
+
+        if(IntersectRayNode(node->bounds, origin, inverseDirection, closest) == FLT_MAX) {
+            continue;
+        }
+
+        if(node->leftChild == 0) {
+            // @NOTE: last group can reach triangles of the next leaf, those are real
+            // triangles so their hits are valid too
+            for(int i = node->first; i < node->first + node->count; i += 4) {
+                __m128 t, u, v;
+                int mask = IntersectRayTriangles4(data, i, originSimd, directionSimd, closest, &t, &u, &v);
+                if(mask == 0) {
+                    continue;
+                }
+
+                float ts[4], us[4], vs[4];
+                _mm_storeu_ps(ts, t);
+                _mm_storeu_ps(us, u);
+                _mm_storeu_ps(vs, v);
+
+                for(int lane = 0; lane < 4; lane++) {
+                    if((mask & (1 << lane)) && ts[lane] < closest) {
+                        closest = ts[lane];
+                        closestIndex = i + lane;
+                        closestU = us[lane];
+                        closestV = vs[lane];
+                    }
+                }
+            }
+
+            continue;
+        }
+
+        BvhNode* left = bvh->nodes + node->leftChild;
+        float leftDistance  = IntersectRayNode(left->bounds, origin, inverseDirection, closest);
+        float rightDistance = IntersectRayNode((left + 1)->bounds, origin, inverseDirection, closest);
+
+        // Nearer child is pushed last, so it's visited first
+        int nearChild = rightDistance < leftDistance ? node->leftChild + 1 : node->leftChild;
+        int farChild  = rightDistance < leftDistance ? node->leftChild : node->leftChild + 1;
+
+        assert(stackSize + 2 <= BVH_STACK_SIZE);
+        if(fmaxf(leftDistance, rightDistance) != FLT_MAX) {
+            stack[stackSize++] = farChild;
+        }
+        if(fminf(leftDistance, rightDistance) != FLT_MAX) {
+            stack[stackSize++] = nearChild;
+        }
+    }
+
+    if(closestIndex == -1) {
+        return false;
+    }
+
+    hit->distance     = closest;
+    hit->triangle     = bvh->objectIndices[closestIndex];
+    hit->barycentrics = {1.0f - closestU - closestV, closestU, closestV};
+    hit->point        = ray.origin + ray.direction * closest;
+
+    return true;
+}
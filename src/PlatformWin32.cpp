@@ -3,6 +3,7 @@
 #include <windows.h>
 
 #include <inttypes.h>
+#include <assert.h>
 
 uint64_t Win32_GetLastWriteTime(const char* filePath) {
     uint64_t ret = 0;
@@ -21,4 +22,225 @@ uint64_t Win32_GetLastWriteTime(const char* filePath) {
 bool Win32_FileHasChanged(FileData fileData) {
     uint64_t currentModifyTime = Win32_GetLastWriteTime(fileData.path.str);
     return fileData.changeTime < currentModifyTime;
-}
\ No newline at end of file
+}
+
+MappedFile Win32_MapFile(const char* filePath) {
+    MappedFile ret = {};
+
+    HANDLE file = CreateFile(filePath, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING,
+                             FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+    if(file == INVALID_HANDLE_VALUE) {
+        return ret;
+    }
+
+    LARGE_INTEGER size;
+    if(GetFileSizeEx(file, &size) == false || size.QuadPart == 0) {
+        CloseHandle(file);
+        return ret;
+    }
+
+    HANDLE mapping = CreateFileMapping(file, NULL, PAGE_READONLY, 0, 0, NULL);
+    if(mapping == NULL) {
+        CloseHandle(file);
+        return ret;
+    }
+
+    void* data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    if(data == NULL) {
+        CloseHandle(mapping);
+        CloseHandle(file);
+        return ret;
+    }
+
+    ret.data          = data;
+    ret.size          = (uint64_t) size.QuadPart;
+    ret.fileHandle    = file;
+    ret.mappingHandle = mapping;
+
+    return ret;
+}
+
+void Win32_UnmapFile(MappedFile* file) {
+    if(file->data) {
+        UnmapViewOfFile(file->data);
+        CloseHandle(file->mappingHandle);
+        CloseHandle(file->fileHandle);
+    }
+
+    *file = {};
+}
+
+bool Win32_CreateDirectory(const char* path) {
+    return CreateDirectory(path, NULL) || GetLastError() == ERROR_ALREADY_EXISTS;
+}
+
+//========================================
+// Threading
+//========================================
+
+#define MAX_PARALLEL_FOR_THREADS 64
+
+struct Win32_ParallelForJob {
+    ParallelForFunction function;
+    void* data;
+
+    int start;
+    int end;
+};
+
+DWORD WINAPI Win32_ParallelForThread(LPVOID param) {
+    Win32_ParallelForJob* job = (Win32_ParallelForJob*) param;
+    job->function(job->data, job->start, job->end);
+
+    return 0;
+}
+
+int GetProcessorCount() {
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+
+    return (int) info.dwNumberOfProcessors;
+}
+
+// @NOTE: threads are created for every call. It is fine for heavy, import time work,
+// but shouldn't be used for small per frame tasks.
+void ParallelFor(int count, int minBatchSize, ParallelForFunction function, void* data) {
+    assert(minBatchSize > 0);
+
+    int threadsCount = GetProcessorCount();
+    if(threadsCount > MAX_PARALLEL_FOR_THREADS) {
+        threadsCount = MAX_PARALLEL_FOR_THREADS;
+    }
+
+    int batches = (count + minBatchSize - 1) / minBatchSize;
+    if(batches > threadsCount) {
+        batches = threadsCount;
+    }
+
+    if(batches <= 1) {
+        function(data, 0, count);
+        return;
+    }
+
+    Win32_ParallelForJob jobs[MAX_PARALLEL_FOR_THREADS];
+    HANDLE threads[MAX_PARALLEL_FOR_THREADS];
+
+    int batchSize = (count + batches - 1) / batches;
+    for(int i = 0; i < batches; i++) {
+        jobs[i].function = function;
+        jobs[i].data     = data;
+        jobs[i].start    = i * batchSize;
+        jobs[i].end      = (i + 1) * batchSize < count ? (i + 1) * batchSize : count;
+    }
+
+    // First batch is executed on the calling thread
+    for(int i = 1; i < batches; i++) {
+        threads[i - 1] = CreateThread(NULL, 0, Win32_ParallelForThread, jobs + i, 0, NULL);
+        assert(threads[i - 1]);
+    }
+
+    Win32_ParallelForThread(jobs);
+
+    WaitForMultipleObjects(batches - 1, threads, TRUE, INFINITE);
+    for(int i = 0; i < batches - 1; i++) {
+        CloseHandle(threads[i]);
+    }
+}
+
+//========================================
+// Work queue
+//========================================
+
+#define MAX_WORK_QUEUE_THREADS 16
+
+struct Win32_WorkQueueEntry {
+    WorkFunction function;
+    void* data;
+
+    // Set by the pushing thread, cleared by the worker after copying the entry,
+    // so a slot is reused only when its previous entry was read
+    volatile LONG isFull;
+};
+
+struct WorkQueue {
+    Win32_WorkQueueEntry entries[WORK_QUEUE_CAPACITY];
+
+    // Written only by the pushing thread
+    volatile LONG writeIndex;
+    // Incremented by workers taking entries
+    volatile LONG readIndex;
+
+    HANDLE semaphore;
+    HANDLE threads[MAX_WORK_QUEUE_THREADS];
+    int threadsCount;
+};
+
+DWORD WINAPI Win32_WorkQueueThread(LPVOID param) {
+    WorkQueue* queue = (WorkQueue*) param;
+
+    for(;;) {
+        // Semaphore count is the number of entries not taken yet
+        WaitForSingleObject(queue->semaphore, INFINITE);
+
+        LONG index = InterlockedIncrement(&queue->readIndex) - 1;
+        Win32_WorkQueueEntry* slot = queue->entries + index % WORK_QUEUE_CAPACITY;
+
+        WorkFunction function = slot->function;
+        void* data = slot->data;
+
+        // Interlocked write is a full barrier, the entry is read before the slot is released
+        InterlockedExchange(&slot->isFull, 0);
+
+        function(data);
+    }
+}
+
+WorkQueue* CreateWorkQueue(int threadsCount, MemoryArena* arena) {
+    assert(threadsCount > 0);
+    if(threadsCount > MAX_WORK_QUEUE_THREADS) {
+        threadsCount = MAX_WORK_QUEUE_THREADS;
+    }
+
+    WorkQueue* queue = (WorkQueue*) PushArena(arena, sizeof(WorkQueue));
+
+    queue->semaphore = CreateSemaphoreA(NULL, 0, WORK_QUEUE_CAPACITY, NULL);
+    assert(queue->semaphore);
+
+    // @NOTE: threads live until the process exits
+    queue->threadsCount = threadsCount;
+    for(int i = 0; i < threadsCount; i++) {
+        queue->threads[i] = CreateThread(NULL, 0, Win32_WorkQueueThread, queue, 0, NULL);
+        assert(queue->threads[i]);
+    }
+
+    return queue;
+}
+
+bool PushWork(WorkQueue* queue, WorkFunction function, void* data) {
+    LONG writeIndex = queue->writeIndex;
+    Win32_WorkQueueEntry* slot = queue->entries + writeIndex % WORK_QUEUE_CAPACITY;
+
+    // @NOTE: slot can be taken by a worker which didn't copy it yet, so the free space
+    // can't be computed from the indices
+    if(InterlockedCompareExchange(&slot->isFull, 0, 0) != 0) {
+        return false;
+    }
+
+    slot->function = function;
+    slot->data = data;
+    InterlockedExchange(&slot->isFull, 1);
+
+    // Interlocked write is a full barrier, the entry is visible before the semaphore is released
+    InterlockedExchange(&queue->writeIndex, writeIndex + 1);
+    ReleaseSemaphore(queue->semaphore, 1, NULL);
+
+    return true;
+}
+
+int32_t AtomicLoad(volatile int32_t* value) {
+    return (int32_t) InterlockedCompareExchange((volatile LONG*) value, 0, 0);
+}
+
+void AtomicStore(volatile int32_t* value, int32_t newValue) {
+    InterlockedExchange((volatile LONG*) value, (LONG) newValue);
+}
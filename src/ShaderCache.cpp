@@ -0,0 +1,191 @@
+#include "SimpleRenderer.h"
+
+#include <stdio.h>
+#include <string.h>
+
+//========================================
+// Shader cache
+//========================================
+
+// One file per program, named after the cache key:
+//   ShaderCacheHeader
+//   program binary, in the driver specific format
+
+#define SHADER_CACHE_MAGIC   0x52444853 // "SHDR"
+#define SHADER_CACHE_VERSION 1
+
+struct ShaderCacheHeader {
+    uint32_t magic;
+    uint32_t version;
+
+    uint64_t key;
+
+    uint32_t binaryFormat;
+    uint32_t binarySize;
+
+    // Compile and link time of the program, reported as saved when the binary is used
+    double compileTime;
+};
+
+// Empty when the cache is disabled
+static char ShaderCacheDirectory[256];
+// Binaries are valid only for the driver that created them
+static uint64_t ShaderCacheDriverHash;
+
+static ShaderCacheStats ShaderCacheStatistics;
+
+bool EnableShaderCache(const char* directory) {
+    ShaderCacheDirectory[0] = '\0';
+
+    GLint formatsCount = 0;
+    glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formatsCount);
+    if(formatsCount == 0) {
+        return false;
+    }
+
+    if(Win32_CreateDirectory(directory) == false) {
+        fprintf(stderr, "[Error] Can't create shader cache directory: %s\n", directory);
+        return false;
+    }
+
+    snprintf(ShaderCacheDirectory, sizeof(ShaderCacheDirectory), "%s", directory);
+
+    GLenum names[] = {GL_VENDOR, GL_RENDERER, GL_VERSION};
+
+    ShaderCacheDriverHash = 14695981039346656037ull;
+    for(int i = 0; i < 3; i++) {
+        const char* string = (const char*) glGetString(names[i]);
+        if(string) {
+            ShaderCacheDriverHash = (ShaderCacheDriverHash ^ HashBytes((void*) string, strlen(string))) * 1099511628211ull;
+        }
+    }
+
+    return true;
+}
+
+uint64_t GetShaderCacheKey(const char* vertexSource, const char* fragmentSource) {
+    uint64_t key = ShaderCacheDriverHash;
+    key = (key ^ HashBytes((void*) vertexSource, strlen(vertexSource))) * 1099511628211ull;
+    key = (key ^ HashBytes((void*) fragmentSource, strlen(fragmentSource))) * 1099511628211ull;
+
+    return key;
+}
+
+static void GetShaderCachePath(uint64_t key, char* path, int size) {
+    snprintf(path, size, "%s/%016llx.bin", ShaderCacheDirectory, (unsigned long long) key);
+}
+
+uint32_t LoadCachedProgram(uint64_t key) {
+    if(ShaderCacheDirectory[0] == '\0') {
+        return 0;
+    }
+
+    double start = glfwGetTime();
+
+    char path[512];
+    GetShaderCachePath(key, path, sizeof(path));
+
+    MappedFile file = Win32_MapFile(path);
+    if(file.data == NULL) {
+        return 0;
+    }
+
+    uint8_t* data = (uint8_t*) file.data;
+
+    ShaderCacheHeader header = {};
+    if(file.size >= sizeof(ShaderCacheHeader)) {
+        memcpy(&header, data, sizeof(ShaderCacheHeader));
+    }
+
+    bool valid = header.magic == SHADER_CACHE_MAGIC &&
+                 header.version == SHADER_CACHE_VERSION &&
+                 header.key == key &&
+                 sizeof(ShaderCacheHeader) + (uint64_t) header.binarySize <= file.size;
+
+    GLuint program = 0;
+
+    if(valid) {
+        program = glCreateProgram();
+        glProgramBinary(program, header.binaryFormat, data + sizeof(ShaderCacheHeader), header.binarySize);
+
+        // Driver can reject the binary even if it matches, e.g. after some internal change
+        GLint success = 0;
+        glGetProgramiv(program, GL_LINK_STATUS, &success);
+        if(success == 0) {
+            glDeleteProgram(program);
+            program = 0;
+        }
+    }
+
+    Win32_UnmapFile(&file);
+
+    if(program) {
+        double loadTime = glfwGetTime() - start;
+
+        ShaderCacheStatistics.hits++;
+        ShaderCacheStatistics.loadTime += loadTime;
+        ShaderCacheStatistics.savedTime += header.compileTime - loadTime;
+    }
+
+    return program;
+}
+
+void CacheProgram(uint64_t key, uint32_t program, double compileTime) {
+    ShaderCacheStatistics.misses++;
+    ShaderCacheStatistics.compileTime += compileTime;
+
+    if(ShaderCacheDirectory[0] == '\0') {
+        return;
+    }
+
+    GLint binarySize = 0;
+    glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &binarySize);
+    if(binarySize <= 0) {
+        return;
+    }
+
+    uint64_t fileSize = sizeof(ShaderCacheHeader) + binarySize;
+    uint8_t* fileData = (uint8_t*) malloc(fileSize);
+    assert(fileData);
+
+    ShaderCacheHeader header = {};
+    header.magic       = SHADER_CACHE_MAGIC;
+    header.version     = SHADER_CACHE_VERSION;
+    header.key         = key;
+    header.compileTime = compileTime;
+
+    GLenum binaryFormat = 0;
+    GLsizei written = 0;
+    glGetProgramBinary(program, binarySize, &written, &binaryFormat, fileData + sizeof(ShaderCacheHeader));
+    if(written <= 0) {
+        free(fileData);
+        return;
+    }
+
+    header.binaryFormat = binaryFormat;
+    header.binarySize   = (uint32_t) written;
+    memcpy(fileData, &header, sizeof(header));
+
+    char path[512];
+    GetShaderCachePath(key, path, sizeof(path));
+
+    bool saved = false;
+
+    FILE* file;
+    errno_t err = fopen_s(&file, path, "wb");
+    if(err == 0) {
+        uint64_t size = sizeof(ShaderCacheHeader) + written;
+        saved = fwrite(fileData, 1, size, file) == size;
+        fclose(file);
+    }
+
+    if(saved == false) {
+        fprintf(stderr, "[Error] Can't write shader cache at path: %s\n", path);
+    }
+
+    free(fileData);
+}
+
+ShaderCacheStats GetShaderCacheStats() {
+    return ShaderCacheStatistics;
+}
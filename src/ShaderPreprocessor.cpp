@@ -0,0 +1,362 @@
+#include "SimpleRenderer.h"
+
+#include <stdio.h>
+#include <string.h>
+
+//========================================
+// Shader preprocessor
+//========================================
+
+// Output is written with consecutive pushes, so it stays contiguous in the arena.
+// Nothing else can be pushed to the arena while the shader is preprocessed.
+
+struct ShaderInclude {
+    const char* name;
+    const char* source;
+};
+
+static ShaderInclude ShaderIncludes[SHADER_MAX_INCLUDES];
+static int ShaderIncludesCount;
+
+struct ShaderPreprocessState {
+    MemoryArena* arena;
+
+    const char** defines;
+    int definesCount;
+
+    // Every file is included once
+    char included[SHADER_MAX_INCLUDES][SHADER_MAX_INCLUDE_NAME];
+    int includedCount;
+};
+
+void AddShaderInclude(const char* name, const char* source) {
+    for(int i = 0; i < ShaderIncludesCount; i++) {
+        if(strcmp(ShaderIncludes[i].name, name) == 0) {
+            ShaderIncludes[i].source = source;
+            return;
+        }
+    }
+
+    assert(ShaderIncludesCount < SHADER_MAX_INCLUDES);
+    ShaderIncludes[ShaderIncludesCount++] = {name, source};
+}
+
+static void AppendShaderText(MemoryArena* arena, const char* text, uint64_t length) {
+    char* destination = (char*) PushArena(arena, length);
+    memcpy(destination, text, length);
+}
+
+static void AppendShaderString(MemoryArena* arena, const char* text) {
+    AppendShaderText(arena, text, strlen(text));
+}
+
+// #line directive, so compile errors point to the right file and line
+static void AppendShaderLine(MemoryArena* arena, int line, int sourceIndex) {
+    char buffer[32];
+    int length = snprintf(buffer, sizeof(buffer), "#line %d %d\n", line, sourceIndex);
+    AppendShaderText(arena, buffer, length);
+}
+
+static void AppendShaderDefines(ShaderPreprocessState* state) {
+    for(int i = 0; i < state->definesCount; i++) {
+        AppendShaderString(state->arena, "#define ");
+        AppendShaderString(state->arena, state->defines[i]);
+        AppendShaderString(state->arena, " 1\n");
+    }
+}
+
+static bool StartsWithDirective(const char* line, const char* end, const char* directive) {
+    uint64_t length = strlen(directive);
+    return (uint64_t) (end - line) >= length && memcmp(line, directive, length) == 0;
+}
+
+// Line of the #version directive, skipping leading comments and whitespace.
+// Returns 0 if the source doesn't start with #version.
+static int FindVersionLine(const char* source, const char* end) {
+    int line = 1;
+    const char* c = source;
+
+    while(c < end) {
+        if(*c == '\n') {
+            line++;
+            c++;
+        }
+        else if(*c == ' ' || *c == '\t' || *c == '\r') {
+            c++;
+        }
+        else if(end - c >= 2 && c[0] == '/' && c[1] == '/') {
+            while(c < end && *c != '\n') {
+                c++;
+            }
+        }
+        else if(end - c >= 2 && c[0] == '/' && c[1] == '*') {
+            c += 2;
+            while(c < end && !(end - c >= 2 && c[0] == '*' && c[1] == '/')) {
+                line += *c == '\n';
+                c++;
+            }
+            c += 2;
+        }
+        else {
+            break;
+        }
+    }
+
+    return c < end && StartsWithDirective(c, end, "#version") ? line : 0;
+}
+
+static bool PreprocessShaderText(ShaderPreprocessState* state, const char* source, uint64_t length, int sourceIndex, int depth) {
+    if(depth > SHADER_MAX_INCLUDE_DEPTH) {
+        fprintf(stderr, "[Error] Shader includes nested too deep\n");
+        return false;
+    }
+
+    const char* end = source + length;
+    const char* lineStart = source;
+    int lineNumber = 1;
+
+    // Defines have to be after #version, which can only be preceded by comments
+    int versionLine = depth == 0 ? FindVersionLine(source, end) : 0;
+
+    if(depth == 0 && versionLine == 0) {
+        AppendShaderDefines(state);
+        AppendShaderLine(state->arena, 1, sourceIndex);
+    }
+
+    while(lineStart < end) {
+        const char* lineEnd = (const char*) memchr(lineStart, '\n', end - lineStart);
+        lineEnd = lineEnd ? lineEnd + 1 : end;
+
+        const char* directive = lineStart;
+        while(directive < lineEnd && (*directive == ' ' || *directive == '\t')) {
+            directive++;
+        }
+
+        if(lineNumber == versionLine) {
+            AppendShaderText(state->arena, lineStart, lineEnd - lineStart);
+            if(lineEnd == end || lineEnd[-1] != '\n') {
+                AppendShaderString(state->arena, "\n");
+            }
+
+            AppendShaderDefines(state);
+            AppendShaderLine(state->arena, lineNumber + 1, sourceIndex);
+        }
+        else if(StartsWithDirective(directive, lineEnd, "#include")) {
+            const char* nameStart = (const char*) memchr(directive, '"', lineEnd - directive);
+            const char* nameEnd = nameStart ? (const char*) memchr(nameStart + 1, '"', lineEnd - nameStart - 1) : NULL;
+
+            if(nameEnd == NULL) {
+                fprintf(stderr, "[Error] Invalid shader include: %.*s\n", (int) (lineEnd - lineStart), lineStart);
+                return false;
+            }
+
+            nameStart++;
+
+            char name[SHADER_MAX_INCLUDE_NAME];
+            snprintf(name, sizeof(name), "%.*s", (int) (nameEnd - nameStart), nameStart);
+
+            bool included = false;
+            for(int i = 0; i < state->includedCount; i++) {
+                if(strcmp(state->included[i], name) == 0) {
+                    included = true;
+                }
+            }
+
+            if(included == false) {
+                if(state->includedCount >= SHADER_MAX_INCLUDES) {
+                    fprintf(stderr, "[Error] Too many shader includes\n");
+                    return false;
+                }
+
+                int includeIndex = state->includedCount++;
+                memcpy(state->included[includeIndex], name, sizeof(name));
+
+                // Registered includes first, then files relative to the working directory
+                const char* includeSource = NULL;
+                for(int i = 0; i < ShaderIncludesCount; i++) {
+                    if(strcmp(ShaderIncludes[i].name, name) == 0) {
+                        includeSource = ShaderIncludes[i].source;
+                    }
+                }
+
+                MappedFile file = {};
+                uint64_t includeLength = 0;
+
+                if(includeSource) {
+                    includeLength = strlen(includeSource);
+                }
+                else {
+                    file = Win32_MapFile(name);
+                    includeSource = (const char*) file.data;
+                    includeLength = file.size;
+                }
+
+                if(includeSource == NULL) {
+                    fprintf(stderr, "[Error] Shader include not found: %s\n", name);
+                    return false;
+                }
+
+                AppendShaderLine(state->arena, 1, includeIndex + 1);
+                bool success = PreprocessShaderText(state, includeSource, includeLength, includeIndex + 1, depth + 1);
+
+                Win32_UnmapFile(&file);
+
+                if(success == false) {
+                    return false;
+                }
+
+                AppendShaderString(state->arena, "\n");
+            }
+
+            AppendShaderLine(state->arena, lineNumber + 1, sourceIndex);
+        }
+        else {
+            AppendShaderText(state->arena, lineStart, lineEnd - lineStart);
+        }
+
+        lineStart = lineEnd;
+        lineNumber++;
+    }
+
+    return true;
+}
+
+char* PreprocessShader(const char* source, const char** defines, int definesCount, MemoryArena* arena) {
+    uint64_t arenaPos = GetArenaPos(arena);
+
+    ShaderPreprocessState state = {};
+    state.arena = arena;
+    state.defines = defines;
+    state.definesCount = definesCount;
+
+    char* ret = (char*) PushArena(arena, 0);
+
+    if(PreprocessShaderText(&state, source, strlen(source), 0, 0) == false) {
+        PopArenaTo(arena, arenaPos);
+        return NULL;
+    }
+
+    AppendShaderText(arena, "", 1);
+    return ret;
+}
+
+//========================================
+// Shader permutations
+//========================================
+
+ShaderPermutations* CreateShaderPermutations(const char* vertexSource, const char* fragmentSource,
+                                             const char** keywords, int keywordsCount, MemoryArena* arena)
+{
+    assert(keywordsCount <= SHADER_MAX_KEYWORDS);
+
+    uint64_t arenaPos = GetArenaPos(arena);
+
+    // Includes are resolved once, variants only add their defines
+    char* vertex = PreprocessShader(vertexSource, NULL, 0, arena);
+    char* fragment = vertex ? PreprocessShader(fragmentSource, NULL, 0, arena) : NULL;
+
+    if(fragment == NULL) {
+        PopArenaTo(arena, arenaPos);
+        return NULL;
+    }
+
+    ShaderPermutations* permutations = (ShaderPermutations*) PushArena(arena, sizeof(ShaderPermutations));
+    permutations->vertexSource = vertex;
+    permutations->fragmentSource = fragment;
+    permutations->keywordsCount = keywordsCount;
+
+    for(int i = 0; i < keywordsCount; i++) {
+        permutations->keywords[i] = keywords[i];
+    }
+
+    return permutations;
+}
+
+uint32_t GetShaderKeyword(ShaderPermutations* permutations, const char* keyword) {
+    for(int i = 0; i < permutations->keywordsCount; i++) {
+        if(strcmp(permutations->keywords[i], keyword) == 0) {
+            return 1u << i;
+        }
+    }
+
+    assert(!"Unknown shader keyword");
+    return 0;
+}
+
+static ShaderVariant* FindShaderVariant(ShaderPermutations* permutations, uint32_t keywords) {
+    for(int i = 0; i < permutations->variantsCount; i++) {
+        if(permutations->variants[i].keywords == keywords) {
+            return permutations->variants + i;
+        }
+    }
+
+    return NULL;
+}
+
+static ShaderVariant* StartShaderVariant(ShaderPermutations* permutations, uint32_t keywords, MemoryArena* tempArena) {
+    ShaderVariant* variant = FindShaderVariant(permutations, keywords);
+    if(variant) {
+        return variant;
+    }
+
+    if(permutations->variantsCount >= SHADER_MAX_VARIANTS) {
+        assert(!"Too many shader variants");
+        return NULL;
+    }
+
+    const char* defines[SHADER_MAX_KEYWORDS];
+    int definesCount = 0;
+
+    for(int i = 0; i < permutations->keywordsCount; i++) {
+        if(keywords & (1u << i)) {
+            defines[definesCount++] = permutations->keywords[i];
+        }
+    }
+
+    variant = permutations->variants + permutations->variantsCount++;
+    variant->keywords = keywords;
+
+    uint64_t tempPos = GetArenaPos(tempArena);
+
+    char* vertex   = PreprocessShader(permutations->vertexSource, defines, definesCount, tempArena);
+    char* fragment = PreprocessShader(permutations->fragmentSource, defines, definesCount, tempArena);
+    assert(vertex && fragment);
+
+    // Sources are copied by the driver, they can be freed right away
+    variant->shader = LoadShaderSourceAsync(vertex, fragment);
+    variant->shader.permutations = permutations;
+    variant->shader.keywords = keywords;
+
+    PopArenaTo(tempArena, tempPos);
+    return variant;
+}
+
+void PrefetchShaderVariant(ShaderPermutations* permutations, uint32_t keywords, MemoryArena* tempArena) {
+    StartShaderVariant(permutations, keywords, tempArena);
+}
+
+Shader* GetShaderVariant(ShaderPermutations* permutations, uint32_t keywords, MemoryArena* tempArena) {
+    ShaderVariant* variant = StartShaderVariant(permutations, keywords, tempArena);
+    if(variant == NULL) {
+        return &ErrorShader;
+    }
+
+    FinishShader(&variant->shader);
+    return &variant->shader;
+}
+
+Shader GetShaderVariantHandle(ShaderPermutations* permutations, uint32_t keywords) {
+    Shader ret = {};
+    ret.permutations = permutations;
+    ret.keywords = keywords;
+
+    return ret;
+}
+
+void UnloadShaderPermutations(ShaderPermutations* permutations) {
+    for(int i = 0; i < permutations->variantsCount; i++) {
+        UnloadShader(&permutations->variants[i].shader);
+    }
+
+    permutations->variantsCount = 0;
+}
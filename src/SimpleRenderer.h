@@ -64,6 +64,27 @@ enum VertexBufferIndex {
     VertexNormalIndex   = 1,
     VertexUVIndex       = 2,
     VertexColorIndex    = 3,
+    VertexJointsIndex   = 4,
+    VertexWeightsIndex  = 5,
+
+    VertexAttributesCount
+};
+
+// Slots of the uniform table, power of 2
+#define SHADER_UNIFORM_SLOTS 64
+// Bytes for the names of the reflected uniforms
+#define SHADER_UNIFORM_NAMES_SIZE 1024
+
+struct ShaderPermutations;
+
+struct ShaderUniform {
+    // 0 marks empty slot
+    uint32_t nameHash;
+    int32_t location;
+
+    // Name in the uniformNames of the shader, compared on hash hits
+    uint16_t nameOffset;
+    uint16_t nameLength;
 };
 
 struct Shader
@@ -71,11 +92,40 @@ struct Shader
     bool isValid;
     uint32_t id;
 
+    // Active uniforms reflected in LoadShaderSource, open addressing on the name hash.
+    // When the table is incomplete (too many uniforms or names) missing names are
+    // queried from the driver.
+    ShaderUniform uniforms[SHADER_UNIFORM_SLOTS];
+    int uniformsCount;
+    bool uniformsComplete;
+
+    // @NOTE: names are stored in the shader, not in an arena, because shaders are copied by value
+    char uniformNames[SHADER_UNIFORM_NAMES_SIZE];
+    int uniformNamesSize;
+
+    // Set for variants of ShaderPermutations, keywords is the mask of the variant
+    ShaderPermutations* permutations;
+    uint32_t keywords;
+
+    // Set by LoadShaderSourceAsync until the compilation is finished. Pending shaders
+    // aren't valid, so UseShader draws with ErrorShader in the meantime.
+    bool isPending;
+    uint32_t pendingVertex;
+    uint32_t pendingFragment;
+    uint64_t cacheKey;
+    double compileStart;
+
     FileData vertFileData;
     FileData fragFileData;
 };
 
-// Built in shaders for simple rendering
+// Keywords of the built-in mesh shader permutations
+#define BUILT_IN_SHADER_MULTI_DRAW (1u << 0)
+#define BUILT_IN_SHADER_SKINNED    (1u << 1)
+#define BUILT_IN_SHADER_QUANTIZED  (1u << 2)
+
+// Built in shaders for simple rendering. Only these are compiled by InitializeWindow,
+// DrawMesh switches them to the QUANTIZED variant for Quantized meshes.
 extern Shader ErrorShader;
 extern Shader ColorShader;
 extern Shader TextureShader;
@@ -83,21 +133,229 @@ extern Shader VertexColorShader;
 
 extern Shader ScreenSpaceShader;
 
+// Built in shaders for DrawList and DrawMeshInstanced, they read transforms and colors
+// from the draw data buffer. Variant handles, compiled by UseShader on the first use.
+extern Shader MultiDrawColorShader;
+extern Shader MultiDrawVertexColorShader;
+extern Shader MultiDrawTextureShader;
+
+// Built in shaders for DrawSkinnedMeshInstanced, like the MultiDraw ones, but vertices
+// are skinned with the joint palette
+extern Shader SkinnedColorShader;
+extern Shader SkinnedVertexColorShader;
+extern Shader SkinnedTextureShader;
+
+enum class VertexLayout {
+    // Separate VBO for every attribute
+    Split,
+    // One VBO with all attributes packed per vertex, created with immutable storage (DSA)
+    Interleaved,
+    // Same as Interleaved, but attributes are compressed:
+    //  - positions: unorm16x4, relative to mesh bounds,
+    //  - normals:   snorm16x2, octahedral encoding,
+    //  - uv:        unorm16x2, relative to mesh uv range,
+    //  - colors:    unorm8x4,
+    //  - weights:   unorm8x4.
+    // Decoding is done in the QUANTIZED variant of the default vertex shader, see SetMeshUniforms.
+    Quantized,
+};
+
+struct VertexAttributeFormat {
+    bool enabled;
+
+    int components;
+    GLenum type;
+    bool normalized;
+
+    int offset;
+};
+
+// @NOTE: describes how vertex data is laid out in the single VBO
+// used by Interleaved layout.
+struct VertexFormat {
+    VertexLayout layout;
+    int stride;
+
+    VertexAttributeFormat attributes[VertexAttributesCount];
+};
+
+struct BoundingBox {
+    Vector3 min;
+    Vector3 max;
+};
+
+struct BoundingSphere {
+    Vector3 center;
+    float radius;
+};
+
+// Plane: xyz normal pointing inside, w distance. Point is inside when dot(normal, point) + w >= 0.
+// Planes order: left, right, bottom, top, near, far.
+struct Frustum {
+    Vector4 planes[6];
+};
+
+#define MESH_MAX_LODS 8
+
+// Screen space error in pixels allowed when selecting mesh LOD
+#ifndef LOD_SCREEN_ERROR_THRESHOLD
+#define LOD_SCREEN_ERROR_THRESHOLD 1.0f
+#endif
+
+struct MeshLod {
+    // Range in the mesh index buffer
+    int32_t firstIndex;
+    int32_t indexCount;
+
+    // Simplification error, relative to the largest mesh dimension
+    float error;
+};
+
+struct GeometryHeap;
+struct MeshPickData;
+struct MeshletData;
+
+// Up to 4 joints influencing the vertex, indices into the skeleton
+struct JointIndices {
+    uint8_t index[4];
+};
+
 struct Mesh
 {
     Slice<Vector3> vertices;
     Slice<Vector3> normals;
     Slice<Vector4> colors;
     Slice<Vector2> uv;
+
+    // Optional skinning data, both or none. Weights of the vertex should sum to 1.
+    Slice<JointIndices> joints;
+    Slice<Vector4> weights;
     Slice<int32_t> triangles;
 
+    // Indices of all LODs after the first one, they use the same vertices.
+    // Uploaded to the same index buffer, right after triangles.
+    Slice<int32_t> lodTriangles;
+
+    // LOD 0 is always the full mesh, set in ApplyMesh
+    int lodCount;
+    MeshLod lods[MESH_MAX_LODS];
+
+    VertexLayout layout;
+
+    // Calculated in ApplyMesh
+    BoundingBox bounds;
+    BoundingSphere boundingSphere;
+
+    // Range of uv coordinates, Quantized layout stores uv relative to it.
+    // Is (0, 0) - (1, 1) for meshes without uv.
+    Vector2 uvMin;
+    Vector2 uvSize;
+
+    // GL_UNSIGNED_SHORT or GL_UNSIGNED_INT, selected in ApplyMesh based on vertex count.
+    // CPU side triangles are always 32 bit.
+    GLenum indexType;
+
     uint32_t VAO;
     uint32_t EBO;
 
+    // Split layout
     uint32_t positionsVBO;
     uint32_t normalsVBO;
     uint32_t colorsVBO;
     uint32_t uvVBO;
+    uint32_t jointsVBO;
+    uint32_t weightsVBO;
+
+    // Interleaved and Quantized layout
+    uint32_t interleavedVBO;
+
+    // Set when mesh data is stored in the GeometryHeap instead of own buffers
+    GeometryHeap* heap;
+    int32_t baseVertex;
+    // In indices of indexType
+    int32_t firstIndex;
+
+    // Allocated heap ranges, in vertices and bytes
+    uint32_t heapVertexCount;
+    uint32_t heapIndexSize;
+
+    // Triangle BVH built by the first PickMesh call. Reset it to NULL after changing the mesh.
+    MeshPickData* pickData;
+    // Set by BuildMeshlets, has to be rebuilt after changing the triangles
+    MeshletData* meshlets;
+};
+
+// Free range of the GeometryHeap buffer
+struct GeometryRange {
+    uint32_t offset;
+    uint32_t size;
+};
+
+struct GeometryAllocator {
+    uint32_t capacity;
+
+    // Sorted by offset, adjacent ranges are always merged
+    GeometryRange* freeRanges;
+    int freeRangesCount;
+    int maxFreeRanges;
+
+    // The free list grows from it when full
+    MemoryArena* arena;
+};
+
+// Shared vertex and index buffers for static meshes. All meshes in the heap use the same
+// vertex format, so they can be drawn with one VAO bound, using glDrawElementsBaseVertex.
+struct GeometryHeap {
+    VertexFormat format;
+
+    uint32_t VAO;
+    uint32_t VBO;
+    uint32_t EBO;
+
+    // Vertex allocator works in vertices, index allocator in bytes
+    GeometryAllocator vertices;
+    GeometryAllocator indices;
+};
+
+// Same layout as the command read by glMultiDrawElementsIndirect
+struct DrawElementsIndirectCommand {
+    uint32_t count;
+    uint32_t instanceCount;
+    uint32_t firstIndex;
+    int32_t baseVertex;
+    uint32_t baseInstance;
+};
+
+// Per draw data read by the multi draw vertex shader (std430 layout)
+struct DrawData {
+    Matrix model;
+
+    // Quantized meshes decoding, boundsMin.w is 1 for quantized meshes
+    Vector4 boundsMin;
+    Vector4 boundsSize;
+    // xy - uv min, zw - uv size
+    Vector4 uvBounds;
+
+    Vector4 color;
+};
+
+// Collects mesh draws and submits them with one glMultiDrawElementsIndirect per VAO and index type.
+// Draw data of every command is found in the shader with gl_BaseInstance.
+struct DrawList {
+    int capacity;
+    int count;
+
+    // Sort key of every draw: VAO, index type and draw index
+    uint64_t* keys;
+    DrawElementsIndirectCommand* commands;
+    DrawData* drawData;
+
+    // Commands and draw data in submission order, uploaded to the buffers
+    DrawElementsIndirectCommand* sortedCommands;
+    DrawData* sortedDrawData;
+
+    uint32_t commandBuffer;
+    uint32_t drawDataBuffer;
 };
 
 struct Texture {
@@ -272,6 +530,16 @@ struct Input {
 
 #define FRAME_TIMING_UPDATE_INTERVAL 0.5f
 
+struct OcclusionStats {
+    int occluderTriangles;
+    int tested;
+    int culled;
+
+    // In seconds
+    float rasterizeTime;
+    float testTime;
+};
+
 struct FrameTimeData {
     int frameCount;
     float frameTimeSum;
@@ -280,6 +548,26 @@ struct FrameTimeData {
 
     float minFrameTime;
     float maxFrameTime;
+
+    // Accumulated during the frame, moved to lastOcclusion in FrameEnd
+    OcclusionStats occlusion;
+    OcclusionStats lastOcclusion;
+};
+
+// CPU copy of the FrameData uniform block (std140), shared by all shaders.
+// Camera part is uploaded when the camera changes, time and resolution once per frame.
+struct FrameUniforms {
+    Matrix view;
+    Matrix projection;
+    Matrix viewProjection;
+
+    // w is unused
+    Vector4 cameraPosition;
+
+    // x - time since start, y - time delta
+    Vector4 time;
+    // x, y - framebuffer size, z, w - inverse of the size
+    Vector4 resolution;
 };
 
 struct BatchVertex {
@@ -358,6 +646,18 @@ struct SRWindow {
     // @Note: Used mainly for text and screen space rendering
     BatchBuffer batch;
 
+    // FrameData uniform block, see SetFrameCamera
+    uint32_t frameUniformBuffer;
+    FrameUniforms frameUniforms;
+    // Camera of the current frameUniforms, they are uploaded only when it changes
+    Camera frameCamera;
+    bool frameCameraValid;
+
+    // Streaming buffer with DrawData of DrawMeshInstanced, created on first use
+    uint32_t instanceBuffer;
+    // Streaming buffer with joint palettes of DrawSkinnedMeshInstanced, created on first use
+    uint32_t jointPaletteBuffer;
+
     bool resizedThisFrame;
 };
 
@@ -425,18 +725,32 @@ union UniformValue {
 struct Uniform {
     Str8 name;
     GLint location;
+    // Offset in the MaterialData block, -1 for uniforms outside of it
+    int32_t offset;
 
-    int textureUnit;
+    // Unit of the sampler in the shader, see ReflectShaderUniforms
+    GLint textureUnit;
 
     UniformType type;
     UniformValue value;
 };
 
+#define MATERIAL_MAX_DATA_SIZE 1024
+
 struct Material {
     Shader shader;
 
     int uniformsCount;
     Uniform uniforms[16];
+
+    // std140 copy of the MaterialData uniform block, written by SetUniformValue.
+    // Uploaded to the buffer by UseMaterial only when dirty.
+    uint8_t data[MATERIAL_MAX_DATA_SIZE];
+    uint32_t dataSize;
+    bool dirty;
+
+    // Created by CreateMaterial and CopyMaterial, copies made by assignment share it
+    uint32_t buffer;
 };
 
 //========================================
@@ -495,11 +809,25 @@ void SetBlendingPremultipliedAlpha(SRWindow* window);
 // Shaders
 //=========================================
 
+// Called by InitializeWindow, enables GL_KHR/ARB_parallel_shader_compile when available
+void InitParallelShaderCompile();
+
 Shader LoadShaderSource(const char *vertexShader, const char *fragmentShader);
+// Starts compilation and linking without waiting for them. Programs found in the shader
+// cache are ready right away.
+Shader LoadShaderSourceAsync(const char *vertexShader, const char *fragmentShader);
+// Returns true when shader is no longer pending, check isValid for the result.
+// Without the parallel compile extension it waits for the compilation.
+bool PollShader(Shader* shader);
+// Waits for the compilation of the pending shader
+void FinishShader(Shader* shader);
 Shader LoadShaderFromFile(const char *vertexPath, const char *fragmentPath, MemoryArena* arena);
 bool ReloadShaderIfNecessary(Shader* shader, MemoryArena* arena);
 void UnloadShader(Shader* shader);
 
+// Location from the reflected uniform table, -1 if shader has no such uniform
+int GetShaderUniformLocation(Shader* shader, const char* name);
+
 void SetUniformFloat(Shader shader, char *name, float value);
 void SetUniformVec2(Shader shader, char *name, Vector2 value);
 void SetUniformVec3(Shader shader, char *name, Vector3 value);
@@ -509,15 +837,517 @@ void SetUniformColor(Shader shader, char *name, Vector4 value);
 // Meshes
 //=========================================
 
-void ApplyMesh(Mesh* mesh);
-void FreeMesh(Mesh* mesh);
+// @NOTE: ApplyMesh can be called again on already applied mesh, old GL objects are deleted
+void ApplyMesh(Mesh* mesh, VertexLayout layout = VertexLayout::Split);
+void DeleteMesh(Mesh* mesh);
+
+// Fills layout, bounds, uv range, index type and the first LOD, ApplyMesh calls it before upload
+void SetMeshMetadata(Mesh* mesh, VertexLayout layout);
+// Copies the fields filled by SetMeshMetadata
+void CopyMeshMetadata(Mesh* destination, Mesh* source);
+
+// Creates VBO, EBO and VAO from already packed, interleaved vertex and index data
+void CreateMeshBuffers(Mesh* mesh, VertexFormat format, void* vertexData, uint64_t vertexDataSize,
+                       void* indexData, uint64_t indexDataSize);
+
+// Bit mask of (1 << VertexBufferIndex) of the attributes present in the mesh
+uint32_t GetMeshAttributes(Mesh* mesh);
+VertexFormat GetVertexFormat(Mesh* mesh, VertexLayout layout);
+VertexFormat GetVertexFormat(uint32_t meshAttributes, VertexLayout layout);
+void PackVertices(Mesh* mesh, VertexFormat format, void* destination);
+void SetVertexArrayFormat(GLuint vao, VertexFormat format);
+void PackIndices(Slice<int32_t> triangles, GLenum indexType, void* destination);
+int GetGLTypeSize(GLenum type);
+
+BoundingBox CalculateBounds(Slice<Vector3> vertices);
+// Sphere centered at the bounds center, enclosing all vertices
+BoundingSphere CalculateBoundingSphere(Slice<Vector3> vertices, BoundingBox bounds);
+
+Vector2 OctahedralEncode(Vector3 normal);
+Vector3 OctahedralDecode(Vector2 encoded);
 
 Mesh CreateQuadMesh(MemoryArena* arena);
 Mesh CreateCubeMesh(MemoryArena* arena);
-Mesh CreatePlaneMesh(MemoryArena* arena);
-Mesh CreateUVSphereMesh(MemoryArena* arena);
+// Resolution is the number of vertices along one side
+Mesh CreatePlaneMesh(MemoryArena* arena, int resolution = 11, float size = 10.0f);
+// Segments around the Y axis, rings from pole to pole
+Mesh CreateUVSphereMesh(MemoryArena* arena, int segments = 16, int rings = 16);
+// Every subdivision splits each triangle of the icosahedron into 4
+Mesh CreateIcosphereMesh(MemoryArena* arena, int subdivisions = 2);
+Mesh CreateCylinderMesh(MemoryArena* arena, int segments = 16, int heightSegments = 1, float radius = 0.5f, float height = 1.0f);
+Mesh CreateTorusMesh(MemoryArena* arena, int majorSegments = 32, int minorSegments = 16, float majorRadius = 0.5f, float minorRadius = 0.2f);
+
+struct MeshChunk {
+    // Chunk mesh data, not uploaded to the GPU and valid only during the callback
+    Mesh mesh;
+
+    // Position of the first chunk vertex in the whole grid
+    int x;
+    int y;
+};
+
+typedef void (*MeshChunkCallback)(MeshChunk* chunk, void* userData);
+
+// Generates the same grid as CreatePlaneMesh, but in chunks of chunkResolution quads, so huge grids
+// don't need one big allocation. Chunk data is kept in the arena and popped at the end.
+// @NOTE: chunkResolution of 255 or less keeps chunks within 16 bit indices.
+void GeneratePlaneChunks(int resolution, float size, int chunkResolution, MemoryArena* arena,
+                         MeshChunkCallback callback, void* userData);
+
+enum class NormalWeighting {
+    // Every face contributes the same
+    Uniform,
+    // Face contribution scaled by its area
+    Area,
+    // Face contribution scaled by the angle of the face corner at the vertex
+    Angle,
+};
+
+void CalculateNormals(Mesh* mesh, NormalWeighting weighting = NormalWeighting::Area);
+// Multithreaded version, results are identical to CalculateNormals. Arena is used for scratch memory.
+void CalculateNormalsParallel(Mesh* mesh, MemoryArena* arena, NormalWeighting weighting = NormalWeighting::Area);
+
+//========================================
+// Mesh optimization
+//========================================
+
+struct VertexCacheStats {
+    int transformedVertices;
+
+    // Average cache miss ratio: transformed vertices per triangle (0.5 - 3, lower is better)
+    float acmr;
+    // Average transform to vertex ratio: transformed vertices per vertex (1 is optimal)
+    float atvr;
+};
+
+struct VertexFetchStats {
+    int64_t bytesFetched;
+
+    // Fetched bytes per vertex data size (1 is optimal)
+    float overfetch;
+};
+
+VertexCacheStats AnalyzeVertexCache(Slice<int32_t> triangles, int vertexCount, int cacheSize, MemoryArena* arena);
+VertexFetchStats AnalyzeVertexFetch(Slice<int32_t> triangles, int vertexCount, int vertexSize, MemoryArena* arena);
+
+void OptimizeVertexCache(Slice<int32_t> triangles, int vertexCount, MemoryArena* arena);
+// threshold: allowed ACMR degradation (e.g. 1.05) in exchange for better overdraw
+void OptimizeOverdraw(Slice<int32_t> triangles, Slice<Vector3> vertices, float threshold, MemoryArena* arena);
+// Reorders vertices in order of use and removes unused ones, LOD triangles are remapped too.
+// Returns new vertex count
+int OptimizeVertexFetch(Mesh* mesh, MemoryArena* arena);
+
+// Runs all passes above, overdraw pass is skipped when threshold is 0.
+// Call before ApplyMesh or apply mesh again afterwards.
+void OptimizeMesh(Mesh* mesh, MemoryArena* arena, float overdrawThreshold = 1.05f);
+
+//========================================
+// Mesh import
+//========================================
+
+// Supported formats: OBJ and glTF 2.0 binary (.glb). Mesh data is pushed to the arena, tempArena
+// is used for scratch memory and can be the same arena. Returned mesh has no triangles if the import failed.
+Mesh ImportMeshAtPath(char* path, MemoryArena* arena, MemoryArena* tempArena);
+Mesh ImportObj(char* data, uint64_t size, MemoryArena* arena, MemoryArena* tempArena);
+Mesh ImportGlb(void* data, uint64_t size, MemoryArena* arena, MemoryArena* tempArena);
+
+// Imports and applies the mesh
+Mesh LoadMeshAtPath(char* path, MemoryArena* arena, MemoryArena* tempArena);
+
+//========================================
+// Geometry heap
+//========================================
+
+#define GEOMETRY_HEAP_MAX_FREE_RANGES 4096
+
+// Vertex capacity is in vertices, index buffer size in bytes. Arena is used for the free lists
+// and has to live as long as the heap, the lists grow from it when they fill up.
+// Split layout can't be used, every vertex attribute is always present in the heap.
+GeometryHeap CreateGeometryHeap(VertexLayout layout, uint32_t vertexCapacity, uint32_t indexBufferSize, MemoryArena* arena);
+void DestroyGeometryHeap(GeometryHeap* heap);
+
+// Uploads mesh CPU data to the heap, returns false if there is no space left.
+// Missing attributes are filled with defaults. DeleteMesh releases the ranges.
+bool AddMeshToHeap(GeometryHeap* heap, Mesh* mesh);
+void RemoveMeshFromHeap(Mesh* mesh);
+
+//========================================
+// Mesh cache
+//========================================
+
+// Versioned binary mesh format, with vertex and index data stored exactly like on the GPU.
+// Only Interleaved and Quantized layouts can be cached. Meshes loaded from the cache have
+// no CPU side data.
+
+uint64_t HashBytes(void* data, uint64_t size);
+
+bool SaveMeshCache(char* path, Mesh* mesh, VertexLayout layout, uint64_t sourceHash);
+// Returns false if cache is missing, invalid or was built from different source
+bool LoadMeshCache(char* path, Mesh* mesh, VertexLayout layout, uint64_t sourceHash);
+
+// Loads mesh from the cache, or imports, optimizes and caches the source when the cache is outdated.
+// Arena is used only while the cache is built, everything pushed is popped before return.
+Mesh LoadMeshCached(char* sourcePath, char* cachePath, VertexLayout layout, int lodCount,
+                    MemoryArena* arena, MemoryArena* tempArena);
+
+//========================================
+// Shader cache
+//========================================
+
+// Linked programs are stored as driver binaries, keyed by the hash of the shader sources
+// and the GL vendor, renderer and version strings. LoadShaderSource uses them when the cache
+// is enabled, and compiles the sources when the binary is missing or rejected by the driver.
+
+struct ShaderCacheStats {
+    int hits;
+    int misses;
+
+    double loadTime;
+    double compileTime;
+    // Compile time recorded when the cached binaries were created, minus their load time
+    double savedTime;
+};
+
+// Enabled by InitializeWindow, returns false if the driver has no binary formats
+bool EnableShaderCache(const char* directory);
+uint64_t GetShaderCacheKey(const char* vertexSource, const char* fragmentSource);
+
+// Returns 0 if there is no valid binary for the key
+uint32_t LoadCachedProgram(uint64_t key);
+// Saves binary of the linked program, if the cache is enabled
+void CacheProgram(uint64_t key, uint32_t program, double compileTime);
+
+ShaderCacheStats GetShaderCacheStats();
+
+//========================================
+// Shader preprocessor
+//========================================
+
+#define SHADER_MAX_INCLUDES      32
+#define SHADER_MAX_INCLUDE_NAME  128
+#define SHADER_MAX_INCLUDE_DEPTH 16
+
+// Source for #include "name", the string has to stay alive. Built-in includes are
+// registered by InitializeWindow.
+void AddShaderInclude(const char* name, const char* source);
+
+// Replaces #include "name" lines with the registered source, or the file relative to the
+// working directory. Every file is included once. Adds "#define NAME 1" for every define
+// right after #version (which can follow comments), or at the start if there is no #version.
+// Directives in comments and disabled #if blocks are processed too.
+// Returns NULL if include couldn't be found.
+char* PreprocessShader(const char* source, const char** defines, int definesCount, MemoryArena* arena);
+
+#define SHADER_MAX_KEYWORDS 32
+#define SHADER_MAX_VARIANTS 64
+
+struct ShaderVariant {
+    // Mask of the enabled keywords
+    uint32_t keywords;
+    Shader shader;
+};
+
+// Variants of the same sources, each with a different set of keywords defined.
+// They're compiled on the first use and kept until UnloadShaderPermutations.
+struct ShaderPermutations {
+    // With includes already resolved
+    const char* vertexSource;
+    const char* fragmentSource;
+
+    const char* keywords[SHADER_MAX_KEYWORDS];
+    int keywordsCount;
+
+    ShaderVariant variants[SHADER_MAX_VARIANTS];
+    int variantsCount;
+
+    // Built-in mesh shaders, keywords are the BUILT_IN_SHADER_* bits
+    bool builtIn;
+};
+
+// Keyword strings have to stay alive. Returns NULL if includes couldn't be resolved.
+ShaderPermutations* CreateShaderPermutations(const char* vertexSource, const char* fragmentSource,
+                                             const char** keywords, int keywordsCount, MemoryArena* arena);
+void UnloadShaderPermutations(ShaderPermutations* permutations);
+
+// Bit of the keyword, masks of variants are ORed bits
+uint32_t GetShaderKeyword(ShaderPermutations* permutations, const char* keyword);
 
-void CalculateNormals(Mesh* mesh);
+// Starts compilation of the variant without waiting for it, see LoadShaderSourceAsync
+void PrefetchShaderVariant(ShaderPermutations* permutations, uint32_t keywords, MemoryArena* tempArena);
+// Compiles the variant on the first use, pointer stays valid until the permutations are unloaded
+Shader* GetShaderVariant(ShaderPermutations* permutations, uint32_t keywords, MemoryArena* tempArena);
+// Shader without a program, UseShader compiles the variant when it's used for the first time
+Shader GetShaderVariantHandle(ShaderPermutations* permutations, uint32_t keywords);
+
+//========================================
+// Mesh simplification
+//========================================
+
+// Writes simplified triangles to destination (needs space for triangles.length indices)
+// and returns index count. Error is relative to the largest mesh dimension.
+int SimplifyIndices(int32_t* destination, Slice<int32_t> triangles, Mesh* mesh, int targetIndexCount, float targetError, float* resultError, MemoryArena* arena);
+
+// Generates LOD chain, each LOD with half of the previous triangles. Call before ApplyMesh,
+// after any other modifications of the mesh. Returns number of generated LODs (with LOD 0).
+int GenerateLods(Mesh* mesh, int lodCount, MemoryArena* arena);
+
+// Selects LOD with screen space error below LOD_SCREEN_ERROR_THRESHOLD
+int SelectMeshLod(SRWindow* window, Mesh* mesh, Camera* camera, Matrix transform);
+
+//========================================
+// Culling
+//========================================
+
+// Planes are normalized, so distances can be compared with sphere radius
+Frustum ExtractFrustum(Matrix vp);
+Frustum GetCameraFrustum(Camera* camera);
+
+bool IsSphereInFrustum(Frustum* frustum, Vector3 center, float radius);
+// Mesh bounding sphere moved to world space, radius is scaled by the largest axis scale
+BoundingSphere TransformBoundingSphere(BoundingSphere sphere, Matrix transform);
+// Writes world space spheres (xyz center, w radius) of all instances to destination
+void TransformBoundingSpheres(BoundingSphere sphere, Slice<Matrix> transforms, Vector4* destination);
+
+// Tests 4 spheres at a time (SSE). Indices of visible spheres are written to visible, which needs
+// space for spheres.length indices. Returns visible count.
+int CullSpheres(Frustum* frustum, Slice<Vector4> spheres, int32_t* visible);
+
+//========================================
+// BVH
+//========================================
+
+struct BvhNode {
+    BoundingBox bounds;
+
+    // Index of the left child, right child is right after it. 0 for leaves.
+    int32_t leftChild;
+
+    // Objects of the whole subtree, range in Bvh objectIndices
+    int32_t first;
+    int32_t count;
+};
+
+// Bounding volume hierarchy over scene objects, built with binned SAH.
+// Queries return object indices, in the order of objectBounds passed to BuildBvh.
+// Build stops splitting at the max depth, so depth first traversal (pushing both
+// children of every visited node) never needs more than BVH_MAX_DEPTH + 1 stack entries
+#define BVH_MAX_DEPTH  64
+#define BVH_STACK_SIZE 128
+
+struct Bvh {
+    BvhNode* nodes;
+    int nodesCount;
+
+    // Object indices sorted so objects of every node are contiguous
+    int32_t* objectIndices;
+    // Copy of the object bounds, indexed by object
+    BoundingBox* objectBounds;
+    int objectsCount;
+};
+
+// Called for objects whose bounds are hit by the ray. Distance is the bounds entry distance,
+// callback can replace it with a precise hit distance. Returns false if the object is missed.
+typedef bool (*BvhRayCallback)(void* userData, int32_t object, Vector3 origin, Vector3 direction, float* distance);
+
+// Nodes and object data are pushed to the arena, tempArena is used for scratch memory
+Bvh BuildBvh(Slice<BoundingBox> objectBounds, MemoryArena* arena, MemoryArena* tempArena);
+// Updates bounds after objects moved, tree structure stays the same. Rebuild after large changes.
+void RefitBvh(Bvh* bvh, Slice<BoundingBox> objectBounds);
+
+// Result needs space for bvh->objectsCount indices. Returns number of found objects.
+int QueryBvhFrustum(Bvh* bvh, Frustum* frustum, int32_t* result);
+int QueryBvhBox(Bvh* bvh, BoundingBox box, int32_t* result);
+int QueryBvhSphere(Bvh* bvh, Vector3 center, float radius, int32_t* result);
+
+// Reciprocal for slab tests. Zero components are replaced with tiny values, so rays starting
+// exactly on a box face don't produce NaNs.
+Vector3 GetRayInverseDirection(Vector3 direction);
+
+// Returns closest hit object or -1. Without callback object bounds are treated as the hit shape.
+int RaycastBvh(Bvh* bvh, Vector3 origin, Vector3 direction, float maxDistance, float* distance,
+               BvhRayCallback callback = NULL, void* userData = NULL);
+
+//========================================
+// Picking
+//========================================
+
+struct Ray {
+    Vector3 origin;
+    // Normalized
+    Vector3 direction;
+};
+
+struct MeshHit {
+    // Along the ray, in world space
+    float distance;
+    Vector3 point;
+
+    // Index of the hit triangle (first index is triangle * 3)
+    int triangle;
+    // Weights of the triangle vertices at the hit point
+    Vector3 barycentrics;
+};
+
+// Triangles are stored in BVH leaf order, as the first vertex and two edges in SoA layout,
+// so 4 triangles can be loaded at once
+struct MeshPickData {
+    Bvh bvh;
+
+    float* vertex[3];
+    float* edge1[3];
+    float* edge2[3];
+};
+
+// Screen position is normalized, (0, 0) is the top left corner, like SRWindow::mousePos
+Ray GetScreenRay(Camera* camera, Vector2 screenPosition);
+Ray GetMouseRay(SRWindow* window, Camera* camera);
+
+// Arena can be the same as tempArena, triangle bounds used for the build stay in it then
+MeshPickData* BuildMeshPickData(Mesh* mesh, MemoryArena* arena, MemoryArena* tempArena);
+// Finds the closest triangle hit by the ray, both triangle sides are tested. Needs CPU side mesh data.
+// Pick data is built on first use, in the arena.
+bool PickMesh(Mesh* mesh, Matrix transform, Ray ray, MemoryArena* arena, MemoryArena* tempArena, MeshHit* hit);
+
+//========================================
+// Occlusion culling
+//========================================
+
+// Buffer is split into tiles rasterized in parallel, tiles are split into blocks
+// keeping the farthest depth, so most occludee tests don't touch the pixels
+#define OCCLUSION_TILE_WIDTH  64
+#define OCCLUSION_TILE_HEIGHT 32
+#define OCCLUSION_BLOCK_SIZE  8
+
+struct OcclusionTriangle;
+
+struct OcclusionBuffer {
+    int width;
+    int height;
+
+    float* depth;
+    float* blockMaxDepth;
+
+    Matrix vp;
+
+    OcclusionTriangle* triangles;
+    int trianglesCount;
+    int maxTriangles;
+};
+
+// Width and height have to be multiples of the tile size, something like 256x128 is enough
+OcclusionBuffer CreateOcclusionBuffer(int width, int height, int maxTriangles, MemoryArena* arena);
+
+// Usage: BeginOcclusion, AddOccluder for big meshes close to the camera, RasterizeOccluders,
+// then test the occludees with IsBoxVisible or CullOccluded before submitting them.
+void BeginOcclusion(OcclusionBuffer* buffer, Matrix vp);
+// Needs CPU side mesh data, use simple meshes, every triangle is tested by every tile
+// Triangles crossing the near plane are clipped and can take 2 of the maxTriangles
+void AddOccluder(OcclusionBuffer* buffer, Mesh* mesh, Matrix transform);
+void RasterizeOccluders(SRWindow* window, OcclusionBuffer* buffer);
+
+bool IsBoxVisible(OcclusionBuffer* buffer, BoundingBox box, Matrix transform);
+// Removes occluded objects from the indices, returns the count of the visible ones
+int CullOccluded(SRWindow* window, OcclusionBuffer* buffer, Slice<BoundingBox> worldBounds, int32_t* indices, int count);
+
+//========================================
+// Uploads
+//========================================
+
+#define UPLOAD_QUEUE_CAPACITY 64
+#define UPLOAD_MAX_FENCES     8
+
+struct WorkQueue;
+
+enum class UploadType {
+    Mesh,
+    Texture,
+};
+
+// Preparing is done by a worker thread, the rest by ProcessUploads
+enum UploadState : int32_t {
+    UploadPreparing,
+    UploadPrepared,
+    UploadUploading,
+    UploadFenced,
+    UploadDone,
+    UploadFailed,
+};
+
+struct UploadRequest {
+    UploadType type;
+    volatile int32_t state;
+
+    Mesh* mesh;
+    VertexLayout layout;
+    VertexFormat format;
+    uint64_t vertexDataSize;
+    // Copy of the mesh with the metadata set by the worker, applied to the mesh by ProcessUploads
+    Mesh packedMesh;
+
+    Texture* texture;
+    Slice<char> fileMemory;
+    int width;
+    int height;
+    int channels;
+
+    // Packed vertices followed by indices, or decoded pixels. Freed when everything is copied.
+    uint8_t* data;
+    uint64_t dataSize;
+    uint64_t uploadedSize;
+
+    GLuint VBO;
+    GLuint EBO;
+    GLuint VAO;
+    GLuint textureId;
+
+    // Copies are finished when the fence with this serial signals
+    uint64_t fenceSerial;
+};
+
+struct UploadFence {
+    GLsync sync;
+    uint64_t serial;
+    // Staging buffer position released when the fence signals
+    uint64_t stagingEnd;
+};
+
+struct UploadQueue {
+    WorkQueue* workers;
+
+    UploadRequest requests[UPLOAD_QUEUE_CAPACITY];
+    int firstRequest;
+    int requestsCount;
+
+    // Ring buffer, head and tail only grow, positions are taken modulo the size
+    GLuint stagingBuffer;
+    uint8_t* stagingMemory;
+    uint64_t stagingSize;
+    uint64_t stagingHead;
+    uint64_t stagingTail;
+
+    UploadFence fences[UPLOAD_MAX_FENCES];
+    int firstFence;
+    int fencesCount;
+    uint64_t submittedSerial;
+    uint64_t completedSerial;
+
+    // Max bytes copied by one ProcessUploads call
+    uint64_t frameBudget;
+    uint64_t uploadedLastFrame;
+};
+
+// Workers decode and pack the data, ProcessUploads copies at most frameBudget bytes per call
+// through a persistently mapped staging buffer. Staging size should be a few frame budgets.
+UploadQueue* CreateUploadQueue(uint64_t stagingSize, uint64_t frameBudget, MemoryArena* arena);
+
+// Mesh, texture and file memory have to stay valid until the upload is done. Mesh is usable when
+// its VAO is set, texture when isValid is set. Both return false when the queue is full.
+bool QueueMeshUpload(UploadQueue* queue, Mesh* mesh, VertexLayout layout = VertexLayout::Interleaved);
+bool QueueTextureUpload(UploadQueue* queue, Texture* texture, Slice<char> fileMemory);
+
+// Call once per frame, from the thread owning the GL context
+void ProcessUploads(UploadQueue* queue);
+int GetPendingUploadsCount(UploadQueue* queue);
 
 //========================================
 // Textures
@@ -527,12 +1357,198 @@ Texture LoadTextureFromMemory(Slice<char> mem);
 
 void BindTexture(SRWindow* window, Texture texture, uint32_t unit = 0);
 void BindTexture(SRWindow* window, GLuint textureId, uint32_t unit = 0);
+// Textures bound to the units are tracked, so UseMaterial can skip redundant binds.
+// Call it after binding textures directly with GL.
+void ResetTextureBindings();
+
+//========================================
+// Frame uniforms
+//========================================
+
+// Uniform buffer binding of the FrameData block, declared in the
+// "SimpleRenderer/FrameData.glsl" shader include
+#define FRAME_DATA_BINDING 0
+
+void InitFrameUniforms(SRWindow* window);
+// Uploads time and resolution, called by FrameStart
+void UpdateFrameUniforms(SRWindow* window);
+// Uploads view, projection and camera position, only if the camera changed since the last call.
+// @NOTE: DrawMesh without a camera resets the frame camera to identity, so mixing it with the
+// camera draws in a frame costs a uniform buffer update on every switch between them.
+void SetFrameCamera(SRWindow* window, Camera* camera);
 
 //========================================
 // Drawing
 //========================================
+
+// Transform is the full clip space transform, frame camera is reset to identity
 void DrawMesh(SRWindow* window, Mesh mesh, Matrix transform);
+// Selects mesh LOD based on the camera, see SelectMeshLod
 void DrawMesh(SRWindow* window, Mesh mesh, Camera camera, Matrix transform);
+void DrawMeshLod(SRWindow* window, Mesh* mesh, int lod);
+// Sets the model matrix uniform. Custom shaders with the MVP uniform get it
+// computed with the frame camera.
+void SetModelMatrix(SRWindow* window, Matrix model);
+
+//========================================
+// Multi draw
+//========================================
+
+// Shader storage binding of the DrawData buffer
+#define DRAW_DATA_BINDING 0
+
+// Arena is used for CPU side draw data, capacity is the max number of draws between submits
+DrawList CreateDrawList(int capacity, MemoryArena* arena);
+void DestroyDrawList(DrawList* list);
+
+// Mesh has to stay alive until the list is submitted
+void PushDraw(DrawList* list, Mesh* mesh, Matrix transform, int lod = 0, Vector4 color = {1, 1, 1, 1});
+// Sorts draws into buckets and draws them with the current shader, which has to be
+// one of the MultiDraw shaders or use the same draw data buffer. Clears the list.
+void SubmitDrawList(SRWindow* window, DrawList* list, Camera camera);
+
+// Draws all instances in one call, with the current shader (see SubmitDrawList).
+// Colors are optional, instances are white without them.
+void DrawMeshInstanced(SRWindow* window, Mesh mesh, Camera camera, Slice<Matrix> transforms, Slice<Vector4> colors = {});
+
+// Binds VAO only if it's different from the currently bound one, so consecutive draws
+// using the same VAO (like meshes from the GeometryHeap) don't rebind it
+void BindVertexArray(GLuint vao);
+// Deletes VAO and forgets it if it's currently bound
+void DeleteVertexArray(GLuint* vao);
+
+//========================================
+// Meshlets
+//========================================
+
+#define MESHLET_MAX_VERTICES  64
+#define MESHLET_MAX_TRIANGLES 124
+
+struct Meshlet {
+    // Range of the mesh triangles, in indices
+    uint32_t firstIndex;
+    uint32_t indexCount;
+    // Unique vertices used by the triangles
+    uint32_t verticesCount;
+
+    // In mesh space
+    BoundingSphere sphere;
+
+    // Normal cone, cutoff is the sine of the cone spread. Meshlets with
+    // cutoff equal to 1 are never backface culled.
+    Vector3 coneAxis;
+    float coneCutoff;
+};
+
+struct MeshletData {
+    Meshlet* meshlets;
+    int meshletsCount;
+
+    // Written by CullMeshlets, one command for every run of visible meshlets
+    DrawElementsIndirectCommand* commands;
+    int commandsCount;
+    int visibleCount;
+
+    GLuint commandBuffer;
+};
+
+// Splits the mesh triangles into meshlets, without reordering them. Needs CPU side mesh data.
+// Arena can be the same as tempArena.
+MeshletData* BuildMeshlets(Mesh* mesh, MemoryArena* arena, MemoryArena* tempArena);
+void DestroyMeshlets(Mesh* mesh);
+
+// Frustum and backface cone culling, transform should have uniform scale. Returns commands count.
+int CullMeshlets(MeshletData* data, Mesh* mesh, Matrix transform, Camera* camera);
+// Draws visible meshlets with one indirect draw, with the current shader like DrawMesh
+void DrawMeshlets(SRWindow* window, Mesh* mesh, Camera camera, Matrix transform);
+
+//========================================
+// Skeletal animation
+//========================================
+
+#define MAX_SKELETON_JOINTS 256
+
+// Shader storage binding of the joint palettes buffer
+#define JOINT_PALETTE_BINDING 1
+
+// Joint transforms are stored as separate streams (structure of arrays), so sampling,
+// blending and matrix building process 4 joints at once. Streams are padded to a
+// multiple of 4 joints.
+enum PoseStream {
+    PoseTranslationX,
+    PoseTranslationY,
+    PoseTranslationZ,
+    PoseRotationX,
+    PoseRotationY,
+    PoseRotationZ,
+    PoseRotationW,
+    PoseScaleX,
+    PoseScaleY,
+    PoseScaleZ,
+
+    PoseStreamsCount,
+};
+
+// Local joint transforms, relative to the parent joint
+struct Pose {
+    int jointsCount;
+    float* streams[PoseStreamsCount];
+};
+
+struct Skeleton {
+    int jointsCount;
+    // Parents have to be before their children, root joints have -1
+    int32_t* parents;
+    // Model space to joint space in the bind pose
+    Matrix* inverseBindMatrices;
+};
+
+// Poses sampled at a fixed rate, they're linearly interpolated between frames
+struct AnimationClip {
+    int jointsCount;
+    int framesCount;
+    float sampleRate;
+    float duration;
+
+    Pose* frames;
+};
+
+struct AnimationInstance {
+    AnimationClip* clip;
+    float time;
+
+    // Optional second clip, blended with blendWeight
+    AnimationClip* blendClip;
+    float blendTime;
+    float blendWeight;
+};
+
+// Pose is initialized with identity transforms
+Pose CreatePose(int jointsCount, MemoryArena* arena);
+Skeleton CreateSkeleton(int jointsCount, MemoryArena* arena);
+AnimationClip CreateAnimationClip(int jointsCount, int framesCount, float sampleRate, MemoryArena* arena);
+
+void SetJointPose(Pose* pose, int joint, Vector3 translation, Quaternion rotation, Vector3 scale = {1, 1, 1});
+void CopyPose(Pose* dest, Pose* source);
+
+// Looped clips wrap the time, others are clamped to the duration
+void SampleClip(AnimationClip* clip, float time, bool loop, Pose* outPose);
+// Normalized lerp of the rotations, along the shortest path. outPose can be one of the inputs.
+void BlendPoses(Pose* outPose, Pose* a, Pose* b, float weight);
+
+// Calculates inverse bind matrices from the pose the mesh was modeled in
+void CalculateInverseBindMatrices(Skeleton* skeleton, Pose* bindPose, MemoryArena* tempArena);
+// Writes skinning matrices (joint model space transform * inverse bind matrix) of every joint
+void CalculateJointPalette(Skeleton* skeleton, Pose* pose, Matrix* palette, MemoryArena* tempArena);
+
+// Samples and blends animations of all instances, palettes has skeleton->jointsCount
+// matrices for every instance
+void EvaluateAnimations(Skeleton* skeleton, Slice<AnimationInstance> instances, Slice<Matrix> palettes, MemoryArena* tempArena);
+
+// Draws all instances in one call, like DrawMeshInstanced. Needs one of the Skinned shaders
+// and a mesh with joints and weights.
+void DrawSkinnedMeshInstanced(SRWindow* window, Mesh mesh, Camera camera, Skeleton* skeleton, Slice<Matrix> transforms,
+                              Slice<Matrix> palettes, Slice<Vector4> colors = {});
 
 //========================================
 // Screen Space drawing
@@ -545,7 +1561,18 @@ void DrawTextureFragment(SRWindow* window, Texture texture, Rect source, Rect de
 // Materials
 //======================================
 
+// Uniform buffer binding of the MaterialData block
+#define MATERIAL_DATA_BINDING 1
+
+// Uniforms declared in the "uniform MaterialData { ... };" block of the shader are stored
+// in the material buffer, so switching materials binds one buffer range instead of setting
+// every uniform. Other uniforms are set one by one. Shader has to be finished.
 Material CreateMaterial(Shader shader);
+// Copy with its own buffer, so its values can be changed independently
+Material CopyMaterial(Material* material);
+// @NOTE: copies made by assignment (returning or moving the material) share the buffer
+// with the original, they're the same material. Only one of them has to be destroyed.
+void DestroyMaterial(Material* material);
 
 void UseMaterial(SRWindow* window, Material* material);
 
@@ -611,8 +1638,52 @@ int GetGlyphIndex(Str8 text, int* advance);
 void DrawString(SRWindow* window, Str8 text, Font font, Vector2 position, Vector4 color = {0, 0, 0, 1});
 int MeasureStringWidth(Str8 text, Font font);
 
+//======================================
+// Threading
+//======================================
+
+// Called with [start, end) range of the work items
+typedef void (*ParallelForFunction)(void* data, int start, int end);
+
+int GetProcessorCount();
+
+// Splits count items into batches of at least minBatchSize and runs them on
+// multiple threads. Returns when all batches are finished.
+void ParallelFor(int count, int minBatchSize, ParallelForFunction function, void* data);
+
+typedef void (*WorkFunction)(void* data);
+
+#define WORK_QUEUE_CAPACITY 256
+
+struct WorkQueue;
+
+// Persistent worker threads for background work, like asset decoding. Entries are
+// started in push order. Work has to be pushed from a single thread.
+WorkQueue* CreateWorkQueue(int threadsCount, MemoryArena* arena);
+// Returns false when the queue is full
+bool PushWork(WorkQueue* queue, WorkFunction function, void* data);
+
+// Full barrier loads and stores, for flags shared with worker threads
+int32_t AtomicLoad(volatile int32_t* value);
+void AtomicStore(volatile int32_t* value, int32_t newValue);
+
 // Temp platform specific definitions
 uint64_t Win32_GetLastWriteTime(const char* filePath);
 bool Win32_FileHasChanged(FileData fileData);
 
+// Read only view of the whole file, data is NULL if file couldn't be mapped
+struct MappedFile {
+    void* data;
+    uint64_t size;
+
+    void* fileHandle;
+    void* mappingHandle;
+};
+
+MappedFile Win32_MapFile(const char* filePath);
+void Win32_UnmapFile(MappedFile* file);
+
+// Returns true if directory exists after the call
+bool Win32_CreateDirectory(const char* path);
+
 #endif
\ No newline at end of file
@@ -0,0 +1,471 @@
+#include "SimpleRenderer.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+//========================================
+// Uploads
+//========================================
+
+// Staging ranges are 16 bytes aligned
+#define UPLOAD_STAGING_ALIGNMENT 16
+
+static uint64_t AlignUploadSize(uint64_t size) {
+    return (size + UPLOAD_STAGING_ALIGNMENT - 1) & ~(uint64_t) (UPLOAD_STAGING_ALIGNMENT - 1);
+}
+
+static GLenum GetTextureFormat(int channels) {
+    switch(channels) {
+        case 1: return GL_RED;
+        case 2: return GL_RG;
+        case 3: return GL_RGB;
+        case 4: return GL_RGBA;
+    }
+
+    return 0;
+}
+
+static GLenum GetTextureInternalFormat(int channels) {
+    switch(channels) {
+        case 1: return GL_R8;
+        case 2: return GL_RG8;
+        case 3: return GL_RGB8;
+        case 4: return GL_RGBA8;
+    }
+
+    return 0;
+}
+
+UploadQueue* CreateUploadQueue(uint64_t stagingSize, uint64_t frameBudget, MemoryArena* arena) {
+    assert(frameBudget > 0);
+    assert(arena);
+
+    UploadQueue* queue = (UploadQueue*) PushArena(arena, sizeof(UploadQueue));
+
+    int threadsCount = GetProcessorCount() - 1;
+    queue->workers = CreateWorkQueue(threadsCount > 0 ? threadsCount : 1, arena);
+
+    queue->frameBudget = frameBudget;
+    queue->stagingSize = AlignUploadSize(stagingSize);
+
+    // Persistent, coherent mapping, written directly and used as the copy source and pixel unpack buffer
+    GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+
+    glCreateBuffers(1, &queue->stagingBuffer);
+    glNamedBufferStorage(queue->stagingBuffer, queue->stagingSize, NULL, flags);
+    queue->stagingMemory = (uint8_t*) glMapNamedBufferRange(queue->stagingBuffer, 0, queue->stagingSize, flags);
+    assert(queue->stagingMemory);
+
+    return queue;
+}
+
+//========================================
+// Worker side
+//========================================
+
+// @NOTE: the mesh can be read by the render thread in the meantime, so metadata is set
+// on a copy and applied by FinishUpload
+static void PrepareMeshUpload(UploadRequest* request) {
+    request->packedMesh = *request->mesh;
+    Mesh* mesh = &request->packedMesh;
+
+    for(int i = 0; i < mesh->triangles.length; i++) {
+        assert(mesh->triangles[i] < mesh->vertices.length);
+    }
+
+    for(int i = 0; i < mesh->lodTriangles.length; i++) {
+        assert(mesh->lodTriangles[i] < mesh->vertices.length);
+    }
+
+    SetMeshMetadata(mesh, request->layout);
+    request->format = GetVertexFormat(mesh, request->layout);
+
+    int indexSize = GetGLTypeSize(mesh->indexType);
+
+    request->vertexDataSize = (uint64_t) request->format.stride * mesh->vertices.length;
+    request->dataSize = request->vertexDataSize + (uint64_t) GetMeshIndexCount(mesh) * indexSize;
+
+    request->data = (uint8_t*) malloc(request->dataSize);
+    assert(request->data);
+
+    uint8_t* indexData = request->data + request->vertexDataSize;
+    PackVertices(mesh, request->format, request->data);
+    PackIndices(mesh->triangles, mesh->indexType, indexData);
+    PackIndices(mesh->lodTriangles, mesh->indexType, indexData + mesh->triangles.length * indexSize);
+}
+
+static bool PrepareTextureUpload(UploadRequest* request) {
+    int width, height, channels;
+    uint8_t* pixels = stbi_load_from_memory((const stbi_uc*) request->fileMemory.data, (int) request->fileMemory.length,
+                                            &width, &height, &channels, 0);
+
+    if(pixels == NULL || GetTextureFormat(channels) == 0) {
+        fprintf(stderr, "[Error] Can't decode texture\n");
+        stbi_image_free(pixels);
+        return false;
+    }
+
+    request->width    = width;
+    request->height   = height;
+    request->channels = channels;
+
+    request->data     = pixels;
+    request->dataSize = (uint64_t) width * height * channels;
+
+    return true;
+}
+
+static void PrepareUploadJob(void* data) {
+    UploadRequest* request = (UploadRequest*) data;
+
+    bool prepared = true;
+    switch(request->type) {
+        case UploadType::Mesh:    PrepareMeshUpload(request);               break;
+        case UploadType::Texture: prepared = PrepareTextureUpload(request); break;
+    }
+
+    AtomicStore(&request->state, prepared ? UploadPrepared : UploadFailed);
+}
+
+//========================================
+// Render thread side
+//========================================
+
+static UploadRequest* PushUploadRequest(UploadQueue* queue, UploadType type) {
+    if(queue->requestsCount == UPLOAD_QUEUE_CAPACITY) {
+        return NULL;
+    }
+
+    int index = (queue->firstRequest + queue->requestsCount) % UPLOAD_QUEUE_CAPACITY;
+    queue->requestsCount++;
+
+    UploadRequest* request = queue->requests + index;
+    *request = {};
+    request->type  = type;
+    request->state = UploadPreparing;
+
+    return request;
+}
+
+static void StartUploadRequest(UploadQueue* queue, UploadRequest* request) {
+    // Work queue is bigger than the upload queue, so there is always a free entry
+    bool pushed = PushWork(queue->workers, PrepareUploadJob, request);
+    assert(pushed);
+}
+
+bool QueueMeshUpload(UploadQueue* queue, Mesh* mesh, VertexLayout layout) {
+    assert(mesh);
+    assert(mesh->vertices.length > 0 && mesh->triangles.length > 0);
+    // Split layout needs a buffer for every attribute, use ApplyMesh for it
+    assert(layout != VertexLayout::Split);
+
+    UploadRequest* request = PushUploadRequest(queue, UploadType::Mesh);
+    if(request == NULL) {
+        return false;
+    }
+
+    if(mesh->VAO != 0 || mesh->heap) {
+        DeleteMesh(mesh);
+    }
+
+    request->mesh   = mesh;
+    request->layout = layout;
+
+    StartUploadRequest(queue, request);
+    return true;
+}
+
+bool QueueTextureUpload(UploadQueue* queue, Texture* texture, Slice<char> fileMemory) {
+    assert(texture);
+
+    UploadRequest* request = PushUploadRequest(queue, UploadType::Texture);
+    if(request == NULL) {
+        return false;
+    }
+
+    *texture = {};
+
+    request->texture    = texture;
+    request->fileMemory = fileMemory;
+
+    StartUploadRequest(queue, request);
+    return true;
+}
+
+// Destination objects are created with empty storage, filled by the staging copies
+static void CreateUploadDestination(UploadRequest* request) {
+    if(request->type == UploadType::Mesh) {
+        glCreateBuffers(1, &request->VBO);
+        glNamedBufferStorage(request->VBO, request->vertexDataSize, NULL, 0);
+
+        glCreateBuffers(1, &request->EBO);
+        glNamedBufferStorage(request->EBO, request->dataSize - request->vertexDataSize, NULL, 0);
+
+        glCreateVertexArrays(1, &request->VAO);
+        glVertexArrayVertexBuffer(request->VAO, 0, request->VBO, 0, request->format.stride);
+        glVertexArrayElementBuffer(request->VAO, request->EBO);
+
+        SetVertexArrayFormat(request->VAO, request->format);
+    }
+    else {
+        glCreateTextures(GL_TEXTURE_2D, 1, &request->textureId);
+        glTextureStorage2D(request->textureId, 1, GetTextureInternalFormat(request->channels), request->width, request->height);
+
+        // Same parameters as LoadTextureFromMemory
+        glTextureParameteri(request->textureId, GL_TEXTURE_WRAP_S, GL_REPEAT);
+        glTextureParameteri(request->textureId, GL_TEXTURE_WRAP_T, GL_REPEAT);
+        glTextureParameteri(request->textureId, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTextureParameteri(request->textureId, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    }
+}
+
+// Returns size of the free contiguous staging range, at most wanted bytes, or 0 if there is
+// no free range of at least minimum bytes yet. When the range at the end of the buffer is
+// smaller than minimum, the head wraps to the start, once the fences covering it signaled.
+static uint64_t GetStagingRange(UploadQueue* queue, uint64_t wanted, uint64_t minimum, uint64_t* offset) {
+    assert(minimum > 0 && minimum <= queue->stagingSize);
+
+    uint64_t free = queue->stagingSize - (queue->stagingHead - queue->stagingTail);
+    uint64_t position = queue->stagingHead % queue->stagingSize;
+    uint64_t atEnd = queue->stagingSize - position;
+
+    if(atEnd < minimum) {
+        if(queue->stagingHead == queue->stagingTail) {
+            // Nothing in flight, the whole buffer can be used
+            queue->stagingHead += atEnd;
+            queue->stagingTail = queue->stagingHead;
+            free = queue->stagingSize;
+        }
+        else if(free < atEnd + minimum) {
+            return 0;
+        }
+        else {
+            // Skipped range is released with the fence of the next copy
+            queue->stagingHead += atEnd;
+            free -= atEnd;
+        }
+
+        position = 0;
+        atEnd = queue->stagingSize;
+    }
+
+    if(free < minimum) {
+        return 0;
+    }
+
+    *offset = position;
+
+    uint64_t available = free < atEnd ? free : atEnd;
+    return available < wanted ? available : wanted;
+}
+
+// Copies the next part of the request data through the staging buffer, returns copied size
+static uint64_t CopyUploadChunk(UploadQueue* queue, UploadRequest* request, uint64_t budget, bool force) {
+    uint64_t remaining = request->dataSize - request->uploadedSize;
+    uint64_t wanted = remaining < budget ? remaining : budget;
+
+    // Textures are copied in whole rows
+    uint64_t rowSize = 0;
+    if(request->type == UploadType::Texture) {
+        rowSize = (uint64_t) request->width * request->channels;
+
+        // First copy of the frame always makes progress, even with a budget smaller than a row
+        if(force && wanted < rowSize) {
+            wanted = rowSize;
+        }
+
+        wanted -= wanted % rowSize;
+    }
+
+    if(wanted == 0) {
+        return 0;
+    }
+
+    uint64_t offset = 0;
+    uint64_t size = GetStagingRange(queue, wanted, rowSize ? rowSize : 1, &offset);
+
+    if(rowSize) {
+        size -= size % rowSize;
+    }
+
+    if(size == 0) {
+        return 0;
+    }
+
+    memcpy(queue->stagingMemory + offset, request->data + request->uploadedSize, size);
+    queue->stagingHead += AlignUploadSize(size);
+
+    if(request->type == UploadType::Mesh) {
+        uint64_t start = request->uploadedSize;
+        uint64_t end = start + size;
+
+        // Vertex data is followed by index data
+        if(start < request->vertexDataSize) {
+            uint64_t vertexEnd = end < request->vertexDataSize ? end : request->vertexDataSize;
+            glCopyNamedBufferSubData(queue->stagingBuffer, request->VBO, offset, start, vertexEnd - start);
+        }
+
+        if(end > request->vertexDataSize) {
+            uint64_t indexStart = start > request->vertexDataSize ? start : request->vertexDataSize;
+            glCopyNamedBufferSubData(queue->stagingBuffer, request->EBO, offset + (indexStart - start),
+                                     indexStart - request->vertexDataSize, end - indexStart);
+        }
+    }
+    else {
+        int firstRow = (int) (request->uploadedSize / rowSize);
+        int rows = (int) (size / rowSize);
+
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, queue->stagingBuffer);
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+
+        glTextureSubImage2D(request->textureId, 0, 0, firstRow, request->width, rows,
+                            GetTextureFormat(request->channels), GL_UNSIGNED_BYTE, (void*) offset);
+
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    }
+
+    request->uploadedSize += size;
+    return size;
+}
+
+static void FinishUpload(UploadRequest* request) {
+    if(request->type == UploadType::Mesh) {
+        Mesh* mesh = request->mesh;
+        CopyMeshMetadata(mesh, &request->packedMesh);
+
+        mesh->interleavedVBO = request->VBO;
+        mesh->EBO            = request->EBO;
+        mesh->VAO            = request->VAO;
+    }
+    else {
+        Texture* texture = request->texture;
+        texture->id       = request->textureId;
+        texture->width    = request->width;
+        texture->height   = request->height;
+        texture->channels = request->channels;
+        texture->isValid  = true;
+    }
+}
+
+static void FreeUploadData(UploadRequest* request) {
+    if(request->type == UploadType::Mesh) {
+        free(request->data);
+    }
+    else {
+        stbi_image_free(request->data);
+    }
+
+    request->data = NULL;
+}
+
+void ProcessUploads(UploadQueue* queue) {
+    // Staging memory used by the finished copies can be reused
+    while(queue->fencesCount > 0) {
+        UploadFence* fence = queue->fences + queue->firstFence;
+
+        GLenum result = glClientWaitSync(fence->sync, 0, 0);
+        if(result != GL_ALREADY_SIGNALED && result != GL_CONDITION_SATISFIED) {
+            break;
+        }
+
+        glDeleteSync(fence->sync);
+        queue->stagingTail = fence->stagingEnd;
+        queue->completedSerial = fence->serial;
+
+        queue->firstFence = (queue->firstFence + 1) % UPLOAD_MAX_FENCES;
+        queue->fencesCount--;
+    }
+
+    // Every copy is fenced in the frame it was made, so ranges skipped by wraps without
+    // a following copy are released here
+    if(queue->fencesCount == 0) {
+        queue->stagingTail = queue->stagingHead;
+    }
+
+    uint64_t uploaded = 0;
+    bool canCopy = queue->fencesCount < UPLOAD_MAX_FENCES;
+
+    for(int i = 0; i < queue->requestsCount; i++) {
+        UploadRequest* request = queue->requests + (queue->firstRequest + i) % UPLOAD_QUEUE_CAPACITY;
+
+        // Workers only change the preparing state, it's never written back here
+        int32_t loadedState = AtomicLoad(&request->state);
+        int32_t state = loadedState;
+
+        if(state == UploadPrepared) {
+            if(request->type == UploadType::Texture && (uint64_t) request->width * request->channels > queue->stagingSize) {
+                fprintf(stderr, "[Error] Texture row doesn't fit in the upload staging buffer\n");
+                FreeUploadData(request);
+                state = UploadFailed;
+            }
+            else {
+                CreateUploadDestination(request);
+                state = UploadUploading;
+            }
+        }
+
+        if(state == UploadUploading && canCopy) {
+            while(request->uploadedSize < request->dataSize && uploaded < queue->frameBudget) {
+                uint64_t copied = CopyUploadChunk(queue, request, queue->frameBudget - uploaded, uploaded == 0);
+                if(copied == 0) {
+                    break;
+                }
+
+                uploaded += copied;
+            }
+
+            if(request->uploadedSize == request->dataSize) {
+                FreeUploadData(request);
+
+                // Fence is inserted after this loop, copies are done when it signals
+                request->fenceSerial = queue->submittedSerial + 1;
+                state = UploadFenced;
+            }
+        }
+        else if(state == UploadFenced && queue->completedSerial >= request->fenceSerial) {
+            FinishUpload(request);
+            state = UploadDone;
+        }
+        else if(state == UploadFailed) {
+            if(request->type == UploadType::Texture) {
+                *request->texture = ErrorTexture;
+            }
+
+            state = UploadDone;
+        }
+
+        if(state != loadedState) {
+            request->state = state;
+        }
+    }
+
+    if(uploaded > 0) {
+        UploadFence* fence = queue->fences + (queue->firstFence + queue->fencesCount) % UPLOAD_MAX_FENCES;
+        fence->sync       = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        fence->serial     = ++queue->submittedSerial;
+        fence->stagingEnd = queue->stagingHead;
+
+        queue->fencesCount++;
+    }
+
+    queue->uploadedLastFrame = uploaded;
+
+    // Requests are released in order, so slots used by workers are never reused
+    while(queue->requestsCount > 0 && queue->requests[queue->firstRequest].state == UploadDone) {
+        queue->firstRequest = (queue->firstRequest + 1) % UPLOAD_QUEUE_CAPACITY;
+        queue->requestsCount--;
+    }
+}
+
+int GetPendingUploadsCount(UploadQueue* queue) {
+    int count = 0;
+    for(int i = 0; i < queue->requestsCount; i++) {
+        if(queue->requests[(queue->firstRequest + i) % UPLOAD_QUEUE_CAPACITY].state != UploadDone) {
+            count++;
+        }
+    }
+
+    return count;
+}
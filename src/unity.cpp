@@ -3,6 +3,21 @@
 #undef RAYMATH_IMPLEMENTATION
 
 #include "Drawing.cpp"
+#include "MeshOptimization.cpp"
+#include "MeshSimplification.cpp"
+#include "MeshImport.cpp"
+#include "MeshCache.cpp"
+#include "ShaderCache.cpp"
+#include "ShaderPreprocessor.cpp"
+#include "GeometryHeap.cpp"
+#include "MultiDraw.cpp"
+#include "Meshlets.cpp"
+#include "Animation.cpp"
+#include "Culling.cpp"
+#include "Bvh.cpp"
+#include "Picking.cpp"
+#include "Occlusion.cpp"
+#include "Upload.cpp"
 #include "glad.c"
 
 #define IMGUI_IMPL_OPENGL_LOADER_CUSTOM